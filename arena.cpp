@@ -0,0 +1,200 @@
+#include <cstdlib>
+#include <new>
+
+#include "arena.h"
+
+namespace game {
+
+static inline std::size_t AlignUp(std::size_t n, std::size_t align)
+{
+
+    return (n + align - 1) & ~(align - 1);
+}
+
+
+Arena::Arena(std::size_t block_size)
+{
+
+    block_size_ = block_size;
+    current_ = 0;
+    used_ = 0;
+    peak_ = 0;
+    reserved_ = 0;
+}
+
+
+Arena::~Arena()
+{
+
+    for (int i = 0; i < blocks_.size(); i++) {
+        ::operator delete(blocks_[i].data);
+    }
+}
+
+
+void *Arena::Allocate(std::size_t size, std::size_t align)
+{
+
+    for (;;) {
+        // Reserve a new block once the arena runs out, big enough for large allocations too
+        if (current_ == blocks_.size()) {
+            Block block;
+            block.size = (size + align > block_size_) ? size + align : block_size_;
+            block.data = (char *) ::operator new(block.size);
+            reserved_ += block.size;
+            blocks_.push_back(block);
+        }
+
+        // Blocks are aligned for any type, so aligning the offset is enough
+        std::size_t offset = AlignUp(used_, align);
+        if (offset + size <= blocks_[current_].size) {
+            used_ = offset + size;
+
+            std::size_t total = GetUsed();
+            if (total > peak_) {
+                peak_ = total;
+            }
+            return blocks_[current_].data + offset;
+        }
+
+        // Move on to the next block, a block kept from an earlier frame may already be there
+        current_++;
+        used_ = 0;
+    }
+}
+
+
+void Arena::Reset(void)
+{
+
+    current_ = 0;
+    used_ = 0;
+}
+
+
+void Arena::Rewind(const Marker &marker)
+{
+
+    current_ = marker.block;
+    used_ = marker.used;
+}
+
+
+std::size_t Arena::GetUsed(void)
+{
+
+    std::size_t used = used_;
+    for (int i = 0; i < current_ && i < blocks_.size(); i++) {
+        used += blocks_[i].size;
+    }
+    return used;
+}
+
+
+Arena &ScratchArena(void)
+{
+
+    thread_local Arena arena;
+    return arena;
+}
+
+
+#ifdef GAME_COUNT_ALLOCATIONS
+
+// Counting is per thread, so worker threads don't show up in the main thread's frames
+static thread_local bool counting_g = false;
+static thread_local int allocations_g = 0;
+
+void AllocationCounter::Start(void)
+{
+
+    allocations_g = 0;
+    counting_g = true;
+}
+
+
+int AllocationCounter::Stop(void)
+{
+
+    counting_g = false;
+    return allocations_g;
+}
+
+
+bool AllocationCounter::IsEnabled(void)
+{
+
+    return true;
+}
+
+#else
+
+void AllocationCounter::Start(void)
+{
+}
+
+
+int AllocationCounter::Stop(void)
+{
+
+    return 0;
+}
+
+
+bool AllocationCounter::IsEnabled(void)
+{
+
+    return false;
+}
+
+#endif
+
+} // namespace game
+
+
+#ifdef GAME_COUNT_ALLOCATIONS
+
+// Replacements of the global operator new and delete that count allocations
+// The aligned versions are left alone, the standard ones are used for those
+void *operator new(std::size_t size)
+{
+
+    if (game::counting_g) {
+        game::allocations_g++;
+    }
+    void *p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+
+    return ::operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+
+    if (game::counting_g) {
+        game::allocations_g++;
+    }
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept
+{
+
+    return ::operator new(size, tag);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
+
+#endif
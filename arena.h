@@ -0,0 +1,112 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace game {
+
+    /*
+        Arena is a linear (bump) allocator for short-lived data
+        Allocating just moves a pointer forward, nothing is freed on its own, and Reset gives everything back at once
+        The memory is reserved in blocks that are kept between resets, so once an arena has grown to fit a frame
+        it never touches the heap again
+        It is also a pmr memory resource, so standard containers can use it, for example
+            std::pmr::vector<Contact> contacts(&arena);
+    */
+    class Arena : public std::pmr::memory_resource {
+
+        public:
+            explicit Arena(std::size_t block_size = 64 * 1024);
+            ~Arena();
+
+            Arena(const Arena &) = delete;
+            Arena &operator=(const Arena &) = delete;
+
+            void *Allocate(std::size_t size, std::size_t align = alignof(std::max_align_t));
+
+            // Room for count objects of a plain type, not initialized
+            template<class T> T *Allocate(int count) { return (T *) Allocate(sizeof(T) * count, alignof(T)); }
+
+            // Give back everything allocated since the last reset
+            void Reset(void);
+
+            // A position in the arena, to give back only what was allocated after it
+            struct Marker {
+                int block;
+                std::size_t used;
+            };
+            inline Marker GetMarker(void) { Marker m = { current_, used_ }; return m; }
+            void Rewind(const Marker &marker);
+
+            // Bytes handed out since the last reset, the most handed out at once, and the bytes reserved from the heap
+            std::size_t GetUsed(void);
+            inline std::size_t GetPeak(void) { return peak_; }
+            inline std::size_t GetReserved(void) { return reserved_; }
+
+        protected:
+            // The pmr interface. Deallocating does nothing, memory comes back with Reset or Rewind
+            void *do_allocate(std::size_t bytes, std::size_t alignment) override { return Allocate(bytes, alignment); }
+            void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {}
+            bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+        private:
+            struct Block {
+                char *data;
+                std::size_t size;
+            };
+
+            std::vector<Block> blocks_;
+            std::size_t block_size_;
+
+            // Block being filled, and the bytes used in it
+            int current_;
+            std::size_t used_;
+
+            std::size_t peak_;
+            std::size_t reserved_;
+
+    }; // class Arena
+
+    // Scratch arena of the calling thread, for temporaries that don't outlive a function
+    // Use it with an ArenaScope, so whatever the function allocates is given back when it returns
+    Arena &ScratchArena(void);
+
+    // Rewinds an arena to where it was when the scope started
+    class ArenaScope {
+
+        public:
+            explicit ArenaScope(Arena &arena) : arena_(arena), marker_(arena.GetMarker()) {}
+            ~ArenaScope() { arena_.Rewind(marker_); }
+
+            ArenaScope(const ArenaScope &) = delete;
+            ArenaScope &operator=(const ArenaScope &) = delete;
+
+        private:
+            Arena &arena_;
+            Arena::Marker marker_;
+
+    }; // class ArenaScope
+
+    /*
+        AllocationCounter counts the calls to the global operator new made by the current thread
+        It only counts when the game is built with GAME_COUNT_ALLOCATIONS (the COUNT_ALLOCATIONS CMake option),
+        which replaces the global operator new. Otherwise Stop always returns 0
+        The game counts every frame, so allocations that sneak into the steady state are reported right away
+    */
+    class AllocationCounter {
+
+        public:
+            static void Start(void);
+
+            // Stop counting, and return the allocations since Start
+            static int Stop(void);
+
+            static bool IsEnabled(void);
+
+    }; // class AllocationCounter
+
+} // namespace game
+
+#endif // ARENA_H_
@@ -0,0 +1,174 @@
+/*
+ *
+ * Cooks the game's loose resources into one pack file, which the game maps into memory at startup
+ *
+ * Usage: asset_cooker [--mipmaps] <resources directory> <pack file> <files...>
+ * Files are named relative to the resources directory. PNG images are decoded to RGBA, with all their mip levels
+ * when --mipmaps is given, and every other file is packed as it is
+ *
+ */
+
+#include <iostream>
+#include <exception>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <SOIL/SOIL.h>
+
+#include "asset_pack.h"
+
+using namespace game;
+
+static bool EndsWith(const std::string &s, const char *suffix)
+{
+
+    std::size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+
+// Halve an RGBA image with a box filter, repeating the last row or column of odd sizes
+static void Downsample(const unsigned char *src, int width, int height, unsigned char *dst)
+{
+
+    int w = width > 1 ? width / 2 : 1;
+    int h = height > 1 ? height / 2 : 1;
+    for (int y = 0; y < h; y++) {
+        int y0 = y * 2;
+        int y1 = y0 + 1 < height ? y0 + 1 : y0;
+        for (int x = 0; x < w; x++) {
+            int x0 = x * 2;
+            int x1 = x0 + 1 < width ? x0 + 1 : x0;
+            for (int c = 0; c < 4; c++) {
+                int sum = src[(y0 * width + x0) * 4 + c] + src[(y0 * width + x1) * 4 + c] +
+                    src[(y1 * width + x0) * 4 + c] + src[(y1 * width + x1) * 4 + c];
+                dst[(y * w + x) * 4 + c] = (unsigned char) ((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+
+// Add a file to the payloads, filling in its entry
+static void CookFile(const std::string &directory, const std::string &name, bool mipmaps, PackEntry &entry, std::vector<char> &payloads)
+{
+
+    if (name.size() >= sizeof(entry.name)) {
+        throw(std::runtime_error(std::string("File name too long for the pack: ") + name));
+    }
+    std::string path = directory + "/" + name;
+
+    memset(&entry, 0, sizeof(entry));
+    strcpy(entry.name, name.c_str());
+    if (!GetFileStamp(path.c_str(), entry.source_size, entry.source_time)) {
+        throw(std::runtime_error(std::string("Could not open ") + path));
+    }
+
+    // Payloads are aligned, so the game can upload them straight from the mapping
+    payloads.resize((payloads.size() + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT);
+    entry.offset = payloads.size();
+
+    if (EndsWith(name, ".png")) {
+        int width, height;
+        unsigned char *image = SOIL_load_image(path.c_str(), &width, &height, 0, SOIL_LOAD_RGBA);
+        if (!image) {
+            throw(std::runtime_error(std::string("Could not decode ") + path));
+        }
+
+        int levels = 1;
+        if (mipmaps) {
+            for (int w = width, h = height; w > 1 || h > 1; w = w > 1 ? w / 2 : 1, h = h > 1 ? h / 2 : 1) {
+                levels++;
+            }
+        }
+
+        entry.kind = PACK_TEXTURE;
+        entry.width = width;
+        entry.height = height;
+        entry.levels = levels;
+        entry.size = MipChainSize(width, height, levels);
+
+        // Each level is made from the one before it, right in the payload
+        payloads.resize(entry.offset + entry.size);
+        unsigned char *level = (unsigned char *) &payloads[entry.offset];
+        memcpy(level, image, (std::size_t) width * height * 4);
+        SOIL_free_image_data(image);
+        for (int i = 1; i < levels; i++) {
+            unsigned char *next = level + (std::size_t) width * height * 4;
+            Downsample(level, width, height, next);
+            level = next;
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+    }
+    else {
+        std::vector<char> text;
+        LoadFile(path.c_str(), text);
+        entry.kind = PACK_TEXT;
+        entry.size = text.size();
+        payloads.insert(payloads.end(), text.begin(), text.end());
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+
+    bool mipmaps = argc > 1 && strcmp(argv[1], "--mipmaps") == 0;
+    int first = mipmaps ? 2 : 1;
+    if (argc - first < 3) {
+        std::cerr << "Usage: asset_cooker [--mipmaps] <resources directory> <pack file> <files...>" << std::endl;
+        return 2;
+    }
+    std::string directory = argv[first];
+    std::string pack = argv[first + 1];
+
+    try {
+        // The game finds entries by binary search, so they are sorted by name
+        std::vector<std::string> names(argv + first + 2, argv + argc);
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+
+        std::vector<PackEntry> entries(names.size());
+        std::vector<char> payloads;
+        for (int i = 0; i < names.size(); i++) {
+            CookFile(directory, names[i], mipmaps, entries[i], payloads);
+        }
+
+        // Payload offsets are from the start of the file
+        std::size_t table_size = sizeof(PackHeader) + sizeof(PackEntry) * entries.size();
+        std::size_t payload_start = (table_size + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+        for (int i = 0; i < entries.size(); i++) {
+            entries[i].offset += payload_start;
+        }
+
+        PackHeader header = { PACK_MAGIC, PACK_VERSION, (unsigned int) entries.size(), 0 };
+        std::vector<char> padding(payload_start - table_size, 0);
+
+        // Write next to the pack and rename, so a running game never maps a half written pack
+        std::string temporary = pack + ".tmp";
+        {
+            std::ofstream file(temporary.c_str(), std::ios::binary);
+            file.write((const char *) &header, sizeof(header));
+            file.write((const char *) entries.data(), sizeof(PackEntry) * entries.size());
+            file.write(padding.data(), padding.size());
+            file.write(payloads.data(), payloads.size());
+            if (!file) {
+                throw(std::runtime_error(std::string("Could not write ") + temporary));
+            }
+        }
+        std::filesystem::rename(temporary, pack);
+
+        printf("Packed %d files into %s (%d bytes)\n", (int) entries.size(), pack.c_str(), (int) (payload_start + payloads.size()));
+        return 0;
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
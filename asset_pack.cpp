@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include "asset_pack.h"
+
+namespace game {
+
+std::size_t MipChainSize(int width, int height, int levels)
+{
+
+    std::size_t size = 0;
+    for (int i = 0; i < levels; i++) {
+        size += (std::size_t) width * height * 4;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return size;
+}
+
+
+bool GetFileStamp(const char *filename, unsigned long long &size, long long &time)
+{
+
+    std::error_code error;
+    std::filesystem::path path(filename);
+    std::uintmax_t file_size = std::filesystem::file_size(path, error);
+    if (error) {
+        return false;
+    }
+    std::filesystem::file_time_type file_time = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return false;
+    }
+
+    size = (unsigned long long) file_size;
+    time = (long long) file_time.time_since_epoch().count();
+    return true;
+}
+
+
+static bool EntryLess(const PackEntry &entry, const char *name)
+{
+
+    return strcmp(entry.name, name) < 0;
+}
+
+
+AssetPack::AssetPack(void)
+{
+
+    entries_ = NULL;
+    num_entries_ = 0;
+}
+
+
+bool AssetPack::Open(const char *filename)
+{
+
+    Close();
+    if (!file_.Open(filename)) {
+        return false;
+    }
+
+    // Check everything up front, so the entries can be trusted later
+    const char *data = file_.GetData();
+    std::size_t size = file_.GetSize();
+    PackHeader header;
+    if (size < sizeof(header)) {
+        Close();
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != PACK_MAGIC || header.version != PACK_VERSION ||
+        header.num_entries > (size - sizeof(header)) / sizeof(PackEntry)) {
+        Close();
+        return false;
+    }
+
+    const PackEntry *entries = (const PackEntry *) (data + sizeof(header));
+    for (unsigned int i = 0; i < header.num_entries; i++) {
+        const PackEntry &entry = entries[i];
+        bool valid = memchr(entry.name, '\0', sizeof(entry.name)) != NULL &&
+            (i == 0 || strcmp(entries[i - 1].name, entry.name) < 0) &&
+            entry.offset % PACK_ALIGNMENT == 0 && entry.offset <= size && entry.size <= size - entry.offset;
+        if (valid && entry.kind == PACK_TEXTURE) {
+            valid = entry.width > 0 && entry.height > 0 && entry.levels > 0 && entry.levels <= 16 &&
+                entry.size == MipChainSize(entry.width, entry.height, entry.levels);
+        }
+        else if (valid) {
+            valid = entry.kind == PACK_TEXT;
+        }
+        if (!valid) {
+            Close();
+            return false;
+        }
+    }
+
+    entries_ = entries;
+    num_entries_ = (int) header.num_entries;
+    return true;
+}
+
+
+void AssetPack::Close(void)
+{
+
+    file_.Close();
+    entries_ = NULL;
+    num_entries_ = 0;
+}
+
+
+const PackEntry *AssetPack::Find(const char *name)
+{
+
+    const PackEntry *end = entries_ + num_entries_;
+    const PackEntry *entry = std::lower_bound(entries_, end, name, EntryLess);
+    if (entry == end || strcmp(entry->name, name) != 0) {
+        return NULL;
+    }
+    return entry;
+}
+
+
+bool AssetPack::IsFresh(const PackEntry *entry, const char *loose_file)
+{
+
+    unsigned long long size;
+    long long time;
+    if (!GetFileStamp(loose_file, size, time)) {
+        return true;
+    }
+    return size == entry->source_size && time == entry->source_time;
+}
+
+} // namespace game
@@ -0,0 +1,89 @@
+#ifndef ASSET_PACK_H_
+#define ASSET_PACK_H_
+
+#include <cstddef>
+
+#include "file_utils.h"
+
+namespace game {
+
+    // Packs start with this header, followed by the table of entries sorted by name, and then the payloads
+    // The version changes whenever the layout changes, packs of another version are ignored
+    const unsigned int PACK_MAGIC = 0x4B504B48; // "HKPK"
+    const unsigned int PACK_VERSION = 1;
+
+    // Payloads start on this boundary, so textures can be uploaded straight from the mapping
+    const unsigned int PACK_ALIGNMENT = 16;
+
+    struct PackHeader {
+        unsigned int magic;
+        unsigned int version;
+        unsigned int num_entries;
+        unsigned int reserved;
+    };
+
+    // What a payload holds
+    enum PackKind {
+        PACK_TEXTURE,           // Decoded RGBA8 image, with its smaller mip levels after it when levels > 1
+        PACK_TEXT               // Text file, as it is on disk
+    };
+
+    struct PackEntry {
+        // Path of the loose file relative to the resources directory, with forward slashes
+        char name[64];
+
+        int kind;
+        int width;
+        int height;
+        int levels;
+
+        unsigned long long offset;
+        unsigned long long size;
+
+        // Size and modification time of the loose file when it was packed, to tell when the pack is stale
+        unsigned long long source_size;
+        long long source_time;
+    };
+
+    // Bytes of an RGBA8 image and all its mip levels
+    std::size_t MipChainSize(int width, int height, int levels);
+
+    // Size and modification time of a file, false if it doesn't exist
+    bool GetFileStamp(const char *filename, unsigned long long &size, long long &time);
+
+    /*
+        AssetPack gives access to a pack written by the asset cooker
+        The pack is mapped into memory, and payloads are used in place for as long as the pack is open
+    */
+    class AssetPack {
+
+        public:
+            AssetPack(void);
+
+            // Map and check a pack. Returns false, leaving the pack closed, if it is missing or not valid
+            bool Open(const char *filename);
+            void Close(void);
+
+            // Find an entry by the name of its loose file, NULL if the pack doesn't have it
+            const PackEntry *Find(const char *name);
+
+            // Check that an entry still matches its loose file. Entries whose file is gone are still used
+            bool IsFresh(const PackEntry *entry, const char *loose_file);
+
+            // Where the payload of an entry starts
+            inline const char *GetData(const PackEntry *entry) { return file_.GetData() + entry->offset; }
+
+            // Getters
+            inline bool IsOpen(void) { return file_.IsOpen(); }
+            inline int GetNumEntries(void) { return num_entries_; }
+
+        private:
+            MappedFile file_;
+            const PackEntry *entries_;
+            int num_entries_;
+
+    }; // class AssetPack
+
+} // namespace game
+
+#endif // ASSET_PACK_H_
@@ -0,0 +1,130 @@
+#include <algorithm>
+
+#include "background_layer.h"
+
+namespace game {
+
+// Same layout as the sprite created in Game::CreateSprite:
+// position (2), color (3), texture coordinates (2)
+const int vertex_att_g = 7;
+
+BackgroundLayer::BackgroundLayer(void)
+{
+    // Buffers are created on the first Bake(), once there is an OpenGL context
+    vbo_ = 0;
+    ebo_ = 0;
+    capacity_ = 0;
+    draw_calls_ = 0;
+}
+
+
+BackgroundLayer::~BackgroundLayer()
+{
+
+    if (vbo_ != 0) {
+        glDeleteBuffers(1, &vbo_);
+        glDeleteBuffers(1, &ebo_);
+    }
+}
+
+
+void BackgroundLayer::Bake(const std::vector<BackgroundTile> &tiles)
+{
+    // Build the world space quads on the CPU, one tile at a time
+    std::vector<GLfloat> vertex;
+    std::vector<GLuint> face;
+    vertex.reserve(tiles.size() * 4 * vertex_att_g);
+    face.reserve(tiles.size() * 6);
+
+    runs_.clear();
+    tile_top_.clear();
+    tile_bottom_.clear();
+
+    for (int i = 0; i < tiles.size(); i++) {
+        const BackgroundTile &t = tiles[i];
+        float h = t.scale * 0.5f;
+        float x = t.position.x;
+        float y = t.position.y;
+
+        GLfloat quad[] = {
+            // Position      Color                Texture coordinates
+            x - h, y + h,    1.0f, 0.0f, 0.0f,    0.0f, 0.0f, // Top-left
+            x + h, y + h,    0.0f, 1.0f, 0.0f,    1.0f, 0.0f, // Top-right
+            x + h, y - h,    0.0f, 0.0f, 1.0f,    1.0f, 1.0f, // Bottom-right
+            x - h, y - h,    1.0f, 1.0f, 1.0f,    0.0f, 1.0f  // Bottom-left
+        };
+        vertex.insert(vertex.end(), quad, quad + 4 * vertex_att_g);
+
+        GLuint base = i * 4;
+        GLuint quad_face[] = { base + 0, base + 1, base + 2, base + 2, base + 3, base + 0 };
+        face.insert(face.end(), quad_face, quad_face + 6);
+
+        tile_top_.push_back(y + h);
+        tile_bottom_.push_back(y - h);
+
+        // Consecutive tiles with the same texture are drawn together
+        if (runs_.empty() || runs_.back().texture.index != t.texture.index) {
+            Run run = { t.texture, i, 0 };
+            runs_.push_back(run);
+        }
+        runs_.back().count++;
+    }
+
+    if (vbo_ == 0) {
+        glGenBuffers(1, &vbo_);
+        glGenBuffers(1, &ebo_);
+    }
+
+    // Upload once; the buffers are only touched again if the layer is re-baked
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    if ((int) tiles.size() > capacity_) {
+        capacity_ = (int) tiles.size();
+        glBufferData(GL_ARRAY_BUFFER, capacity_ * 4 * vertex_att_g * sizeof(GLfloat), NULL, GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, capacity_ * 6 * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+    }
+    if (!tiles.empty()) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertex.size() * sizeof(GLfloat), vertex.data());
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, face.size() * sizeof(GLuint), face.data());
+    }
+}
+
+
+void BackgroundLayer::Render(Shader &shader, ResourceManager &resources, float bottom, float top)
+{
+    draw_calls_ = 0;
+    if (runs_.empty()) {
+        return;
+    }
+
+    // Find the visible tiles: the first one whose top is above the bottom of the view,
+    // up to the first one whose bottom is above the top of the view
+    int first = (int) (std::upper_bound(tile_top_.begin(), tile_top_.end(), bottom) - tile_top_.begin());
+    int last = (int) (std::lower_bound(tile_bottom_.begin(), tile_bottom_.end(), top) - tile_bottom_.begin());
+    if (first >= last) {
+        return;
+    }
+
+    // The vertices are already in world space
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    shader.SetAttributes();
+    shader.SetUniformMat4("transformation_matrix", glm::mat4(1.0f));
+
+    for (int i = 0; i < runs_.size(); i++) {
+        const Run &run = runs_[i];
+
+        // Clip the run to the visible range
+        int start = std::max(run.first, first);
+        int end = std::min(run.first + run.count, last);
+        if (start >= end) {
+            continue;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, resources.Use(run.texture));
+        glDrawElements(GL_TRIANGLES, (end - start) * 6, GL_UNSIGNED_INT, (void *)(start * 6 * sizeof(GLuint)));
+        draw_calls_++;
+    }
+}
+
+} // namespace game
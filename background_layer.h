@@ -0,0 +1,71 @@
+#ifndef BACKGROUND_LAYER_H_
+#define BACKGROUND_LAYER_H_
+
+#include <glm/glm.hpp>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <vector>
+
+#include "shader.h"
+#include "resource_manager.h"
+
+namespace game {
+
+    // A single static tile of the background
+    struct BackgroundTile {
+        glm::vec3 position;
+        float scale;
+        TextureHandle texture;
+    };
+
+    /*
+        BackgroundLayer holds the static background tiles baked into one vertex buffer
+        The vertices are stored in world space, so the tiles need no matrix work when drawn
+        Tiles are expected to form a strip sorted by y (like the level's ground tiles), which
+        lets us find the visible range quickly and draw it with one call per texture run
+    */
+    class BackgroundLayer {
+
+        public:
+            BackgroundLayer(void);
+            ~BackgroundLayer();
+
+            // Bake a list of tiles into the vertex buffer (replaces whatever was baked before)
+            void Bake(const std::vector<BackgroundTile> &tiles);
+
+            // Draw the tiles that overlap the world range [bottom, top], with the textures of the resource manager
+            void Render(Shader &shader, ResourceManager &resources, float bottom, float top);
+
+            // Getters
+            inline int GetNumTiles(void) { return (int) tile_top_.size(); }
+            inline int GetNumDrawCalls(void) { return draw_calls_; }
+
+        private:
+            // A range of consecutive tiles sharing the same texture
+            struct Run {
+                TextureHandle texture;
+                int first;
+                int count;
+            };
+
+            // OpenGL buffers holding the baked geometry
+            GLuint vbo_;
+            GLuint ebo_;
+
+            // Number of tiles the buffers can currently hold
+            int capacity_;
+
+            std::vector<Run> runs_;
+
+            // Top and bottom edge of each tile, used to find the visible range
+            std::vector<float> tile_top_;
+            std::vector<float> tile_bottom_;
+
+            // Draw calls issued by the last Render
+            int draw_calls_;
+
+    }; // class BackgroundLayer
+
+} // namespace game
+
+#endif // BACKGROUND_LAYER_H_
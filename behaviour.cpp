@@ -0,0 +1,451 @@
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "behaviour.h"
+
+namespace game {
+
+// Block sizes of the frame pool, and how many blocks are reserved at once when a size runs out
+const std::size_t frame_sizes_g[] = { 128, 256, 512, 1024 };
+const int num_frame_sizes_g = sizeof(frame_sizes_g) / sizeof(frame_sizes_g[0]);
+const int frames_per_slab_g = 64;
+
+// Free blocks of each size, linked through their first bytes
+struct FreeFrame {
+    FreeFrame *next;
+};
+static FreeFrame *free_frames_g[num_frame_sizes_g] = { NULL };
+static int live_frames_g = 0;
+static int unpooled_frames_g = 0;
+static std::size_t reserved_bytes_g = 0;
+
+// Every slab of the pool, in the order they were reserved, for snapshots
+struct FrameSlab {
+    char *data;
+    int size_class;
+};
+static std::vector<FrameSlab> frame_slabs_g;
+
+// Find the block size that fits a frame, -1 if it is too big for the pool
+static int FrameSizeClass(std::size_t size)
+{
+
+    for (int i = 0; i < num_frame_sizes_g; i++) {
+        if (size <= frame_sizes_g[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+void *FramePool::Allocate(std::size_t size)
+{
+
+    live_frames_g++;
+
+    int c = FrameSizeClass(size);
+    if (c == -1) {
+        unpooled_frames_g++;
+        return ::operator new(size);
+    }
+
+    // Reserve a new slab of blocks when this size has none left
+    // Slabs are never given back, they are reused by the next scripts
+    if (free_frames_g[c] == NULL) {
+        char *slab = (char *) ::operator new(frame_sizes_g[c] * frames_per_slab_g);
+        reserved_bytes_g += frame_sizes_g[c] * frames_per_slab_g;
+        FrameSlab record = { slab, c };
+        frame_slabs_g.push_back(record);
+        for (int i = frames_per_slab_g - 1; i >= 0; i--) {
+            FreeFrame *frame = (FreeFrame *) (slab + i * frame_sizes_g[c]);
+            frame->next = free_frames_g[c];
+            free_frames_g[c] = frame;
+        }
+    }
+
+    FreeFrame *frame = free_frames_g[c];
+    free_frames_g[c] = frame->next;
+    return frame;
+}
+
+
+void FramePool::Free(void *frame, std::size_t size)
+{
+
+    live_frames_g--;
+
+    int c = FrameSizeClass(size);
+    if (c == -1) {
+        unpooled_frames_g--;
+        ::operator delete(frame);
+        return;
+    }
+
+    FreeFrame *free_frame = (FreeFrame *) frame;
+    free_frame->next = free_frames_g[c];
+    free_frames_g[c] = free_frame;
+}
+
+
+int FramePool::GetNumLive(void)
+{
+
+    return live_frames_g;
+}
+
+
+std::size_t FramePool::GetNumReserved(void)
+{
+
+    return reserved_bytes_g;
+}
+
+
+void FramePool::Write(SnapshotWriter &writer)
+{
+
+    // Frames too big for the pool live on the heap, where the snapshot can't find them
+    if (unpooled_frames_g > 0) {
+        throw(std::runtime_error(std::string("Can't snapshot scripts with frames outside of the pool")));
+    }
+
+    writer.Write(live_frames_g);
+    writer.Write(free_frames_g);
+    writer.Write((int) frame_slabs_g.size());
+    for (int i = 0; i < frame_slabs_g.size(); i++) {
+        writer.Write(frame_slabs_g[i].size_class);
+        writer.Write(frame_slabs_g[i].data, frame_sizes_g[frame_slabs_g[i].size_class] * frames_per_slab_g);
+    }
+}
+
+
+void FramePool::Read(SnapshotReader &reader)
+{
+
+    reader.Read(live_frames_g);
+    reader.Read(free_frames_g);
+
+    // Slabs are never given back, so the ones in the snapshot are still there, at the same addresses
+    int num_slabs = reader.ReadCount(sizeof(int));
+    if (num_slabs > frame_slabs_g.size()) {
+        throw(std::runtime_error(std::string("Snapshot has frame slabs this run doesn't have")));
+    }
+    for (int i = 0; i < num_slabs; i++) {
+        int c;
+        reader.Read(c);
+        if (c != frame_slabs_g[i].size_class) {
+            throw(std::runtime_error(std::string("Snapshot has frame slabs this run doesn't have")));
+        }
+        reader.Read(frame_slabs_g[i].data, frame_sizes_g[c] * frames_per_slab_g);
+    }
+
+    // Slabs reserved after the snapshot was taken were all free at the time
+    for (int i = num_slabs; i < frame_slabs_g.size(); i++) {
+        int c = frame_slabs_g[i].size_class;
+        for (int j = frames_per_slab_g - 1; j >= 0; j--) {
+            FreeFrame *frame = (FreeFrame *) (frame_slabs_g[i].data + j * frame_sizes_g[c]);
+            frame->next = free_frames_g[c];
+            free_frames_g[c] = frame;
+        }
+    }
+}
+
+
+void NextTick::await_suspend(Behaviour::Handle handle)
+{
+
+    scheduler = handle.promise().scheduler;
+    scheduler->WaitTick(handle.promise().slot);
+}
+
+
+double NextTick::await_resume()
+{
+
+    return scheduler->GetDeltaTime();
+}
+
+
+void Delay::await_suspend(Behaviour::Handle handle)
+{
+
+    handle.promise().scheduler->WaitDelay(handle.promise().slot, seconds);
+}
+
+
+bool Volley::await_suspend(Behaviour::Handle handle)
+{
+
+    return handle.promise().scheduler->StartVolley(handle.promise().slot, *this);
+}
+
+
+BehaviourScheduler::BehaviourScheduler(void)
+{
+
+    free_ = -1;
+    num_scripts_ = 0;
+    timers_ = NULL;
+    running_ = -1;
+    running_killed_ = false;
+    delta_time_ = 0.0;
+    num_resumed_ = 0;
+}
+
+
+BehaviourScheduler::~BehaviourScheduler()
+{
+
+    Clear();
+}
+
+
+void BehaviourScheduler::Init(TimerWheel *timers, std::function<void(const Volley &)> emit_volley)
+{
+
+    timers_ = timers;
+    emit_volley_ = emit_volley;
+}
+
+
+void BehaviourScheduler::Start(Behaviour script, Entity owner)
+{
+    // Reuse a free slot if there is one
+    int slot;
+    if (free_ != -1) {
+        slot = free_;
+        free_ = scripts_[slot].next_free;
+    }
+    else {
+        slot = (int) scripts_.size();
+        Script s;
+        s.serial = 0;
+        scripts_.push_back(s);
+    }
+
+    Script &s = scripts_[slot];
+    s.handle = script.Release();
+    s.owner = owner;
+    s.timer = 0;
+    s.volley = Volley();
+    s.bursts_left = 0;
+    s.serial++;
+    s.next_free = -1;
+
+    // Put it at the front of its owner's scripts
+    unsigned int index = owner & ENTITY_INDEX_MASK;
+    if (index >= owned_.size()) {
+        owned_.resize(index + 1, -1);
+    }
+    s.prev_owned = -1;
+    s.next_owned = owned_[index];
+    if (s.next_owned != -1) {
+        scripts_[s.next_owned].prev_owned = slot;
+    }
+    owned_[index] = slot;
+
+    s.handle.promise().scheduler = this;
+    s.handle.promise().slot = slot;
+    num_scripts_++;
+
+    Run(slot);
+}
+
+
+void BehaviourScheduler::Tick(double delta_time)
+{
+
+    delta_time_ = delta_time;
+    num_resumed_ = 0;
+
+    // Scripts that wait again during this tick go on the fresh ready list for the next one
+    resuming_.swap(ready_);
+    ready_.clear();
+    for (int i = 0; i < resuming_.size(); i++) {
+        const Waiting &w = resuming_[i];
+        if (scripts_[w.slot].handle && scripts_[w.slot].serial == w.serial) {
+            Run(w.slot);
+        }
+    }
+    resuming_.clear();
+}
+
+
+void BehaviourScheduler::Resume(unsigned int slot)
+{
+
+    // Timers of a script are cancelled when it is destroyed, so the slot still holds the same script
+    scripts_[slot].timer = 0;
+
+    // A volley in progress fires its next burst without waking the script
+    if (scripts_[slot].bursts_left > 0) {
+        scripts_[slot].volley.turn++;
+        Volley volley = scripts_[slot].volley;
+        emit_volley_(volley);
+
+        Script &s = scripts_[slot];
+        s.bursts_left--;
+        if (s.bursts_left > 0) {
+            s.timer = timers_->Schedule(volley.interval, TIMER_SCRIPT, slot);
+            return;
+        }
+    }
+
+    Run(slot);
+}
+
+
+void BehaviourScheduler::Kill(Entity owner)
+{
+
+    unsigned int index = owner & ENTITY_INDEX_MASK;
+    if (index >= owned_.size()) {
+        return;
+    }
+
+    int i = owned_[index];
+    while (i != -1) {
+        int next = scripts_[i].next_owned;
+        if (scripts_[i].owner == owner) {
+            // A script can't be destroyed while it is running, it is cleaned up when it suspends
+            if (i == running_) {
+                running_killed_ = true;
+            }
+            else {
+                Destroy(i);
+            }
+        }
+        i = next;
+    }
+}
+
+
+void BehaviourScheduler::Clear(void)
+{
+
+    for (int i = 0; i < scripts_.size(); i++) {
+        if (scripts_[i].handle) {
+            Destroy(i);
+        }
+    }
+    ready_.clear();
+}
+
+
+void BehaviourScheduler::Write(SnapshotWriter &writer)
+{
+
+    static_assert(std::is_trivially_copyable<Script>::value, "Scripts are saved as raw bytes");
+
+    writer.WriteArray(scripts_.data(), (int) scripts_.size());
+    writer.Write(free_);
+    writer.Write(num_scripts_);
+    writer.WriteArray(ready_.data(), (int) ready_.size());
+    writer.WriteArray(owned_.data(), (int) owned_.size());
+    writer.Write(delta_time_);
+    FramePool::Write(writer);
+}
+
+
+void BehaviourScheduler::Read(SnapshotReader &reader)
+{
+
+    // The frames of the current scripts are overwritten with the pool, so they are dropped without being destroyed
+    scripts_.resize(reader.ReadCount(sizeof(Script)));
+    reader.Read(scripts_.data(), sizeof(Script) * scripts_.size());
+    reader.Read(free_);
+    reader.Read(num_scripts_);
+    ready_.resize(reader.ReadCount(sizeof(Waiting)));
+    reader.Read(ready_.data(), sizeof(Waiting) * ready_.size());
+    owned_.resize(reader.ReadCount(sizeof(int)));
+    reader.Read(owned_.data(), sizeof(int) * owned_.size());
+    reader.Read(delta_time_);
+    FramePool::Read(reader);
+}
+
+
+void BehaviourScheduler::WaitTick(int slot)
+{
+
+    Waiting w = { slot, scripts_[slot].serial };
+    ready_.push_back(w);
+}
+
+
+void BehaviourScheduler::WaitDelay(int slot, double seconds)
+{
+
+    Script &s = scripts_[slot];
+    s.timer = timers_->Schedule(seconds, TIMER_SCRIPT, slot);
+}
+
+
+bool BehaviourScheduler::StartVolley(int slot, const Volley &volley)
+{
+
+    // The first burst is fired right away
+    emit_volley_(volley);
+    if (volley.bursts <= 1) {
+        return false;
+    }
+
+    // The rest are fired by the timer, and the script waits until the last one
+    Script &s = scripts_[slot];
+    s.volley = volley;
+    s.bursts_left = volley.bursts - 1;
+    s.timer = timers_->Schedule(volley.interval, TIMER_SCRIPT, slot);
+    return true;
+}
+
+
+void BehaviourScheduler::Run(int slot)
+{
+
+    // Scripts can start other scripts, so remember which one was running before
+    int previous = running_;
+    bool previous_killed = running_killed_;
+
+    running_ = slot;
+    running_killed_ = false;
+    scripts_[slot].handle.resume();
+    num_resumed_++;
+    bool killed = running_killed_;
+
+    running_ = previous;
+    running_killed_ = previous_killed;
+
+    if (killed || scripts_[slot].handle.done()) {
+        Destroy(slot);
+    }
+}
+
+
+void BehaviourScheduler::Destroy(int slot)
+{
+
+    Script &s = scripts_[slot];
+    timers_->Cancel(s.timer);
+    s.handle.destroy();
+    s.handle = NULL;
+
+    // Take it out of its owner's scripts
+    if (s.prev_owned != -1) {
+        scripts_[s.prev_owned].next_owned = s.next_owned;
+    }
+    else {
+        owned_[s.owner & ENTITY_INDEX_MASK] = s.next_owned;
+    }
+    if (s.next_owned != -1) {
+        scripts_[s.next_owned].prev_owned = s.prev_owned;
+    }
+    s.owner = NO_ENTITY;
+    s.bursts_left = 0;
+    s.next_free = free_;
+    free_ = slot;
+    num_scripts_--;
+}
+
+} // namespace game
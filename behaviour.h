@@ -0,0 +1,218 @@
+#ifndef BEHAVIOUR_H_
+#define BEHAVIOUR_H_
+
+#include <coroutine>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "ecs.h"
+#include "timer_wheel.h"
+#include "bullet_pattern.h"
+#include "snapshot.h"
+
+namespace game {
+
+    class BehaviourScheduler;
+
+    /*
+        FramePool hands out the memory for behaviour coroutine frames
+        Frames are rounded up to a few block sizes, and freed blocks are kept on a free list for the next script,
+        so once the pool has warmed up, starting and ending scripts never touches the heap
+    */
+    class FramePool {
+
+        public:
+            static void *Allocate(std::size_t size);
+            static void Free(void *frame, std::size_t size);
+
+            // Number of frames currently handed out
+            static int GetNumLive(void);
+
+            // Bytes taken from the heap for the pool so far
+            static std::size_t GetNumReserved(void);
+
+            // Save or restore every block of the pool, with the frames in them
+            // Frames point into the process, so a restore is only valid in the run that wrote the snapshot
+            static void Write(SnapshotWriter &writer);
+            static void Read(SnapshotReader &reader);
+
+    }; // class FramePool
+
+    /*
+        Behaviour is the return type of an enemy script, a coroutine that runs a little each tick
+        Scripts suspend with co_await on NextTick(), Delay(seconds) or a Volley, and are resumed by the BehaviourScheduler
+    */
+    class Behaviour {
+
+        public:
+            struct promise_type {
+                BehaviourScheduler *scheduler = NULL;
+                int slot = -1;
+
+                Behaviour get_return_object() { return Behaviour(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+                // Scripts wait until the scheduler starts them, and stay around after they finish so the scheduler can clean up
+                std::suspend_always initial_suspend() noexcept { return {}; }
+                std::suspend_always final_suspend() noexcept { return {}; }
+                void return_void() {}
+                void unhandled_exception() { throw; }
+
+                // Frames come from the pool instead of the heap
+                static void *operator new(std::size_t size) { return FramePool::Allocate(size); }
+                static void operator delete(void *frame, std::size_t size) { FramePool::Free(frame, size); }
+            };
+
+            typedef std::coroutine_handle<promise_type> Handle;
+
+            explicit Behaviour(Handle handle) : handle_(handle) {}
+            Behaviour(Behaviour &&other) noexcept : handle_(other.handle_) { other.handle_ = NULL; }
+            ~Behaviour() { if (handle_) handle_.destroy(); }
+
+            Behaviour(const Behaviour &) = delete;
+            Behaviour &operator=(const Behaviour &) = delete;
+
+            // Give up ownership of the coroutine, the scheduler takes it over
+            inline Handle Release(void) { Handle h = handle_; handle_ = NULL; return h; }
+
+        private:
+            Handle handle_;
+
+    }; // class Behaviour
+
+    // Wait for the next tick, co_await returns the tick's delta time
+    struct NextTick {
+        BehaviourScheduler *scheduler = NULL;
+
+        bool await_ready() { return false; }
+        void await_suspend(Behaviour::Handle handle);
+        double await_resume();
+    };
+
+    // Wait for some seconds of simulation time
+    struct Delay {
+        double seconds;
+
+        explicit Delay(double s) : seconds(s) {}
+        bool await_ready() { return seconds <= 0.0; }
+        void await_suspend(Behaviour::Handle handle);
+        void await_resume() {}
+    };
+
+    // Fire a number of bursts of a bullet pattern, waiting interval seconds between bursts
+    // The script continues once the last burst has been fired
+    struct Volley {
+        Entity shooter;
+        BulletPattern pattern;
+        int bursts;
+        double interval;
+
+        // Volleys fired so far, used to turn spiral patterns. Every burst counts as one
+        int turn;
+
+        Volley(Entity s = NO_ENTITY, const BulletPattern &p = BulletPattern(), int b = 1, double i = 0.0, int t = 0)
+            : shooter(s), pattern(p), bursts(b), interval(i), turn(t) {}
+        bool await_ready() { return false; }
+        bool await_suspend(Behaviour::Handle handle);
+        void await_resume() {}
+    };
+
+    /*
+        BehaviourScheduler owns the running scripts and resumes only the ones that are due
+        Scripts waiting for the next tick are kept on a ready list, and scripts waiting for a delay
+        or for the next burst of a volley sit on the simulation's timer wheel until it expires
+    */
+    class BehaviourScheduler {
+
+        public:
+            BehaviourScheduler(void);
+            ~BehaviourScheduler();
+
+            // Set the timer wheel used for delays, and the function that fires volleys
+            void Init(TimerWheel *timers, std::function<void(const Volley &)> emit_volley);
+
+            // Start a script that belongs to an entity, and run it up to its first co_await
+            void Start(Behaviour script, Entity owner);
+
+            // Resume the scripts waiting for this tick
+            void Tick(double delta_time);
+
+            // Handle a TIMER_SCRIPT timer that expired, its target is the script's slot
+            void Resume(unsigned int slot);
+
+            // Stop all the scripts of an entity
+            void Kill(Entity owner);
+
+            // Stop all scripts
+            void Clear(void);
+
+            // Save or restore the scripts, along with the frame pool holding their coroutines
+            // Like the pool, a restore is only valid in the run that wrote the snapshot
+            void Write(SnapshotWriter &writer);
+            void Read(SnapshotReader &reader);
+
+            // Getters
+            inline int GetNumScripts(void) { return num_scripts_; }
+            inline int GetNumResumed(void) { return num_resumed_; }
+            inline double GetDeltaTime(void) { return delta_time_; }
+
+            // Used by the awaitables
+            void WaitTick(int slot);
+            void WaitDelay(int slot, double seconds);
+            bool StartVolley(int slot, const Volley &volley);
+
+        private:
+            struct Script {
+                Behaviour::Handle handle;
+                Entity owner;
+                TimerId timer;
+
+                // Bumped every time the slot is reused, so stale entries of the ready list are skipped
+                unsigned int serial;
+
+                // Volley in progress, and the bursts it has left
+                Volley volley;
+                int bursts_left;
+
+                // Next free slot, when the script is not running
+                int next_free;
+
+                // Neighbours in the list of scripts of the same owner
+                int prev_owned;
+                int next_owned;
+            };
+
+            std::vector<Script> scripts_;
+            int free_;
+            int num_scripts_;
+
+            // First script of each entity, by the index of its handle, so Kill only visits the owner's scripts
+            std::vector<int> owned_;
+
+            // Scripts waiting for the next tick, and the ones being resumed this tick
+            struct Waiting {
+                int slot;
+                unsigned int serial;
+            };
+            std::vector<Waiting> ready_;
+            std::vector<Waiting> resuming_;
+
+            TimerWheel *timers_;
+            std::function<void(const Volley &)> emit_volley_;
+
+            // Slot of the script being resumed, and whether it was killed while running
+            int running_;
+            bool running_killed_;
+
+            double delta_time_;
+            int num_resumed_;
+
+            // Run a script until it suspends again, and clean it up if it finished
+            void Run(int slot);
+            void Destroy(int slot);
+
+    }; // class BehaviourScheduler
+
+} // namespace game
+
+#endif // BEHAVIOUR_H_
@@ -0,0 +1,85 @@
+#include <cmath>
+
+#include "bullet_pattern.h"
+
+namespace game {
+
+// Resolution of the direction table, in entries per degree
+const int directions_per_degree_g = 10;
+const int num_directions_g = 360 * directions_per_degree_g;
+
+// Unit direction for every entry of the table
+struct DirectionTable {
+    float x[num_directions_g];
+    float y[num_directions_g];
+
+    DirectionTable(void) {
+        double pi = atan(1) * 4;
+        for (int i = 0; i < num_directions_g; i++) {
+            double a = (double) i / directions_per_degree_g * pi / 180;
+            x[i] = (float) cos(a);
+            y[i] = (float) sin(a);
+        }
+    }
+};
+static const DirectionTable directions_g;
+
+// Entry of the table for an angle in degrees
+static inline int DirectionIndex(float degrees)
+{
+
+    int i = (int) std::floor(degrees * directions_per_degree_g + 0.5f) % num_directions_g;
+    return i < 0 ? i + num_directions_g : i;
+}
+
+
+int PatternEmitter::Emit(const BulletPattern &pattern, const glm::vec3 &origin, float angle, const glm::vec3 &target, int turn, BulletSpawn *out)
+{
+    int count = pattern.count;
+    if (count <= 0) {
+        return 0;
+    }
+
+    // Work out the angle of the first bullet and the angle between bullets once for the whole volley
+    float center = angle + pattern.offset;
+    float first = center;
+    float step = 0.0f;
+
+    switch (pattern.type) {
+        case PATTERN_SPIRAL:
+            center += pattern.spin * turn;
+            // fall through, a spiral is a turning radial pattern
+        case PATTERN_RADIAL:
+            first = center;
+            step = 360.0f / count;
+            break;
+        case PATTERN_AIMED: {
+            // Bullets fly towards angle + 90 degrees, see the direction below
+            glm::vec3 to_target = target - origin;
+            center = (float) (atan2(to_target.y, to_target.x) * 180 / (atan(1) * 4)) - 90.0f + pattern.offset;
+        }
+            // fall through, an aimed pattern is a spread around the target
+        case PATTERN_SPREAD:
+            if (count > 1) {
+                first = center - pattern.arc * 0.5f;
+                step = pattern.arc / (count - 1);
+            }
+            else {
+                first = center;
+            }
+            break;
+    }
+
+    // An angle of 0 points up the screen, so the direction is turned by 90 degrees
+    for (int i = 0; i < count; i++) {
+        float a = first + i * step;
+        int d = DirectionIndex(a + 90.0f);
+        out[i].position = origin;
+        out[i].velocity = glm::vec3(directions_g.x[d] * pattern.speed, directions_g.y[d] * pattern.speed, 0.0f);
+        out[i].angle = a;
+    }
+
+    return count;
+}
+
+} // namespace game
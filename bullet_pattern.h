@@ -0,0 +1,51 @@
+#ifndef BULLET_PATTERN_H_
+#define BULLET_PATTERN_H_
+
+#include <glm/glm.hpp>
+
+namespace game {
+
+    // Shapes of volleys
+    enum PatternType {
+        PATTERN_RADIAL,     // count bullets evenly spaced around a full circle
+        PATTERN_SPREAD,     // count bullets fanned out over arc degrees, centered on the shooter's angle
+        PATTERN_SPIRAL,     // a radial pattern that turns by spin degrees every volley
+        PATTERN_AIMED       // a spread centered on the target instead of the shooter's angle
+    };
+
+    // Declarative description of one volley
+    // Angles are in degrees, relative to the shooter's angle (0 fires up, like the player)
+    struct BulletPattern {
+        PatternType type;
+        int count;
+        float arc;
+        float speed;
+        float offset;
+        float spin;
+    };
+
+    // Where a bullet of a volley starts and where it goes
+    struct BulletSpawn {
+        glm::vec3 position;
+        glm::vec3 velocity;
+        float angle;
+    };
+
+    /*
+        PatternEmitter turns a pattern into the bullets of a whole volley in one call
+        Directions come from a precomputed table (one entry per tenth of a degree), so even volleys
+        of hundreds of bullets need no trigonometry per bullet
+    */
+    class PatternEmitter {
+
+        public:
+            // Write the bullets of one volley into out, which must have room for pattern.count bullets
+            // turn counts the volleys fired so far, and is used to turn spiral patterns
+            // Returns the number of bullets written
+            static int Emit(const BulletPattern &pattern, const glm::vec3 &origin, float angle, const glm::vec3 &target, int turn, BulletSpawn *out);
+
+    }; // class PatternEmitter
+
+} // namespace game
+
+#endif // BULLET_PATTERN_H_
@@ -0,0 +1,228 @@
+#include <stdexcept>
+#include <string>
+
+#include "state_hash.h"
+#include "bullet_system.h"
+
+namespace game {
+
+// Radius every bullet collides with
+const float bullet_radius_g = 0.2f;
+
+// Read an array written by WriteArray into a vector
+template<class T> static void ReadVector(SnapshotReader &reader, std::vector<T> &vector)
+{
+
+    vector.resize(reader.ReadCount(sizeof(T)));
+    reader.Read(vector.data(), sizeof(T) * vector.size());
+}
+
+
+BulletSystem::BulletSystem(void)
+{
+
+    num_killed_ = 0;
+}
+
+
+void BulletSystem::Spawn(const glm::vec3 &position, const glm::vec3 &velocity, float angle, int side, TextureHandle texture)
+{
+
+    // The few bullet textures each get a small index, so a bullet only needs a byte for its sprite
+    int sprite = 0;
+    while (sprite < textures_.size() && textures_[sprite].index != texture.index) {
+        sprite++;
+    }
+    if (sprite == textures_.size()) {
+        textures_.push_back(texture);
+    }
+
+    x_.push_back(position.x);
+    y_.push_back(position.y);
+    vx_.push_back(velocity.x);
+    vy_.push_back(velocity.y);
+    angle_.push_back(angle);
+    side_.push_back((unsigned char) side);
+    sprite_.push_back((unsigned char) sprite);
+}
+
+
+void BulletSystem::Update(float delta_time)
+{
+
+    // Killed bullets move too, it costs less than skipping them
+    int count = GetCount();
+    float *x = x_.data();
+    float *y = y_.data();
+    const float *vx = vx_.data();
+    const float *vy = vy_.data();
+    for (int i = 0; i < count; i++) {
+        x[i] += vx[i] * delta_time;
+        y[i] += vy[i] * delta_time;
+    }
+}
+
+
+void BulletSystem::Cull(float left, float right, float bottom, float top)
+{
+
+    int count = GetCount();
+    const float *x = x_.data();
+    const float *y = y_.data();
+    unsigned char *side = side_.data();
+    int killed = 0;
+    for (int i = 0; i < count; i++) {
+        unsigned char outside = (x[i] < left) | (x[i] > right) | (y[i] < bottom) | (y[i] > top);
+        killed += outside & (side[i] != KILLED);
+        side[i] = outside ? (unsigned char) KILLED : side[i];
+    }
+    num_killed_ += killed;
+}
+
+
+int BulletSystem::Query(int side, const glm::vec3 &center, float radius, std::pmr::vector<int> &hits)
+{
+
+    // Test every bullet first, then gather the ones that hit
+    int count = GetCount();
+    hit_.resize(count);
+    const float *x = x_.data();
+    const float *y = y_.data();
+    const unsigned char *sides = side_.data();
+    unsigned char *hit = hit_.data();
+    float cx = center.x;
+    float cy = center.y;
+    float reach = (radius + bullet_radius_g) * (radius + bullet_radius_g);
+    for (int i = 0; i < count; i++) {
+        float dx = x[i] - cx;
+        float dy = y[i] - cy;
+        hit[i] = (dx * dx + dy * dy < reach) & (sides[i] == side);
+    }
+
+    hits.clear();
+    for (int i = 0; i < count; i++) {
+        if (hit[i]) {
+            hits.push_back(i);
+        }
+    }
+    return (int) hits.size();
+}
+
+
+void BulletSystem::Kill(int bullet)
+{
+
+    if (side_[bullet] != KILLED) {
+        side_[bullet] = KILLED;
+        num_killed_++;
+    }
+}
+
+
+void BulletSystem::Flush(void)
+{
+
+    if (num_killed_ == 0) {
+        return;
+    }
+
+    // Slide the living bullets down over the killed ones
+    int count = GetCount();
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (side_[i] == KILLED) {
+            continue;
+        }
+        x_[kept] = x_[i];
+        y_[kept] = y_[i];
+        vx_[kept] = vx_[i];
+        vy_[kept] = vy_[i];
+        angle_[kept] = angle_[i];
+        side_[kept] = side_[i];
+        sprite_[kept] = sprite_[i];
+        kept++;
+    }
+    x_.resize(kept);
+    y_.resize(kept);
+    vx_.resize(kept);
+    vy_.resize(kept);
+    angle_.resize(kept);
+    side_.resize(kept);
+    sprite_.resize(kept);
+    num_killed_ = 0;
+}
+
+
+void BulletSystem::Clear(void)
+{
+
+    x_.clear();
+    y_.clear();
+    vx_.clear();
+    vy_.clear();
+    angle_.clear();
+    side_.clear();
+    sprite_.clear();
+    num_killed_ = 0;
+}
+
+
+unsigned long long BulletSystem::Hash(void)
+{
+
+    // The arrays hold no padding, so they are hashed whole
+    unsigned long long hash = HashValue(HASH_SEED, GetCount());
+    hash = HashBytes(hash, x_.data(), x_.size() * sizeof(float));
+    hash = HashBytes(hash, y_.data(), y_.size() * sizeof(float));
+    hash = HashBytes(hash, vx_.data(), vx_.size() * sizeof(float));
+    hash = HashBytes(hash, vy_.data(), vy_.size() * sizeof(float));
+    hash = HashBytes(hash, angle_.data(), angle_.size() * sizeof(float));
+    hash = HashBytes(hash, side_.data(), side_.size());
+    for (int i = 0; i < sprite_.size(); i++) {
+        hash = HashValue(hash, textures_[sprite_[i]].index);
+    }
+    return hash;
+}
+
+
+void BulletSystem::Write(SnapshotWriter &writer)
+{
+
+    writer.WriteArray(x_.data(), (int) x_.size());
+    writer.WriteArray(y_.data(), (int) y_.size());
+    writer.WriteArray(vx_.data(), (int) vx_.size());
+    writer.WriteArray(vy_.data(), (int) vy_.size());
+    writer.WriteArray(angle_.data(), (int) angle_.size());
+    writer.WriteArray(side_.data(), (int) side_.size());
+    writer.WriteArray(sprite_.data(), (int) sprite_.size());
+    writer.WriteArray(textures_.data(), (int) textures_.size());
+    writer.Write(num_killed_);
+}
+
+
+void BulletSystem::Read(SnapshotReader &reader)
+{
+
+    ReadVector(reader, x_);
+    ReadVector(reader, y_);
+    ReadVector(reader, vx_);
+    ReadVector(reader, vy_);
+    ReadVector(reader, angle_);
+    ReadVector(reader, side_);
+    ReadVector(reader, sprite_);
+    ReadVector(reader, textures_);
+    reader.Read(num_killed_);
+
+    // Every array has one entry per bullet, and every sprite names a texture
+    int count = GetCount();
+    bool valid = y_.size() == count && vx_.size() == count && vy_.size() == count && angle_.size() == count &&
+        side_.size() == count && sprite_.size() == count;
+    for (int i = 0; valid && i < count; i++) {
+        valid = sprite_[i] < textures_.size();
+    }
+    if (!valid) {
+        throw(std::runtime_error(std::string("Snapshot has damaged bullets")));
+    }
+}
+
+} // namespace game
@@ -0,0 +1,91 @@
+#ifndef BULLET_SYSTEM_H_
+#define BULLET_SYSTEM_H_
+
+#include <glm/glm.hpp>
+#include <memory_resource>
+#include <vector>
+
+#include "resource_manager.h"
+#include "snapshot.h"
+
+namespace game {
+
+    // Who fired a bullet, which decides what it can hit
+    enum BulletSide {
+        BULLET_PLAYER,
+        BULLET_ENEMY
+    };
+
+    /*
+        BulletSystem keeps the bullets out of the world, as plain fields in parallel arrays
+        A bullet is only its position, velocity, angle, side and sprite, 22 bytes in all. Every bullet has the same
+        size and collision radius, so those aren't stored
+        Moving, culling and the collision queries are branch free passes over whole arrays, which the compiler vectorizes
+        Killed bullets stay where they are until Flush, so indices hold for the rest of the tick, and the bullets
+        that are left keep the order they were fired in
+    */
+    class BulletSystem {
+
+        public:
+            BulletSystem(void);
+
+            // Fire a bullet. Bullets can use a handful of different textures
+            void Spawn(const glm::vec3 &position, const glm::vec3 &velocity, float angle, int side, TextureHandle texture);
+
+            // Move every bullet
+            void Update(float delta_time);
+
+            // Kill the bullets outside a rectangle of the world
+            void Cull(float left, float right, float bottom, float top);
+
+            // Find the living bullets of a side that touch a circle, in the order they were fired. Returns how many there are
+            int Query(int side, const glm::vec3 &center, float radius, std::pmr::vector<int> &hits);
+
+            // Kill a bullet, it is removed by the next Flush
+            void Kill(int bullet);
+
+            // Remove the killed bullets. Call it at the end of the tick
+            void Flush(void);
+
+            // Remove every bullet
+            void Clear(void);
+
+            // Hash of every bullet, for checking that two runs match
+            unsigned long long Hash(void);
+
+            // Save or restore every bullet as part of a game snapshot
+            void Write(SnapshotWriter &writer);
+            void Read(SnapshotReader &reader);
+
+            // Getters
+            inline int GetCount(void) { return (int) x_.size(); }
+            inline bool IsAlive(int bullet) { return side_[bullet] != KILLED; }
+            inline glm::vec3 GetPosition(int bullet) { return glm::vec3(x_[bullet], y_[bullet], 0.0f); }
+            inline float GetAngle(int bullet) { return angle_[bullet]; }
+            inline TextureHandle GetTexture(int bullet) { return textures_[sprite_[bullet]]; }
+
+        private:
+            // Side of a bullet that was killed
+            enum { KILLED = 255 };
+
+            std::vector<float> x_;
+            std::vector<float> y_;
+            std::vector<float> vx_;
+            std::vector<float> vy_;
+            std::vector<float> angle_;
+            std::vector<unsigned char> side_;
+
+            // Index of the texture in textures_
+            std::vector<unsigned char> sprite_;
+            std::vector<TextureHandle> textures_;
+
+            // Whether the query of each bullet hit, reused between queries
+            std::vector<unsigned char> hit_;
+
+            int num_killed_;
+
+    }; // class BulletSystem
+
+} // namespace game
+
+#endif // BULLET_SYSTEM_H_
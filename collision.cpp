@@ -1,30 +1,31 @@
 
+#include <cmath>
+
+#include "arena.h"
 #include "collision.h"
 
 namespace game {
 
-    bool distanceCheck(GameObject* o1, GameObject* o2, float distance)
+    bool distanceCheck(const glm::vec3 &p1, const glm::vec3 &p2, float distance)
     {
 
-        if (glm::length(o1->GetPosition() - o2->GetPosition()) < distance) {
+        if (glm::length(p1 - p2) < distance) {
             return true;
         }
 
         return false;
     }
 
-    bool RayCircleCollision(GameObject* r, GameObject* c, float delta_time) {
-
-        float px = r->GetPosition()[0];
-        float py = r->GetPosition()[1];
+    bool RayCircleCollision(const glm::vec3 &position, const glm::vec3 &velocity, const glm::vec3 &center, float radius, float delta_time) {
 
-        float vx = r->GetVelocity()[0];
-        float vy = r->GetVelocity()[1];
+        float px = position[0];
+        float py = position[1];
 
-        float cx = c->GetPosition()[0];
-        float cy = c->GetPosition()[1];
+        float vx = velocity[0];
+        float vy = velocity[1];
 
-        float radius = c->GetRadius();
+        float cx = center[0];
+        float cy = center[1];
 
         //std::printf("input:\n");
         //std::printf("Px: %f, Py: %f\n", px, py);
@@ -96,218 +97,89 @@ namespace game {
         return false;
     }
 
-    bool CircleCircleCollision(GameObject* c1, GameObject* c2) {
+    bool CircleCircleCollision(const glm::vec3 &p1, float r1, const glm::vec3 &p2, float r2) {
 
-        if (glm::length(c1->GetPosition() - c2->GetPosition()) < c1->GetRadius() + c2->GetRadius()) {
+        if (glm::length(p1 - p2) < r1 + r2) {
             return true;
         }
 
         return false;
     }
 
-    void CheckAllCollisions(std::vector<GameObject*>& gameObjects, float delta_time) {
-
-        //printf("check all collisions");
-
-        //loop over each game object
-        for (int i = 0; i < gameObjects.size(); i++) {
-
-            // Get the current game object
-            GameObject* current_game_object = gameObjects[i];
-
-            // Check for collision with other game objects
-            for (int j = i + 1; j < gameObjects.size(); j++) {
-
-                // Get the other game object
-                GameObject* other_game_object = gameObjects[j];
-
-                //check type of collision
-                int collision_type = CheckCollisionType(current_game_object->GetTag(), other_game_object->GetTag());
-
-                //check for collition if there is a type
-                bool collision = false;
-                if (collision_type == 1) {
-                    collision = CircleCircleCollision(current_game_object, other_game_object);
-                }
-                else if (collision_type == 2) {
-                    collision = RayCircleCollision(current_game_object, other_game_object, delta_time);
-                    //printf("checked for ray circle colision\n");
-                }
-                else if (collision_type == 3) {
-                    collision = RayCircleCollision(other_game_object, current_game_object, delta_time);
-                }
-
-                if (collision) {
-
-                    CollisionResponce(current_game_object, other_game_object, gameObjects, delta_time);
-
+    // A collider gathered for the checks of one tick
+    struct Body {
+        Entity entity;
+        glm::vec3 position;
+        float radius;
+        int kind;
+    };
+
+    void CheckAllCollisions(World &world, std::pmr::vector<Contact> &contacts) {
+
+        Arena &scratch = ScratchArena();
+        ArenaScope scope(scratch);
+
+        // Gather the colliders, once for each kind they are
+        std::pmr::vector<Body> gathered(&scratch);
+        gathered.reserve(world.GetNumEntities());
+        int start[NUM_COLLIDER_KINDS + 1] = { 0 };
+
+        world.Each<Transform, Collider>([&](Entity entity, Transform &transform, Collider &collider) {
+            for (int k = 0; k < NUM_COLLIDER_KINDS; k++) {
+                if (collider.kind & (1 << k)) {
+                    Body body = { entity, transform.position, collider.radius, k };
+                    gathered.push_back(body);
+                    start[k + 1]++;
                 }
-
-
             }
-        }
-
-        return;
-
-    }
-
-    int CheckCollisionType(std::string tag1, std::string tag2) {
-
-        //checking for any combination of objects that might collide
-        if (tag1 == "player" && tag2 == "plane") {
-            return 1;
-        }
-        else if (tag1 == "player" && tag2 == "plane2") {
-            return 1;
-        }
-        else if (tag1 == "plane" && tag2 == "bullet_p") {
-            return 1;
-        }
-        else if (tag1 == "plane2" && tag2 == "bullet_p") {
-            return 1;
-        }
-        else if (tag1 == "plane3" && tag2 == "bullet_p") {
-            return 1;
-        }
-        else if (tag1 == "plane4" && tag2 == "bullet_p") {
-            return 1;
-        }
-        else if (tag1 == "planeboss" && tag2 == "bullet_p") {
-            return 1;
-        }
-        else if (tag1 == "bullet_p" && tag2 == "plane") {
-            return 1;
-        }
-        else if (tag1 == "bullet_p" && tag2 == "plane2") {
-            return 1;
-        }
-        else if (tag1 == "bullet_p" && tag2 == "plane3") {
-            return 1;
-        }
-        else if (tag1 == "bullet_p" && tag2 == "plane4") {
-            return 1;
-        }
-        else if (tag1 == "bullet_p" && tag2 == "planeboss") {
-            return 1;
-        }
-        else if (tag1 == "player" && tag2 == "health") {
-            return 1;
-        }
-        else if (tag1 == "player" && tag2 == "shield") {
-            return 1;
-        }
-        else if (tag1 == "player" && tag2 == "bullet_e") {
-            return 1;
-        }
-
-      
+        });
 
-    }
-
-    void CollisionResponce(GameObject* current_game_object, GameObject* other_game_object, std::vector<GameObject*>& gameObjects, float delta_time) {
-
-        std::string tag1 = current_game_object->GetTag();
-        std::string tag2 = other_game_object->GetTag();
-
-        //checking for combinations of objects and performing appropriate responce 
-        //if the object needs to be despawned it is moved far of the screan so it is removed in the update function when
-        //it is checked if it is out of bounds
-        if (tag1 == "player" && (tag2 == "plane" || tag2 == "plane2" || tag2 == "plane3" || tag2 == "plane4")) {
-            PlayerGameObject* player = dynamic_cast<PlayerGameObject*>(current_game_object);
-            player->subtractHealth(1);
-            other_game_object->SetPosition(glm::vec3(100, 0, 0));
+        // Sort them by kind, so only the kinds that can touch are checked against each other
+        for (int k = 0; k < NUM_COLLIDER_KINDS; k++) {
+            start[k + 1] += start[k];
         }
-        else if ((tag2 == "plane" || tag2 == "plane2" || tag2 == "plane3" || tag2 == "plane4") && tag2 == "player") {
-            PlayerGameObject* player = dynamic_cast<PlayerGameObject*>(other_game_object);
-            player->subtractHealth(1);
-            current_game_object->SetPosition(glm::vec3(100, 0, 0));
+        int next[NUM_COLLIDER_KINDS];
+        for (int k = 0; k < NUM_COLLIDER_KINDS; k++) {
+            next[k] = start[k];
         }
-        else if (tag1 == "bullet_p" && tag2 == "plane") {
-            //printf("collision between bullet and plane\n");
-            other_game_object->SetPosition(glm::vec3(100, 0, 0));
-            current_game_object->SetPosition(glm::vec3(-100, 0, 0));
-
-        }
-        else if (tag1 == "bullet_p" && tag2 == "plane2") {
-            //printf("collision between bullet and plane\n");
-            other_game_object->SetPosition(glm::vec3(100, 0, 0));
-            current_game_object->SetPosition(glm::vec3(-100, 0, 0));
-
+        Body *bodies = scratch.Allocate<Body>((int) gathered.size());
+        for (int i = 0; i < gathered.size(); i++) {
+            bodies[next[gathered[i].kind]++] = gathered[i];
         }
-        else if (tag1 == "bullet_p" && tag2 == "plane3") {
-            //printf("collision between bullet and plane\n");
-            other_game_object->SetPosition(glm::vec3(100, 0, 0));
-            current_game_object->SetPosition(glm::vec3(-100, 0, 0));
 
-        }
-        else if (tag1 == "bullet_p" && tag2 == "plane4") {
-            //printf("collision between bullet and plane\n");
-            other_game_object->SetPosition(glm::vec3(100, 0, 0));
-            current_game_object->SetPosition(glm::vec3(-100, 0, 0));
+        for (int k1 = 0; k1 < NUM_COLLIDER_KINDS; k1++) {
+            int targets = CheckCollisionType(1 << k1);
 
-        }
-        else if (tag1 == "bullet_p" && tag2 == "planeboss") {
-            //printf("collision between bullet and plane\n");
-
-            current_game_object->SetPosition(glm::vec3(-100, 0, 0));
-            other_game_object->subtractHealth(1);
+            for (int k2 = 0; k2 < NUM_COLLIDER_KINDS; k2++) {
+                if (!(targets & (1 << k2))) {
+                    continue;
+                }
 
-            if (other_game_object->getHealth() <= 0) {
-                other_game_object->SetPosition(glm::vec3(100, 0, 0));
+                // check every pair of the two kinds
+                for (int i = start[k1]; i < start[k1 + 1]; i++) {
+                    const Body &b1 = bodies[i];
+                    for (int j = start[k2]; j < start[k2 + 1]; j++) {
+                        const Body &b2 = bodies[j];
+                        if (CircleCircleCollision(b1.position, b1.radius, b2.position, b2.radius)) {
+                            Contact contact = { b1.entity, b2.entity, 1 << k1, 1 << k2 };
+                            contacts.push_back(contact);
+                        }
+                    }
+                }
             }
-
-        }
-        else if (tag1 == "plane" && tag2 == "bullet_p") {
-            //printf("collision between plane and bullet\n");
-            other_game_object->SetPosition(glm::vec3(100, 0, 0));
-            current_game_object->SetPosition(glm::vec3(-100, 0, 0));
-        }
-        else if (tag1 == "plane2" && tag2 == "bullet_p") {
-            //printf("collision between plane and bullet\n");
-            other_game_object->SetPosition(glm::vec3(100, 0, 0));
-            current_game_object->SetPosition(glm::vec3(-100, 0, 0));
-        }
-        else if (tag1 == "plane3" && tag2 == "bullet_p") {
-            //printf("collision between plane and bullet\n");
-            other_game_object->SetPosition(glm::vec3(100, 0, 0));
-            current_game_object->SetPosition(glm::vec3(-100, 0, 0));
         }
-        else if (tag1 == "plane4" && tag2 == "bullet_p") {
-            //printf("collision between plane and bullet\n");
-            other_game_object->SetPosition(glm::vec3(100, 0, 0));
-            current_game_object->SetPosition(glm::vec3(-100, 0, 0));
-        }
-        else if (tag1 == "planeboss" && tag2 == "bullet_p") {
-            //printf("collision between plane and bullet\n");
 
-            other_game_object->SetPosition(glm::vec3(-100, 0, 0));
-            current_game_object->subtractHealth(1);
+    }
 
-            if (current_game_object->getHealth() <= 0) {
-                current_game_object->SetPosition(glm::vec3(100, 0, 0));
-            }
-        }
-        else if (tag1 == "player" && tag2 == "health") {
-            PlayerGameObject* player = dynamic_cast<PlayerGameObject*>(current_game_object);
-            player->addHealth(1);
-            other_game_object->SetPosition(glm::vec3(100,0,0));
-        }
-        else if (tag1 == "player" && tag2 == "shield") {
-            PlayerGameObject* player = dynamic_cast<PlayerGameObject*>(current_game_object);
-            player->addShieldTimer(5);
-            
-            for (int i = 0; i < player->child_.size(); i++) {
-                player->child_[i]->SetScale(0.2f);
-            }
+    int CheckCollisionType(int kind) {
 
-            other_game_object->SetPosition(glm::vec3(100, 0, 0));
-        }
-        else if (tag1 == "player" && tag2 == "bullet_e") {
-            PlayerGameObject* player = dynamic_cast<PlayerGameObject*>(current_game_object);
-            player->subtractHealth(1);
-            other_game_object->SetPosition(glm::vec3(100, 0, 0));
+        //checking what a kind of object might collide with
+        //every pair is only listed once, on the side of the first kind
+        if (kind == COLLIDE_PLAYER) {
+            return COLLIDE_ENEMY | COLLIDE_PICKUP;
         }
 
+        return COLLIDE_NONE;
     }
 
-}
\ No newline at end of file
+}
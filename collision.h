@@ -1,24 +1,33 @@
 #ifndef COLLISION_H_
 #define COLLISION_H_
 
-#include "collision.h"
-#include "game_object.h"
-#include "game.h"
+#include <glm/glm.hpp>
+#include <memory_resource>
 #include <vector>
-#include "player_game_object.h"
-#include <string>
+
+#include "ecs.h"
+#include "components.h"
 
 namespace game {
 
-	bool distanceCheck(GameObject* o1, GameObject* o2, float distance);
-	bool RayCircleCollision(GameObject* r, GameObject* c, float delta_time);
-	bool CircleCircleCollision(GameObject* c1, GameObject* c2);
+	// Two entities that touched, a has the first collider kind of the pair and b the second
+	struct Contact {
+		Entity a;
+		Entity b;
+		int kind_a;
+		int kind_b;
+	};
 
-	void CheckAllCollisions(std::vector<GameObject*>& gameObjects, float delta_time);
+	bool distanceCheck(const glm::vec3 &p1, const glm::vec3 &p2, float distance);
+	bool RayCircleCollision(const glm::vec3 &position, const glm::vec3 &velocity, const glm::vec3 &center, float radius, float delta_time);
+	bool CircleCircleCollision(const glm::vec3 &p1, float r1, const glm::vec3 &p2, float r2);
 
-	int CheckCollisionType(std::string tag1, std::string tag2);
+	// Detect every contact between colliders whose kinds can touch
+	// The responses are left to the game. The temporaries of the checks come from the thread's scratch arena
+	void CheckAllCollisions(World &world, std::pmr::vector<Contact> &contacts);
 
-	void CollisionResponce(GameObject* current_game_object, GameObject* other_game_object, std::vector<GameObject*>& gameObjects, float delta_time);
+	// Kinds of colliders that a kind collides with
+	int CheckCollisionType(int kind);
 
 } // namespace game
 
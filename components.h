@@ -0,0 +1,140 @@
+#ifndef COMPONENTS_H_
+#define COMPONENTS_H_
+
+#include <glm/glm.hpp>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "ecs.h"
+#include "resource_manager.h"
+#include "timer_wheel.h"
+
+namespace game {
+
+    // Components of the game's entities
+    // They are plain data, all of the logic is in the systems of the Game class
+
+    // Where an entity is, and how it is turned and scaled
+    struct Transform {
+        enum { ID = 0 };
+        glm::vec3 position;
+        float angle;
+        float scale;
+    };
+
+    // Moves the transform every tick
+    struct Motion {
+        enum { ID = 1 };
+        glm::vec3 velocity;
+    };
+
+    // Order sprites are drawn in. With the depth test, whatever is drawn first stays on top
+    enum SpriteLayer {
+        LAYER_HUD,
+        LAYER_SHIELD,
+        LAYER_ORBIT,
+        LAYER_PLAYER,
+        LAYER_OBJECTS,
+        NUM_SPRITE_LAYERS
+    };
+
+    struct Sprite {
+        enum { ID = 2 };
+        TextureHandle texture;
+        int layer;
+    };
+
+    // What an entity is for the collision checks
+    // Bullets aren't entities, they are checked by the BulletSystem
+    enum ColliderKind {
+        COLLIDE_NONE = 0,
+        COLLIDE_PLAYER = 1 << 0,
+        COLLIDE_ENEMY = 1 << 1,
+        COLLIDE_BOSS = 1 << 2,
+        COLLIDE_PICKUP = 1 << 3
+    };
+
+    // Number of ColliderKind bits, keep it in step with the last kind
+    const int NUM_COLLIDER_KINDS = 4;
+    static_assert(COLLIDE_PICKUP == 1 << (NUM_COLLIDER_KINDS - 1), "NUM_COLLIDER_KINDS must count every collider kind");
+
+    struct Collider {
+        enum { ID = 3 };
+        float radius;
+        int kind;
+    };
+
+    struct Health {
+        enum { ID = 4 };
+        int health;
+    };
+
+    struct Player {
+        enum { ID = 5 };
+        int weapon_type;
+        double rof;
+
+        // Weapon cooldown and shield countdown, on the simulation's timer wheel
+        TimerId cooldown;
+        TimerId shield;
+    };
+
+    enum EnemyKind {
+        ENEMY_PLANE,
+        ENEMY_SPINNER,
+        ENEMY_SIDESTEPPER,
+        ENEMY_SIDESHOT,
+        ENEMY_BOSS
+    };
+
+    struct Enemy {
+        enum { ID = 6 };
+        int kind;
+        double rof;
+    };
+
+    enum PickupKind {
+        PICKUP_HEALTH,
+        PICKUP_SHIELD
+    };
+
+    struct Pickup {
+        enum { ID = 8 };
+        int kind;
+    };
+
+    enum HudKind {
+        HUD_TITLE,
+        HUD_BAR,
+        HUD_ARROW,
+        HUD_WIN,
+        HUD_LOSE,
+        HUD_WEAPON1,
+        HUD_WEAPON2,
+        HUD_HEART
+    };
+
+    // Part of the heads up display, which follows the player
+    struct Hud {
+        enum { ID = 9 };
+        int kind;
+    };
+
+    // Drawn relative to a parent entity
+    // Orbiting entities turn around the parent, the others turn on their own anchor
+    struct Attach {
+        enum { ID = 10 };
+        Entity parent;
+        int orbit;
+        float spin;
+    };
+
+    // Only shown while the parent's shield is up, at the given scale
+    struct ShieldPart {
+        enum { ID = 11 };
+        float scale;
+    };
+
+} // namespace game
+
+#endif // COMPONENTS_H_
@@ -0,0 +1,188 @@
+/*
+ *
+ * Compares the hash logs of two runs of the game, and reports the first tick where they differ
+ *
+ * Usage: desync <first log> <second log>
+ * Logs are written by the game when GAME_HASH_LOG names a file. With GAME_HASH_DETAIL=1 they also
+ * hold the values of every entity, and the fields that differ at the first divergent tick are listed
+ *
+ */
+
+#include <iostream>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#include "state_hash.h"
+
+using namespace game;
+
+// Most differences listed for one tick
+const int max_differences_g = 50;
+
+// Fields of an entity that are compared
+struct EntityField {
+    const char *name;
+    std::size_t offset;
+    bool is_float;
+};
+const EntityField entity_fields_g[] = {
+    { "mask", offsetof(EntityState, mask), false },
+    { "position.x", offsetof(EntityState, position) + 0 * sizeof(float), true },
+    { "position.y", offsetof(EntityState, position) + 1 * sizeof(float), true },
+    { "position.z", offsetof(EntityState, position) + 2 * sizeof(float), true },
+    { "angle", offsetof(EntityState, angle), true },
+    { "scale", offsetof(EntityState, scale), true },
+    { "velocity.x", offsetof(EntityState, velocity) + 0 * sizeof(float), true },
+    { "velocity.y", offsetof(EntityState, velocity) + 1 * sizeof(float), true },
+    { "velocity.z", offsetof(EntityState, velocity) + 2 * sizeof(float), true },
+    { "health", offsetof(EntityState, health), false }
+};
+const int num_entity_fields_g = sizeof(entity_fields_g) / sizeof(entity_fields_g[0]);
+
+struct Log {
+    std::vector<TickHash> ticks;
+    std::vector<int> offsets;
+    std::vector<EntityState> entities;
+};
+
+static bool EntityLess(const EntityState &a, const EntityState &b)
+{
+
+    return a.entity < b.entity;
+}
+
+
+// List the fields that differ between the entities of the two runs at a tick
+static void DiffEntities(const Log &a, int ia, const Log &b, int ib)
+{
+
+    if (a.ticks[ia].num_entities == 0 || b.ticks[ib].num_entities == 0) {
+        printf("  no entity values in the logs, run the game with GAME_HASH_DETAIL=1 for a field level diff\n");
+        return;
+    }
+
+    // Entities are matched by their handle
+    std::vector<EntityState> ea(a.entities.begin() + a.offsets[ia], a.entities.begin() + a.offsets[ia] + a.ticks[ia].num_entities);
+    std::vector<EntityState> eb(b.entities.begin() + b.offsets[ib], b.entities.begin() + b.offsets[ib] + b.ticks[ib].num_entities);
+    std::sort(ea.begin(), ea.end(), EntityLess);
+    std::sort(eb.begin(), eb.end(), EntityLess);
+
+    int differences = 0;
+    int i = 0, j = 0;
+    while ((i < ea.size() || j < eb.size()) && differences < max_differences_g) {
+        if (j == eb.size() || (i < ea.size() && ea[i].entity < eb[j].entity)) {
+            printf("  entity 0x%08X only in the first run\n", ea[i].entity);
+            differences++;
+            i++;
+            continue;
+        }
+        if (i == ea.size() || eb[j].entity < ea[i].entity) {
+            printf("  entity 0x%08X only in the second run\n", eb[j].entity);
+            differences++;
+            j++;
+            continue;
+        }
+
+        const char *pa = (const char *) &ea[i];
+        const char *pb = (const char *) &eb[j];
+        for (int f = 0; f < num_entity_fields_g && differences < max_differences_g; f++) {
+            const EntityField &field = entity_fields_g[f];
+            if (field.is_float) {
+                float va = *(const float *) (pa + field.offset);
+                float vb = *(const float *) (pb + field.offset);
+                if (va != vb) {
+                    printf("  entity 0x%08X %s: %.9g vs %.9g\n", ea[i].entity, field.name, va, vb);
+                    differences++;
+                }
+            }
+            else {
+                unsigned int va = *(const unsigned int *) (pa + field.offset);
+                unsigned int vb = *(const unsigned int *) (pb + field.offset);
+                if (va != vb) {
+                    printf("  entity 0x%08X %s: %u vs %u\n", ea[i].entity, field.name, va, vb);
+                    differences++;
+                }
+            }
+        }
+        i++;
+        j++;
+    }
+
+    if (differences == 0) {
+        printf("  every entity value matches, the difference is in state that only the hashes cover\n");
+    }
+    else if (differences == max_differences_g) {
+        printf("  ... (only the first %d differences are listed)\n", max_differences_g);
+    }
+}
+
+
+// Compare two logs, returns true if they match
+static bool Compare(const Log &a, const Log &b)
+{
+
+    // Walk both logs by tick
+    int ia = 0, ib = 0, compared = 0;
+    while (ia < a.ticks.size() && ib < b.ticks.size()) {
+        const TickHash &ta = a.ticks[ia];
+        const TickHash &tb = b.ticks[ib];
+        if (ta.tick != tb.tick) {
+            printf("Tick %u is only in the %s run\n", std::min(ta.tick, tb.tick), (ta.tick < tb.tick) ? "first" : "second");
+            return false;
+        }
+
+        if (ta.total != tb.total) {
+            printf("First divergent tick: %u (after %d matching ticks)\n", ta.tick, compared);
+            for (int p = 0; p < MAX_PLAYERS; p++) {
+                if (ta.inputs[p] != tb.inputs[p]) {
+                    printf("  input of player %d: 0x%02X vs 0x%02X\n", p + 1, ta.inputs[p], tb.inputs[p]);
+                }
+            }
+            printf("  differing parts:");
+            for (int p = 0; p < NUM_HASH_PARTS; p++) {
+                if (ta.parts[p] != tb.parts[p]) {
+                    printf(" %s", HashPartName(p));
+                }
+            }
+            printf("\n");
+            DiffEntities(a, ia, b, ib);
+            return false;
+        }
+
+        compared++;
+        ia++;
+        ib++;
+    }
+
+    if (ia < a.ticks.size() || ib < b.ticks.size()) {
+        printf("Runs match for %d ticks, then the %s run goes on longer\n", compared, (ia < a.ticks.size()) ? "first" : "second");
+    }
+    else {
+        printf("Runs match for all %d ticks\n", compared);
+    }
+    return true;
+}
+
+
+int main(int argc, char **argv)
+{
+
+    if (argc != 3) {
+        std::cerr << "Usage: desync <first log> <second log>" << std::endl;
+        return 2;
+    }
+
+    try {
+        Log a, b;
+        ReadHashLog(argv[1], a.ticks, a.offsets, a.entities);
+        ReadHashLog(argv[2], b.ticks, b.offsets, b.entities);
+        return Compare(a, b) ? 0 : 1;
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+}
@@ -0,0 +1,383 @@
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include "ecs.h"
+#include "state_hash.h"
+
+namespace game {
+
+// Size of a chunk, and the alignment of each component array inside it
+const std::size_t chunk_bytes_g = 16 * 1024;
+const std::size_t column_align_g = 16;
+
+static inline std::size_t AlignUp(std::size_t n)
+{
+
+    return (n + column_align_g - 1) & ~(column_align_g - 1);
+}
+
+
+World::World(void)
+{
+
+    for (int i = 0; i < MAX_COMPONENTS; i++) {
+        sizes_[i] = 0;
+    }
+    num_entities_ = 0;
+    arena_ = NULL;
+}
+
+
+World::~World()
+{
+
+    Release();
+}
+
+
+void World::SetArena(Arena *arena)
+{
+
+    arena_ = arena;
+}
+
+
+char *World::AllocateChunk(void)
+{
+
+    if (arena_) {
+        return (char *) arena_->Allocate(chunk_bytes_g, column_align_g);
+    }
+    return (char *) ::operator new(chunk_bytes_g);
+}
+
+
+void World::RegisterComponent(int id, std::size_t size)
+{
+
+    sizes_[id] = size;
+}
+
+
+int World::FindArchetype(ComponentMask mask)
+{
+
+    // There are only a handful of archetypes, so a linear search is plenty
+    for (int i = 0; i < archetypes_.size(); i++) {
+        if (archetypes_[i].mask == mask) {
+            return i;
+        }
+    }
+
+    // Lay out a new archetype: the entity ids first, then one array per component
+    Archetype a;
+    a.mask = mask;
+    a.count = 0;
+
+    std::size_t row = sizeof(Entity);
+    int num_components = 0;
+    for (int id = 0; id < MAX_COMPONENTS; id++) {
+        if (mask & (1u << id)) {
+            row += sizes_[id];
+            num_components++;
+        }
+    }
+
+    // Leave room for the padding between arrays
+    a.capacity = (int) ((chunk_bytes_g - (num_components + 1) * column_align_g) / row);
+
+    std::size_t offset = 0;
+    a.entities_offset = offset;
+    offset = AlignUp(offset + sizeof(Entity) * a.capacity);
+    for (int id = 0; id < MAX_COMPONENTS; id++) {
+        a.offsets[id] = 0;
+        if (mask & (1u << id)) {
+            a.offsets[id] = offset;
+            offset = AlignUp(offset + sizes_[id] * a.capacity);
+        }
+    }
+
+    archetypes_.push_back(a);
+    return (int) archetypes_.size() - 1;
+}
+
+
+Entity World::Create(ComponentMask mask)
+{
+
+    int index = FindArchetype(mask);
+    Archetype &a = archetypes_[index];
+
+    // Add a chunk when the last one is full
+    int chunk = a.count / a.capacity;
+    int row = a.count % a.capacity;
+    if (chunk == a.chunks.size()) {
+        a.chunks.push_back(AllocateChunk());
+    }
+
+    // Reuse a free entry of the entity table if there is one
+    unsigned int slot;
+    if (!free_.empty()) {
+        slot = free_.back();
+        free_.pop_back();
+    }
+    else {
+        if (locations_.size() >= ENTITY_INDEX_MASK) {
+            throw(std::runtime_error(std::string("Too many entities")));
+        }
+        slot = (unsigned int) locations_.size();
+        Location l;
+        l.generation = 0;
+        locations_.push_back(l);
+    }
+    locations_[slot].archetype = index;
+    locations_[slot].index = a.count;
+    Entity entity = (locations_[slot].generation << ENTITY_INDEX_BITS) | slot;
+
+    Entities(a, chunk)[row] = entity;
+    for (int id = 0; id < MAX_COMPONENTS; id++) {
+        if (mask & (1u << id)) {
+            memset(Column(a, chunk, id) + row * sizes_[id], 0, sizes_[id]);
+        }
+    }
+
+    a.count++;
+    num_entities_++;
+    return entity;
+}
+
+
+void World::Destroy(Entity entity)
+{
+
+    if (!IsAlive(entity)) {
+        return;
+    }
+
+    Location &l = locations_[entity & ENTITY_INDEX_MASK];
+    Archetype &a = archetypes_[l.archetype];
+
+    // Fill the hole with the last entity of the archetype, so the arrays stay packed
+    int last = a.count - 1;
+    if (l.index != last) {
+        int chunk = l.index / a.capacity, row = l.index % a.capacity;
+        int last_chunk = last / a.capacity, last_row = last % a.capacity;
+
+        for (int id = 0; id < MAX_COMPONENTS; id++) {
+            if (a.mask & (1u << id)) {
+                memcpy(Column(a, chunk, id) + row * sizes_[id], Column(a, last_chunk, id) + last_row * sizes_[id], sizes_[id]);
+            }
+        }
+
+        Entity moved = Entities(a, last_chunk)[last_row];
+        Entities(a, chunk)[row] = moved;
+        locations_[moved & ENTITY_INDEX_MASK].index = l.index;
+    }
+
+    // Empty chunks are kept for the next entities of this archetype
+    a.count--;
+    num_entities_--;
+
+    // Old handles stop matching the entry once its generation changes
+    l.archetype = -1;
+    l.generation = (l.generation + 1) & ENTITY_GENERATION_MASK;
+    free_.push_back(entity & ENTITY_INDEX_MASK);
+}
+
+
+void World::DestroyLater(Entity entity)
+{
+
+    pending_.push_back(entity);
+}
+
+
+void World::Flush(std::vector<Entity> *destroyed)
+{
+
+    // An entity can be queued more than once, it is only destroyed the first time
+    for (int i = 0; i < pending_.size(); i++) {
+        if (IsAlive(pending_[i])) {
+            Destroy(pending_[i]);
+            if (destroyed) {
+                destroyed->push_back(pending_[i]);
+            }
+        }
+    }
+    pending_.clear();
+}
+
+
+void World::Clear(void)
+{
+
+    for (int i = 0; i < archetypes_.size(); i++) {
+        archetypes_[i].count = 0;
+    }
+
+    // The table is kept, so handles from before the clear stay invalid
+    free_.clear();
+    for (int i = (int) locations_.size() - 1; i >= 0; i--) {
+        Location &l = locations_[i];
+        if (l.archetype != -1) {
+            l.archetype = -1;
+            l.generation = (l.generation + 1) & ENTITY_GENERATION_MASK;
+        }
+        free_.push_back(i);
+    }
+    pending_.clear();
+    num_entities_ = 0;
+}
+
+
+void World::Save(Image &image)
+{
+
+    image.data.clear();
+    SnapshotWriter writer(image.data);
+    Write(writer);
+}
+
+
+void World::Load(const Image &image)
+{
+
+    SnapshotReader reader(image.data.data(), image.data.size());
+    Read(reader);
+}
+
+
+void World::Write(SnapshotWriter &writer)
+{
+
+    writer.Write((int) archetypes_.size());
+    for (int i = 0; i < archetypes_.size(); i++) {
+        Archetype &a = archetypes_[i];
+        writer.Write(a.mask);
+        writer.Write(a.count);
+
+        int used = (a.count + a.capacity - 1) / a.capacity;
+        for (int c = 0; c < used; c++) {
+            writer.Write(a.chunks[c], chunk_bytes_g);
+        }
+    }
+
+    writer.WriteArray(locations_.data(), (int) locations_.size());
+    writer.WriteArray(free_.data(), (int) free_.size());
+}
+
+
+void World::Read(SnapshotReader &reader)
+{
+
+    for (int i = 0; i < archetypes_.size(); i++) {
+        archetypes_[i].count = 0;
+    }
+
+    // Archetypes are found by their mask, archetypes missing from the snapshot are left empty
+    // The run that saved the snapshot may have made them in another order, so remember where each one went
+    int num_archetypes = reader.ReadCount(sizeof(ComponentMask) + sizeof(int));
+    num_entities_ = 0;
+    remap_.resize(num_archetypes);
+    for (int i = 0; i < num_archetypes; i++) {
+        ComponentMask mask;
+        int count;
+        reader.Read(mask);
+        reader.Read(count);
+
+        remap_[i] = FindArchetype(mask);
+        Archetype &a = archetypes_[remap_[i]];
+        a.count = count;
+
+        int used = (a.count + a.capacity - 1) / a.capacity;
+        for (int c = 0; c < used; c++) {
+            if (c == a.chunks.size()) {
+                a.chunks.push_back(AllocateChunk());
+            }
+            memcpy(a.chunks[c], reader.Skip(chunk_bytes_g), chunk_bytes_g);
+        }
+        num_entities_ += a.count;
+    }
+
+    // Resizing the tables reuses their memory
+    locations_.resize(reader.ReadCount(sizeof(Location)));
+    reader.Read(locations_.data(), sizeof(Location) * locations_.size());
+    for (int i = 0; i < locations_.size(); i++) {
+        Location &l = locations_[i];
+        if (l.archetype == -1) {
+            continue;
+        }
+        if (l.archetype < 0 || l.archetype >= num_archetypes) {
+            throw(std::runtime_error(std::string("Snapshot has damaged entities")));
+        }
+        l.archetype = remap_[l.archetype];
+        if (l.index < 0 || l.index >= archetypes_[l.archetype].count) {
+            throw(std::runtime_error(std::string("Snapshot has damaged entities")));
+        }
+    }
+    free_.resize(reader.ReadCount(sizeof(unsigned int)));
+    reader.Read(free_.data(), sizeof(unsigned int) * free_.size());
+    pending_.clear();
+}
+
+
+void World::Release(void)
+{
+
+    for (int i = 0; i < archetypes_.size(); i++) {
+        Archetype &a = archetypes_[i];
+        if (!arena_) {
+            for (int c = 0; c < a.chunks.size(); c++) {
+                ::operator delete(a.chunks[c]);
+            }
+        }
+        a.chunks.clear();
+        a.count = 0;
+    }
+
+    locations_.clear();
+    free_.clear();
+    pending_.clear();
+    num_entities_ = 0;
+}
+
+
+unsigned long long World::Hash(void)
+{
+
+    unsigned long long hash = HASH_SEED;
+    for (int i = 0; i < archetypes_.size(); i++) {
+        hash = HashValue(hash, archetypes_[i].mask);
+        hash = HashValue(hash, archetypes_[i].count);
+    }
+
+    // Fields one by one, so the padding of the table doesn't count
+    for (int i = 0; i < locations_.size(); i++) {
+        hash = HashValue(hash, locations_[i].archetype);
+        hash = HashValue(hash, locations_[i].index);
+        hash = HashValue(hash, locations_[i].generation);
+    }
+    return HashBytes(hash, free_.data(), sizeof(unsigned int) * free_.size());
+}
+
+
+bool World::IsAlive(Entity entity)
+{
+
+    unsigned int slot = entity & ENTITY_INDEX_MASK;
+    return slot < locations_.size() && locations_[slot].archetype != -1 && locations_[slot].generation == (entity >> ENTITY_INDEX_BITS);
+}
+
+
+ComponentMask World::GetMask(Entity entity)
+{
+
+    if (!IsAlive(entity)) {
+        return 0;
+    }
+    return archetypes_[locations_[entity & ENTITY_INDEX_MASK].archetype].mask;
+}
+
+} // namespace game
@@ -0,0 +1,190 @@
+#ifndef ECS_H_
+#define ECS_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "arena.h"
+#include "snapshot.h"
+
+namespace game {
+
+    // An entity is just a handle, its data lives in the components attached to it
+    // The low 20 bits index the world's entity table, and the high 12 bits are the generation of that entry,
+    // bumped every time it is reused, so a handle to a destroyed entity never matches a new one
+    typedef unsigned int Entity;
+    const Entity NO_ENTITY = 0xFFFFFFFF;
+    const int ENTITY_INDEX_BITS = 20;
+    const unsigned int ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+    const unsigned int ENTITY_GENERATION_MASK = 0xFFF;
+
+    // One bit per component type
+    typedef unsigned int ComponentMask;
+    const int MAX_COMPONENTS = 32;
+
+    // Components are plain structs with a unique ID between 0 and MAX_COMPONENTS - 1, for example
+    //     struct Health { enum { ID = 4 }; int health; };
+    template<class T> inline ComponentMask MaskOf(void) { return 1u << T::ID; }
+    template<class T, class U, class... Rest> inline ComponentMask MaskOf(void) { return MaskOf<T>() | MaskOf<U, Rest...>(); }
+
+    /*
+        World stores every entity of the game, grouped into archetypes (entities with the same set of components)
+        Each archetype keeps its entities in fixed size chunks, with one dense array per component inside each chunk,
+        so systems only visit the archetypes that have the components they need and walk straight through the arrays
+        Components are plain data: they are zeroed when created and moved with memcpy
+    */
+    class World {
+
+        public:
+            World(void);
+            ~World();
+
+            // Take the chunks from an arena instead of the heap. The arena must outlive the world's chunks,
+            // and is reset by its owner after Release
+            void SetArena(Arena *arena);
+
+            // Tell the world the size of a component type, before creating entities that use it
+            template<class T> void Register(void) { RegisterComponent(T::ID, sizeof(T)); }
+            void RegisterComponent(int id, std::size_t size);
+
+            // Create an entity with the given components, all zeroed
+            Entity Create(ComponentMask mask);
+
+            // Remove an entity. The last entity of its archetype moves into its place, so this must not
+            // be called while iterating over that archetype
+            void Destroy(Entity entity);
+
+            // Remove an entity at the next Flush, which is safe at any time
+            // The entity stays alive, with all of its components, until then
+            void DestroyLater(Entity entity);
+
+            // Remove the entities passed to DestroyLater, adding their handles to destroyed if given
+            void Flush(std::vector<Entity> *destroyed = NULL);
+
+            // Remove every entity
+            void Clear(void);
+
+            // Copy of every entity of a world, to put the world back the way it was later (see below)
+            struct Image;
+
+            // Save every entity to an image, or replace every entity with the ones of an image
+            // Loading only copies whole chunks and tables, so it costs about as much as a memcpy of the image
+            void Save(Image &image);
+            void Load(const Image &image);
+
+            // The same, as part of a game snapshot
+            // Chunks the world already has are reused, so reading doesn't allocate once the world has grown
+            void Write(SnapshotWriter &writer);
+            void Read(SnapshotReader &reader);
+
+            // Forget every entity and chunk, giving the chunks back to the heap unless they came from an arena
+            void Release(void);
+
+            // Hash of which entities exist and where they are stored, for checking that two runs match
+            unsigned long long Hash(void);
+
+            // Check that a handle still refers to a live entity, O(1)
+            bool IsAlive(Entity entity);
+            ComponentMask GetMask(Entity entity);
+            template<class T> bool Has(Entity entity) { return (GetMask(entity) & MaskOf<T>()) != 0; }
+
+            // Get a component of a live entity. The reference stays valid until an entity of the same archetype is destroyed
+            template<class T> T &Get(Entity entity);
+
+            // Call f(entity, components...) for every entity that has all of the components
+            // Entities must not be created or destroyed from inside f
+            template<class... T, class F> void Each(F f);
+
+            // Getters
+            inline int GetNumEntities(void) { return num_entities_; }
+            inline int GetNumArchetypes(void) { return (int) archetypes_.size(); }
+
+        private:
+            struct Archetype {
+                ComponentMask mask;
+
+                // Entities per chunk, and where each component array starts inside a chunk
+                int capacity;
+                std::size_t offsets[MAX_COMPONENTS];
+                std::size_t entities_offset;
+
+                // Entities are packed: entity n is in chunk n / capacity, row n % capacity
+                std::vector<char *> chunks;
+                int count;
+            };
+
+            // Entry of the entity table, archetype is -1 while the entry is free
+            struct Location {
+                int archetype;
+                int index;
+                unsigned int generation;
+            };
+
+            std::size_t sizes_[MAX_COMPONENTS];
+            std::vector<Archetype> archetypes_;
+
+            // Where chunks come from, NULL for the heap
+            Arena *arena_;
+
+            // Where every entity is stored, and the table entries free for reuse
+            std::vector<Location> locations_;
+            std::vector<unsigned int> free_;
+            int num_entities_;
+
+            // Entities waiting for Flush
+            std::vector<Entity> pending_;
+
+            // Archetype of this world for each archetype of a snapshot being read
+            std::vector<int> remap_;
+
+            int FindArchetype(ComponentMask mask);
+            char *AllocateChunk(void);
+
+            // Start of a component's array in a chunk
+            inline char *Column(Archetype &a, int chunk, int id) { return a.chunks[chunk] + a.offsets[id]; }
+            inline Entity *Entities(Archetype &a, int chunk) { return (Entity *) (a.chunks[chunk] + a.entities_offset); }
+
+        public:
+            // The mask and entities of each archetype with their chunks back to back, then the entity table
+            struct Image {
+                std::vector<char> data;
+            };
+
+    }; // class World
+
+
+    template<class T> T &World::Get(Entity entity)
+    {
+        Location &l = locations_[entity & ENTITY_INDEX_MASK];
+        Archetype &a = archetypes_[l.archetype];
+        return ((T *) Column(a, l.index / a.capacity, T::ID))[l.index % a.capacity];
+    }
+
+
+    template<class... T, class F> void World::Each(F f)
+    {
+        ComponentMask mask = MaskOf<T...>();
+
+        for (int i = 0; i < archetypes_.size(); i++) {
+            Archetype &a = archetypes_[i];
+            if ((a.mask & mask) != mask) {
+                continue;
+            }
+
+            // Walk every chunk of a matching archetype, all of them are full except the last one
+            for (int c = 0; c * a.capacity < a.count; c++) {
+                int rows = a.count - c * a.capacity;
+                if (rows > a.capacity) {
+                    rows = a.capacity;
+                }
+                Entity *entities = Entities(a, c);
+                for (int r = 0; r < rows; r++) {
+                    f(entities[r], ((T *) Column(a, c, T::ID))[r]...);
+                }
+            }
+        }
+    }
+
+} // namespace game
+
+#endif // ECS_H_
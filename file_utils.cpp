@@ -1,30 +1,183 @@
 #include <fstream>
 #include <iostream>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "file_utils.h"
 
 namespace game {
 
-std::string LoadTextFile(const char *filename) {
+// Open a file for reading in binary, and find its size
+static std::size_t OpenFile(const char *filename, std::ifstream &f)
+{
 
-    // Open file
-    std::ifstream f;
-    f.open(filename);
+    f.open(filename, std::ios::binary);
     if (f.fail()) {
         throw(std::ios_base::failure(std::string("Error opening file ") + std::string(filename)));
     }
+    f.seekg(0, std::ios::end);
+    std::streamoff size = f.tellg();
+    f.seekg(0, std::ios::beg);
+    if (size < 0) {
+        throw(std::ios_base::failure(std::string("Error reading file ") + std::string(filename)));
+    }
+    return (std::size_t) size;
+}
 
-    // Read file into a string
-    std::string content;
-    std::string line;
-    while (std::getline(f, line)) {
-        content += line + "\n";
+
+// Fill a buffer that was sized for the whole file
+static void ReadFile(const char *filename, std::ifstream &f, char *data, std::size_t size)
+{
+
+    f.read(data, size);
+    if ((std::size_t) f.gcount() != size) {
+        throw(std::ios_base::failure(std::string("Error reading file ") + std::string(filename)));
     }
+}
 
-    // Close file
-    f.close();
+
+std::string LoadTextFile(const char *filename) {
+
+    // Open file
+    std::ifstream f;
+    std::size_t size = OpenFile(filename, f);
+
+    // Read the whole file at once, leaving room for the newline that may be added
+    std::string content;
+    content.reserve(size + 1);
+    content.resize(size);
+    ReadFile(filename, f, &content[0], size);
+    if (!content.empty() && content.back() != '\n') {
+        content += '\n';
+    }
 
     return content;
 }
 
+
+void LoadFile(const char *filename, std::vector<char> &buffer)
+{
+
+    std::ifstream f;
+    std::size_t size = OpenFile(filename, f);
+    buffer.resize(size);
+    ReadFile(filename, f, buffer.data(), size);
+}
+
+
+MappedFile::MappedFile(void)
+{
+
+    open_ = false;
+    data_ = NULL;
+    size_ = 0;
+#ifdef _WIN32
+    file_ = INVALID_HANDLE_VALUE;
+    mapping_ = NULL;
+#endif
+}
+
+
+MappedFile::~MappedFile()
+{
+
+    Close();
+}
+
+
+bool MappedFile::Open(const char *filename)
+{
+
+    Close();
+
+#ifdef _WIN32
+    file_ = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size)) {
+        Close();
+        return false;
+    }
+    size_ = (std::size_t) size.QuadPart;
+
+    // Empty files can't be mapped, but there is nothing to read anyway
+    if (size_ > 0) {
+        mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping_ == NULL) {
+            Close();
+            return false;
+        }
+        data_ = (const char *) MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (data_ == NULL) {
+            Close();
+            return false;
+        }
+    }
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    size_ = (std::size_t) st.st_size;
+
+    // Empty files can't be mapped, but there is nothing to read anyway
+    // The mapping stays valid after the file is closed
+    if (size_ > 0) {
+        void *data = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            size_ = 0;
+            return false;
+        }
+        data_ = (const char *) data;
+    }
+    close(fd);
+#endif
+
+    open_ = true;
+    return true;
+}
+
+
+void MappedFile::Close(void)
+{
+
+#ifdef _WIN32
+    if (data_) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_) {
+        CloseHandle(mapping_);
+    }
+    if (file_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_);
+    }
+    file_ = INVALID_HANDLE_VALUE;
+    mapping_ = NULL;
+#else
+    if (data_) {
+        munmap((void *) data_, size_);
+    }
+#endif
+    open_ = false;
+    data_ = NULL;
+    size_ = 0;
+}
+
 } // namespace game
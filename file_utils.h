@@ -1,12 +1,57 @@
 #ifndef FILE_UTILS_H_
 #define FILE_UTILS_H_
 
+#include <cstddef>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace game {
 
+    // Read a whole text file in a single read, into a string sized for it up front
+    // Files that don't end with a newline get one, as they did when they were read line by line
     std::string LoadTextFile(const char *filename);
 
+    // Read a whole file into a buffer sized for it up front, in a single read
+    // The buffer keeps its capacity, so reading into the same one again doesn't allocate once it has grown
+    void LoadFile(const char *filename, std::vector<char> &buffer);
+
+    /*
+        MappedFile maps a whole file read-only into memory, so its contents can be used in place without copying
+        The view stays valid until the file is closed or the MappedFile is destroyed
+    */
+    class MappedFile {
+
+        public:
+            MappedFile(void);
+            ~MappedFile();
+
+            MappedFile(const MappedFile &) = delete;
+            MappedFile &operator=(const MappedFile &) = delete;
+
+            // Map a file, closing the one mapped before. Returns false if it can't be opened or mapped
+            bool Open(const char *filename);
+            void Close(void);
+
+            // Getters
+            inline bool IsOpen(void) { return open_; }
+            inline const char *GetData(void) { return data_; }
+            inline std::size_t GetSize(void) { return size_; }
+            inline std::string_view GetText(void) { return std::string_view(data_, size_); }
+
+        private:
+            bool open_;
+            const char *data_;
+            std::size_t size_;
+
+#ifdef _WIN32
+            // Handles of the file and of its mapping
+            void *file_;
+            void *mapping_;
+#endif
+
+    }; // class MappedFile
+
 } // namespace game
 
 #endif // FILE_UTILS_H_
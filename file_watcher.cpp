@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <filesystem>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "file_watcher.h"
+
+namespace game {
+
+#ifndef __linux__
+// How often the modification times are compared without inotify
+const double scan_interval_g = 0.5;
+#endif
+
+// Add a path to the changed ones, unless it is there already
+static void AddChanged(const std::string &path, std::vector<std::string> &changed)
+{
+
+    if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+        changed.push_back(path);
+    }
+}
+
+
+FileWatcher::FileWatcher(void)
+{
+
+#ifdef __linux__
+    inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#else
+    last_scan_ = std::chrono::steady_clock::now();
+#endif
+}
+
+
+FileWatcher::~FileWatcher()
+{
+
+#ifdef __linux__
+    if (inotify_ != -1) {
+        close(inotify_);
+    }
+#endif
+}
+
+
+bool FileWatcher::Watch(const std::string &directory)
+{
+
+    Directory d;
+    d.path = directory;
+    d.watch = -1;
+
+#ifdef __linux__
+    if (inotify_ == -1) {
+        return false;
+    }
+    d.watch = inotify_add_watch(inotify_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (d.watch == -1) {
+        return false;
+    }
+#else
+    std::error_code error;
+    if (!std::filesystem::is_directory(directory, error)) {
+        return false;
+    }
+    Scan(d, NULL);
+#endif
+
+    directories_.push_back(d);
+    return true;
+}
+
+
+#ifdef __linux__
+
+void FileWatcher::Poll(std::vector<std::string> &changed)
+{
+
+    if (inotify_ == -1) {
+        return;
+    }
+
+    // Events are read until there are none left, the descriptor never blocks
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t length = read(inotify_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (char *p = buffer; p < buffer + length; p += sizeof(inotify_event) + ((inotify_event *) p)->len) {
+            const inotify_event *event = (const inotify_event *) p;
+            if (event->len == 0 || (event->mask & IN_ISDIR)) {
+                continue;
+            }
+            for (int i = 0; i < directories_.size(); i++) {
+                if (directories_[i].watch == event->wd) {
+                    AddChanged(directories_[i].path + "/" + event->name, changed);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+#else
+
+void FileWatcher::Poll(std::vector<std::string> &changed)
+{
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double>(now - last_scan_).count() < scan_interval_g) {
+        return;
+    }
+    last_scan_ = now;
+    for (int i = 0; i < directories_.size(); i++) {
+        Scan(directories_[i], &changed);
+    }
+}
+
+
+void FileWatcher::Scan(Directory &directory, std::vector<std::string> *changed)
+{
+
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory.path, error), end; !error && it != end; it.increment(error)) {
+        if (!it->is_regular_file(error)) {
+            continue;
+        }
+        std::string path = directory.path + "/" + it->path().filename().string();
+        long long time = (long long) it->last_write_time(error).time_since_epoch().count();
+
+        // Files seen for the first time count as written, except on the first scan
+        std::vector<std::string>::iterator file = std::find(directory.files.begin(), directory.files.end(), path);
+        if (file == directory.files.end()) {
+            directory.files.push_back(path);
+            directory.times.push_back(time);
+            if (changed) {
+                AddChanged(path, *changed);
+            }
+        }
+        else if (directory.times[file - directory.files.begin()] != time) {
+            directory.times[file - directory.files.begin()] = time;
+            if (changed) {
+                AddChanged(path, *changed);
+            }
+        }
+    }
+}
+
+#endif
+
+} // namespace game
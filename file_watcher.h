@@ -0,0 +1,57 @@
+#ifndef FILE_WATCHER_H_
+#define FILE_WATCHER_H_
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace game {
+
+    /*
+        FileWatcher reports the files of some directories that were written since it was last asked
+        On Linux it is told by inotify, so asking costs one read that doesn't block. Elsewhere it compares
+        the modification times of the files a couple of times a second
+        A file counts as written once it is closed after writing, or moved into the directory, as editors
+        that save through a temporary file do
+    */
+    class FileWatcher {
+
+        public:
+            FileWatcher(void);
+            ~FileWatcher();
+
+            FileWatcher(const FileWatcher &) = delete;
+            FileWatcher &operator=(const FileWatcher &) = delete;
+
+            // Watch the files of a directory, not the ones of its subdirectories. Returns false if it can't be watched
+            bool Watch(const std::string &directory);
+
+            // Add the paths of the files written since the last call, directory + "/" + name, each path once
+            void Poll(std::vector<std::string> &changed);
+
+        private:
+            struct Directory {
+                std::string path;
+                int watch;
+
+                // Modification times of the files, when there is no inotify
+                std::vector<std::string> files;
+                std::vector<long long> times;
+            };
+
+            std::vector<Directory> directories_;
+
+#ifdef __linux__
+            int inotify_;
+#else
+            std::chrono::steady_clock::time_point last_scan_;
+
+            // Read the modification times of a directory's files, adding the paths of the ones that changed
+            void Scan(Directory &directory, std::vector<std::string> *changed);
+#endif
+
+    }; // class FileWatcher
+
+} // namespace game
+
+#endif // FILE_WATCHER_H_
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "frame_capture.h"
+
+namespace game {
+
+ImageDifference CompareImages(const unsigned char *a, const unsigned char *b, int width, int height, int threshold)
+{
+
+    ImageDifference difference = { 0, 0, 0.0 };
+    double sum = 0.0;
+    std::size_t num_pixels = (std::size_t) width * height;
+    for (std::size_t i = 0; i < num_pixels; i++) {
+        int worst = 0;
+        for (int c = 0; c < 4; c++) {
+            int error = abs((int) a[i * 4 + c] - (int) b[i * 4 + c]);
+            worst = error > worst ? error : worst;
+            sum += (double) error * error;
+        }
+        difference.differing += worst > threshold ? 1 : 0;
+        difference.max_error = worst > difference.max_error ? worst : difference.max_error;
+    }
+    difference.rms_error = num_pixels > 0 ? sqrt(sum / (num_pixels * 4)) : 0.0;
+    return difference;
+}
+
+
+// Append a 32 bit number, most significant byte first like everything in a PNG file
+static void PutBigEndian(std::vector<unsigned char> &out, uint32_t value)
+{
+
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((unsigned char) (value >> shift));
+    }
+}
+
+
+// Append a chunk: its length, type and data, then the CRC of the type and the data
+static void PutChunk(std::vector<unsigned char> &out, const char *type, const std::vector<unsigned char> &data)
+{
+
+    static uint32_t table[256];
+    if (table[1] == 0) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+    }
+
+    PutBigEndian(out, (uint32_t) data.size());
+    std::size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    uint32_t crc = 0xffffffffu;
+    for (std::size_t i = start; i < out.size(); i++) {
+        crc = table[(crc ^ out[i]) & 255] ^ (crc >> 8);
+    }
+    PutBigEndian(out, crc ^ 0xffffffffu);
+}
+
+
+bool WritePNG(const char *filename, const unsigned char *pixels, int width, int height)
+{
+
+    std::vector<unsigned char> header;
+    PutBigEndian(header, (uint32_t) width);
+    PutBigEndian(header, (uint32_t) height);
+    const unsigned char format[] = { 8, 6, 0, 0, 0 };   // 8 bits per channel, RGBA, no interlacing
+    header.insert(header.end(), format, format + sizeof(format));
+
+    // Each row starts with its filter, none. The rows go into a zlib stream of stored deflate blocks
+    std::size_t row = (std::size_t) width * 4;
+    std::vector<unsigned char> raw;
+    raw.reserve((row + 1) * height);
+    for (int y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels + y * row, pixels + (y + 1) * row);
+    }
+
+    std::vector<unsigned char> stream;
+    stream.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    stream.push_back(0x78);
+    stream.push_back(0x01);
+    std::size_t offset = 0;
+    do {
+        std::size_t length = std::min<std::size_t>(raw.size() - offset, 65535);
+        stream.push_back(offset + length == raw.size() ? 1 : 0);
+        stream.push_back((unsigned char) length);
+        stream.push_back((unsigned char) (length >> 8));
+        stream.push_back((unsigned char) ~length);
+        stream.push_back((unsigned char) (~length >> 8));
+        stream.insert(stream.end(), raw.begin() + offset, raw.begin() + offset + length);
+        offset += length;
+    } while (offset < raw.size());
+
+    uint32_t a = 1, b = 0;
+    for (std::size_t i = 0; i < raw.size(); i++) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    PutBigEndian(stream, (b << 16) | a);
+
+    const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    std::vector<unsigned char> file(signature, signature + sizeof(signature));
+    PutChunk(file, "IHDR", header);
+    PutChunk(file, "IDAT", stream);
+    PutChunk(file, "IEND", std::vector<unsigned char>());
+
+    FILE *out = fopen(filename, "wb");
+    if (!out) {
+        return false;
+    }
+    bool written = fwrite(file.data(), 1, file.size(), out) == file.size();
+    return fclose(out) == 0 && written;
+}
+
+
+FrameCapture::FrameCapture(void)
+{
+
+    memset(ring_, 0, sizeof(ring_));
+    oldest_ = 0;
+    num_pending_ = 0;
+    width_ = 0;
+    height_ = 0;
+}
+
+
+FrameCapture::~FrameCapture()
+{
+    // The buffers belong to the context, Clear deletes them while it is still there
+}
+
+
+void FrameCapture::Init(int width, int height)
+{
+
+    Clear();
+    width_ = width;
+    height_ = height;
+    for (int i = 0; i < RING_SIZE; i++) {
+        glGenBuffers(1, &ring_[i].buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, ring_[i].buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) width * height * 4, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+
+bool FrameCapture::Capture(unsigned int tick)
+{
+
+    if (num_pending_ == RING_SIZE) {
+        return false;
+    }
+
+    // With a pixel pack buffer bound, the read only queues a copy into it and returns
+    Slot &slot = ring_[(oldest_ + num_pending_) % RING_SIZE];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.tick = tick;
+
+    // Send the fence on its way, so Take can find it signaled without flushing itself
+    glFlush();
+    num_pending_++;
+    return true;
+}
+
+
+bool FrameCapture::Take(unsigned int &tick, std::vector<unsigned char> &pixels, bool wait)
+{
+
+    if (num_pending_ == 0) {
+        return false;
+    }
+
+    Slot &slot = ring_[oldest_];
+    GLenum status;
+    do {
+        status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 100000000 : 0);
+    } while (wait && status == GL_TIMEOUT_EXPIRED);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+
+    // OpenGL has the bottom row first, images have the top row first
+    const unsigned char *data = NULL;
+    if (status != GL_WAIT_FAILED) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        data = (const unsigned char *) glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    }
+    if (data) {
+        std::size_t row = (std::size_t) width_ * 4;
+        pixels.resize(row * height_);
+        for (int y = 0; y < height_; y++) {
+            memcpy(&pixels[(height_ - 1 - y) * row], data + y * row, row);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // A frame that can't be read is dropped, so the ones after it still come out
+    if (!data) {
+        printf("[?] Lost the captured frame of tick %u\n", slot.tick);
+    }
+    tick = slot.tick;
+    oldest_ = (oldest_ + 1) % RING_SIZE;
+    num_pending_--;
+    return data != NULL;
+}
+
+
+void FrameCapture::Clear(void)
+{
+
+    for (int i = 0; i < RING_SIZE; i++) {
+        if (ring_[i].fence) {
+            glDeleteSync(ring_[i].fence);
+        }
+        if (ring_[i].buffer) {
+            glDeleteBuffers(1, &ring_[i].buffer);
+        }
+    }
+    memset(ring_, 0, sizeof(ring_));
+    oldest_ = 0;
+    num_pending_ = 0;
+}
+
+} // namespace game
@@ -0,0 +1,81 @@
+#ifndef FRAME_CAPTURE_H_
+#define FRAME_CAPTURE_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <vector>
+
+namespace game {
+
+    // How far apart two images of the same size are
+    struct ImageDifference {
+        int differing;          // Pixels with any channel further off than the threshold
+        int max_error;          // Largest difference of any channel
+        double rms_error;       // Root mean square difference over every channel
+    };
+
+    // Compare two RGBA8 images of the same size, pixels differ when a channel is off by more than threshold
+    ImageDifference CompareImages(const unsigned char *a, const unsigned char *b, int width, int height, int threshold);
+
+    // Write an RGBA8 image, top row first, to a PNG file. The pixels are stored without compression
+    bool WritePNG(const char *filename, const unsigned char *pixels, int width, int height);
+
+    /*
+        FrameCapture reads frames back from the framebuffer without waiting for them to be drawn
+        Each frame is copied into the next pixel buffer object of a ring, and only mapped a few frames later
+        once its fence has signaled, so the copy happens on the GPU's time instead of stalling the frame
+        Only when every buffer of the ring is still pending does the caller have to wait for the oldest one
+    */
+    class FrameCapture {
+
+        public:
+            FrameCapture(void);
+            ~FrameCapture();
+
+            FrameCapture(const FrameCapture &) = delete;
+            FrameCapture &operator=(const FrameCapture &) = delete;
+
+            // Make the ring of buffers, for frames of this size. Needs the OpenGL context
+            void Init(int width, int height);
+
+            // Start reading the frame drawn into the current read framebuffer, labelled with its tick
+            // Returns false without reading when the ring is full, Take the oldest frame out to make room
+            bool Capture(unsigned int tick);
+
+            // Take the oldest frame whose copy is done, top row first. With wait, waits for it if it isn't done yet
+            // Returns false when no frame is pending, or none is done and wait is false
+            // A frame that can't be read is dropped from the ring, and false is returned for it as well
+            bool Take(unsigned int &tick, std::vector<unsigned char> &pixels, bool wait);
+
+            // Delete the buffers. Needs the OpenGL context
+            void Clear(void);
+
+            // Getters
+            inline int GetWidth(void) { return width_; }
+            inline int GetHeight(void) { return height_; }
+            inline bool IsFull(void) { return num_pending_ == RING_SIZE; }
+            inline int GetNumPending(void) { return num_pending_; }
+
+        private:
+            enum { RING_SIZE = 3 };
+
+            struct Slot {
+                GLuint buffer;
+                GLsync fence;
+                unsigned int tick;
+            };
+
+            Slot ring_[RING_SIZE];
+
+            // Oldest pending slot, and the number of pending slots after it
+            int oldest_;
+            int num_pending_;
+
+            int width_;
+            int height_;
+
+    }; // class FrameCapture
+
+} // namespace game
+
+#endif // FRAME_CAPTURE_H_
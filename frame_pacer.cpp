@@ -0,0 +1,238 @@
+#include <cmath>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "frame_pacer.h"
+
+namespace game {
+
+// Frame rate while the game is idle, whatever the mode
+const double idle_fps_g = 10.0;
+
+// Limits of how long the limiter spins at the end of a wait. It starts in the middle
+const double min_spin_time_g = 0.0002;
+const double max_spin_time_g = 0.004;
+const double initial_spin_time_g = 0.001;
+
+// How much of the margin is given back after every sleep that woke up on time
+const double spin_decay_g = 0.02;
+
+// Seconds covered by each report
+const double report_period_g = 1.0;
+
+const char *pacing_mode_names_g[NUM_PACING_MODES] = { "uncapped", "vsync", "fixed", "adaptive" };
+
+// CPU time used by every thread of the process so far, in seconds
+static double ProcessCpuTime(void)
+{
+
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    unsigned long long k = ((unsigned long long) kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+    unsigned long long u = ((unsigned long long) user.dwHighDateTime << 32) | user.dwLowDateTime;
+    return (k + u) * 1e-7;
+#else
+    timespec t;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t) != 0) {
+        return 0.0;
+    }
+    return t.tv_sec + t.tv_nsec * 1e-9;
+#endif
+}
+
+
+static double Seconds(std::chrono::steady_clock::duration d)
+{
+
+    return std::chrono::duration<double>(d).count();
+}
+
+
+static void SleepFor(double seconds)
+{
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+}
+
+
+FramePacer::FramePacer(void)
+{
+
+    spin_time_ = initial_spin_time_g;
+    sleep_ = SleepFor;
+    report_ready_ = false;
+    SetMode(PACING_VSYNC, 60.0);
+}
+
+
+void FramePacer::SetMode(int mode, double target_fps)
+{
+
+    mode_ = mode;
+    period_ = 0.0;
+    if ((mode == PACING_FIXED || mode == PACING_ADAPTIVE) && target_fps > 0.0) {
+        period_ = 1.0 / target_fps;
+    }
+
+    // Frames of the old mode don't count towards the new one
+    Clock::time_point now = Clock::now();
+    deadline_ = now;
+    last_frame_ = now;
+    StartReport(now);
+}
+
+
+void FramePacer::SetSleep(SleepFunction sleep)
+{
+
+    sleep_ = sleep ? sleep : SleepFor;
+}
+
+
+int FramePacer::GetSwapInterval(bool tear_control)
+{
+
+    switch (mode_) {
+        case PACING_VSYNC:
+            return 1;
+        case PACING_ADAPTIVE:
+            return tear_control ? -1 : 1;
+        default:
+            return 0;
+    }
+}
+
+
+void FramePacer::EndFrame(bool idle)
+{
+
+    if (idle) {
+        Wait(1.0 / idle_fps_g);
+    }
+    else if (period_ > 0.0) {
+        Wait(period_);
+    }
+
+    // Time from the end of the last frame, waits included, since that is how long the frame stayed on screen
+    Clock::time_point now = Clock::now();
+    double frame_time = Seconds(now - last_frame_);
+    last_frame_ = now;
+
+    frames_++;
+    sum_ += frame_time;
+    sum_squares_ += frame_time * frame_time;
+    if (frame_time > worst_) {
+        worst_ = frame_time;
+    }
+
+    double elapsed = Seconds(now - report_start_);
+    if (elapsed >= report_period_g) {
+        double mean = sum_ / frames_;
+        double variance = sum_squares_ / frames_ - mean * mean;
+        report_.mode = mode_;
+        report_.frames = frames_;
+        report_.fps = frames_ / elapsed;
+        report_.frame_ms = mean * 1000.0;
+        report_.jitter_ms = (variance > 0.0 ? std::sqrt(variance) : 0.0) * 1000.0;
+        report_.worst_ms = worst_ * 1000.0;
+        report_.cpu = (ProcessCpuTime() - report_cpu_) / elapsed;
+        report_ready_ = true;
+        StartReport(now);
+    }
+}
+
+
+bool FramePacer::GetReport(PacingReport &report)
+{
+
+    if (!report_ready_) {
+        return false;
+    }
+    report = report_;
+    report_ready_ = false;
+    return true;
+}
+
+
+const char *FramePacer::GetModeName(int mode)
+{
+
+    if (mode < 0 || mode >= NUM_PACING_MODES) {
+        return "unknown";
+    }
+    return pacing_mode_names_g[mode];
+}
+
+
+void FramePacer::Wait(double period)
+{
+
+    Clock::time_point now = Clock::now();
+    deadline_ += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period));
+
+    // A frame that ran late starts the schedule over, instead of rushing the next frames to catch up
+    if (deadline_ <= now) {
+        deadline_ = now;
+        return;
+    }
+
+    // Sleep through most of the wait, giving the core back to the system
+    // The sleep function can return early, then it is called again for the rest
+    while (true) {
+        now = Clock::now();
+        double remaining = Seconds(deadline_ - now);
+        if (remaining <= spin_time_) {
+            break;
+        }
+        double sleep = remaining - spin_time_;
+        sleep_(sleep);
+        double late = Seconds(Clock::now() - now) - sleep;
+        if (late < 0.0) {
+            continue;
+        }
+
+        // Spin longer as soon as a sleep wakes up too late, and shorten it slowly while they are on time
+        double margin = late * 1.5;
+        if (margin > spin_time_) {
+            spin_time_ = margin;
+        }
+        else {
+            spin_time_ -= (spin_time_ - margin) * spin_decay_g;
+        }
+        if (spin_time_ < min_spin_time_g) {
+            spin_time_ = min_spin_time_g;
+        }
+        else if (spin_time_ > max_spin_time_g) {
+            spin_time_ = max_spin_time_g;
+        }
+    }
+
+    // Spin the rest of the way, which is much more precise than sleeping
+    while (Clock::now() < deadline_) {
+        std::this_thread::yield();
+    }
+}
+
+
+void FramePacer::StartReport(Clock::time_point now)
+{
+
+    report_start_ = now;
+    report_cpu_ = ProcessCpuTime();
+    frames_ = 0;
+    sum_ = 0.0;
+    sum_squares_ = 0.0;
+    worst_ = 0.0;
+}
+
+} // namespace game
@@ -0,0 +1,103 @@
+#ifndef FRAME_PACER_H_
+#define FRAME_PACER_H_
+
+#include <chrono>
+
+namespace game {
+
+    // How the main loop paces its frames
+    enum PacingMode {
+        PACING_UNCAPPED,        // Draw as fast as possible, without vsync
+        PACING_VSYNC,           // Every swap waits for the display's refresh
+        PACING_FIXED,           // No vsync, the pacer limits the loop to a target frame rate
+        PACING_ADAPTIVE,        // Vsync, but frames that miss a refresh are shown right away instead of waiting for the next one
+                                // The limiter caps the rate at the refresh rate in case the driver ignores vsync
+        NUM_PACING_MODES
+    };
+
+    // Timing of the frames during one report period
+    struct PacingReport {
+        int mode;
+        int frames;
+        double fps;
+        double frame_ms;        // Average time from one frame to the next
+        double jitter_ms;       // Standard deviation of the time from one frame to the next
+        double worst_ms;        // Longest time from one frame to the next
+        double cpu;             // Share of one core used by the whole process, 1 is a full core
+    };
+
+    // Function the limiter sleeps with, it may return early
+    typedef void (*SleepFunction)(double seconds);
+
+    /*
+        FramePacer waits between frames and measures how evenly they come
+        The limiter sleeps for most of the wait and spins for the last bit, since sleeps wake up late by a varying amount.
+        It learns how late they wake up, so it only spins for as long as it has to.
+        While the game is idle (the window is minimized) frames are limited to a low rate in every mode,
+        so a game left running in the background doesn't keep a core busy
+    */
+    class FramePacer {
+
+        public:
+            FramePacer(void);
+
+            // Choose the mode, and the frame rate the limiter holds to in the fixed and adaptive modes
+            void SetMode(int mode, double target_fps);
+
+            // Sleep with another function than std::this_thread::sleep_for, for example one that handles window events while waiting
+            void SetSleep(SleepFunction sleep);
+
+            // Swap interval the window should use in the current mode
+            // tear_control tells if the driver takes negative intervals, which swap late frames without waiting
+            int GetSwapInterval(bool tear_control);
+
+            // Call once a frame, after the swap. Waits until the next frame is due, if the mode limits frames or the game
+            // is idle, and times the frame that just ended
+            void EndFrame(bool idle);
+
+            // True once every report period, with the timing of the frames during it
+            bool GetReport(PacingReport &report);
+
+            // Getters
+            inline int GetMode(void) { return mode_; }
+            static const char *GetModeName(int mode);
+
+        private:
+            typedef std::chrono::steady_clock Clock;
+
+            int mode_;
+
+            // Seconds per frame of the limiter, 0 if the mode doesn't limit frames
+            double period_;
+
+            // When the next frame is due, and when the last one ended
+            Clock::time_point deadline_;
+            Clock::time_point last_frame_;
+
+            // How long before the deadline the limiter stops sleeping and starts spinning
+            double spin_time_;
+            SleepFunction sleep_;
+
+            // Frame times of the current report period
+            Clock::time_point report_start_;
+            double report_cpu_;
+            int frames_;
+            double sum_;
+            double sum_squares_;
+            double worst_;
+
+            // Latest finished report, until it is taken
+            PacingReport report_;
+            bool report_ready_;
+
+            // Wait until one period after the last deadline
+            void Wait(double period);
+
+            // Start timing a new report period
+            void StartReport(Clock::time_point now);
+
+    }; // class FramePacer
+
+} // namespace game
+
+#endif // FRAME_PACER_H_
@@ -1,12 +1,23 @@
+#include <algorithm>
 #include <stdexcept>
 #include <string>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <future>
+#include <thread>
+#include <filesystem>
 #include <glm/gtc/matrix_transform.hpp> 
 #include <SOIL/SOIL.h>
 
 #include <path_config.h>
 
 #include "shader.h"
-#include "player_game_object.h"
+#include "file_utils.h"
+#include "task_graph.h"
+#include "asset_pack.h"
 #include "game.h"
 
 namespace game {
@@ -23,16 +34,316 @@ const glm::vec3 viewport_background_color_g(0.0, 0.0, 1.0);
 // Directory with game resources such as textures
 const std::string resources_directory_g = RESOURCES_DIRECTORY;
 
+// Texture files in the textures directory that are loaded at startup
+// The first ones are the game's textures in GameTexture order, the rest are biomes the level is likely to start with
+const char *texture_files_g[] = {
+    "plane_blue.png", "plane_red.png", "bullet.png", "health.png", "shield.png", "enemy_red.png", "enemy_spinner.png",
+    "enemy_sideshot.png", "enemy_largeboss.png", "heart_1.png", "heart_2.png", "heart_3.png", "playerShield.png",
+    "progressbar.png", "progressbar_arrow.png", "shield_cosmetic.png", "title.png", "bullet_green.png", "bullet_orange.png",
+    "title_win.png", "title_lose.png", "indicator_1.png", "indicator_2.png",
+    "bg1.png", "bg2.png", "bg3.png"
+};
+const int num_texture_files_g = sizeof(texture_files_g) / sizeof(texture_files_g[0]);
+static_assert(num_texture_files_g >= NUM_GAME_TEXTURES, "Every game texture needs a file");
+
+// Texture memory the game tries to stay under, in bytes. Only textures nothing uses anymore are evicted to meet it
+const std::size_t texture_budget_g = 8 * 1024 * 1024;
+
+// Shader sources in the resources directory, vertex then fragment
+const char *shader_files_g[2] = { "vertex_shader.glsl", "fragment_shader.glsl" };
+
+// Pack of cooked assets in the resources directory, see asset_cooker.cpp
+const char *pack_file_g = "assets.pack";
+
+// Watch the resources directory while playing, and load the shaders and textures again whenever they are saved
+const bool hot_reload_g = true;
+
+// Directory of the cached shader program binaries, set it to "" to always compile
+const char *shader_cache_directory_g = "shader_cache";
+
+// Most worker threads used to load files at startup
+const int max_startup_workers_g = 4;
+
+// Most threads the software renderer draws with besides the main one
+const int max_render_workers_g = 7;
+
+// Ticks whose frames are checked against golden images, when the command line doesn't name any
+const unsigned int golden_ticks_g[] = { 1, 60, 300, 600 };
+const int num_golden_ticks_g = sizeof(golden_ticks_g) / sizeof(golden_ticks_g[0]);
+
+// How far a channel may be off before its pixel differs from the golden image, and what share of pixels may differ
+// The slack covers drivers that blend or filter a little differently, not things drawn in the wrong place
+const int golden_threshold_g = 2;
+const double golden_tolerance_g = 0.001;
+
+// Firing patterns: type, bullet count, arc, speed, offset and spin
+const BulletPattern player_shot_g = { PATTERN_SPREAD, 1, 0.0f, 16.0f, 0.0f, 0.0f };
+const BulletPattern player_spread_g = { PATTERN_SPREAD, 3, 60.0f, 8.0f, 0.0f, 0.0f };
+const BulletPattern enemy_shot_g = { PATTERN_SPREAD, 1, 0.0f, 2.0f, 0.0f, 0.0f };
+const BulletPattern spinner_shot_g = { PATTERN_RADIAL, 4, 0.0f, 2.0f, 90.0f, 0.0f };
+const BulletPattern sideshot_g = { PATTERN_RADIAL, 2, 0.0f, 2.0f, -90.0f, 0.0f };
+const BulletPattern boss_spiral_g = { PATTERN_SPIRAL, 12, 0.0f, 2.0f, 0.0f, 7.5f };
+
+// Size bullets are drawn at
+const float bullet_scale_g = 0.5f;
+
+// Starting values of every kind of enemy, in EnemyKind order
+// Texture, velocity, angle, scale, health, fire rate, and whether running into the player hurts it
+struct EnemySetup {
+    const char *tag;
+    int texture;
+    glm::vec3 velocity;
+    float angle;
+    float scale;
+    int health;
+    double rof;
+    bool rams;
+    const char *message;
+};
+const EnemySetup enemy_setup_g[] = {
+    { "plane", TEX_ENEMY_RED, glm::vec3(0.0f, 0.0f, 0.0f), 180.0f, 1.0f, 1, 2.5, true, "A NEW ENEMY PLANE" },
+    { "plane2", TEX_ENEMY_SPINNER, glm::vec3(0.0f, -1.0f, 0.0f), 0.0f, 1.0f, 1, 2.5, true, "A NEW ENEMY PLANE2 (SPINNER)" },
+    { "plane3", TEX_ENEMY_SIDESHOT, glm::vec3(0.0f, 0.06f, 0.0f), 180.0f, 1.0f, 1, 2.5, false, "A NEW ENEMY PLANE3 (SIDE STEPPER)" },
+    { "plane4", TEX_ENEMY_SIDESHOT, glm::vec3(0.0f, -0.06f, 0.0f), 180.0f, 1.0f, 1, 0.5, false, "A NEW ENEMY PLANE4 (SIDESHOT)" },
+    { "planeboss", TEX_ENEMY_BOSS, glm::vec3(0.0f, 0.0f, 0.0f), 180.0f, 2.0f, 11, 0.5, false, "THE BOSS" }
+};
+const int num_enemy_kinds_g = sizeof(enemy_setup_g) / sizeof(enemy_setup_g[0]);
+
+// Tag and texture of every kind of pickup, in PickupKind order
+struct PickupSetup {
+    const char *tag;
+    int texture;
+    const char *message;
+};
+const PickupSetup pickup_setup_g[] = {
+    { "health", TEX_HEALTH, "A NEW HEALTH PICKUP" },
+    { "shield", TEX_SHIELD, "A NEW SHIELD PICKUP" }
+};
+const int num_pickup_kinds_g = sizeof(pickup_setup_g) / sizeof(pickup_setup_g[0]);
+
+// Level description, and whether it should loop forever instead of ending with the boss
+const std::string level_file_g = "/level.txt";
+const bool endless_mode_g = false;
+
+// The simulation runs in fixed ticks, however long the frames take to draw
+// After a long stall only a few ticks are caught up, instead of freezing to run all of them
+const double sim_tick_g = 1.0 / 60.0;
+const double max_frame_time_g = 0.25;
+
+// Seed of the simulation's random numbers, the same every run like rand() was
+const unsigned long long random_seed_g = 2501;
+
+// Ticks that can be rewound (3 seconds), and the file of the quick save
+const int rewind_ticks_g = 180;
+const char *quicksave_file_g = "quicksave.bin";
+
+// Environment variables that turn on the hash log of every tick, and the values of every entity in it
+const char *hash_log_env_g = "GAME_HASH_LOG";
+const char *hash_detail_env_g = "GAME_HASH_DETAIL";
+
+// Local two player mode, where the second player plays through a loopback peer with some ticks of latency
+// A rollback goes back at most max_rollback_ticks_g ticks, so that is the most latency the peer can have
+const bool two_player_mode_g = false;
+const int loopback_delay_g = 6;
+const int max_rollback_ticks_g = 8;
+
+// How frames are paced (see frame_pacer.h), and the frame rate of the fixed mode
+// The adaptive mode holds to the display's refresh rate. P cycles through the modes while playing
+const int pacing_mode_g = PACING_ADAPTIVE;
+const double target_fps_g = 60.0;
+
+// Keys of each player, in InputButton order: up, down, left, right, fire, first and second weapon
+const int num_input_buttons_g = 7;
+const int input_keys_g[MAX_PLAYERS][num_input_buttons_g] = {
+    { GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_SPACE, GLFW_KEY_Q, GLFW_KEY_E },
+    { GLFW_KEY_UP, GLFW_KEY_DOWN, GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_RIGHT_CONTROL, GLFW_KEY_PERIOD, GLFW_KEY_SLASH }
+};
+
+
+// Seconds on a steady clock, which unlike the GLFW timer is there without a window
+static double Now(void)
+{
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 
 Game::Game(void)
 {
     // Don't do work in the constructor, leave it for the Init() function
+    window_ = NULL;
+    renderer_ = &gl_renderer_;
+    goldens_checked_ = 0;
+    goldens_failed_ = 0;
+}
+
+
+void Game::Init(const GameOptions &options)
+{
+
+    startup_time_ = std::chrono::steady_clock::now();
+    options_ = options;
+    if (options_.golden_directory.empty()) {
+        options_.capture_ticks.clear();
+    }
+    else if (options_.capture_ticks.empty()) {
+        options_.capture_ticks.assign(golden_ticks_g, golden_ticks_g + num_golden_ticks_g);
+    }
+
+    // Startup runs as a graph of tasks. Files are read and decoded on workers while the window and its OpenGL context
+    // come up on this thread, and each texture is uploaded as soon as both the context and its image are ready
+    TaskGraph startup;
+
+    // Assets come from the cooked pack, or from the loose files when the pack is missing or older than them
+    // The resource manager keeps the pack mapped, so textures are uploaded straight from it, also when they are loaded again later
+    resources_.SetDirectory(resources_directory_g);
+    resources_.SetBudget(texture_budget_g);
+    TextureHandle startup_textures[num_texture_files_g];
+    for (int i = 0; i < num_texture_files_g; i++) {
+        startup_textures[i] = resources_.GetTexture(std::string("textures/") + texture_files_g[i]);
+    }
+    for (int i = 0; i < NUM_GAME_TEXTURES; i++) {
+        textures_[i] = startup_textures[i];
+        resources_.Acquire(textures_[i]);
+    }
+
+    // The null renderer never draws a texture, so only their names are needed
+    if (options_.null_renderer) {
+        renderer_ = &null_renderer_;
+        printf("[!] Drawing through the null renderer, without an OpenGL context\n");
+        return;
+    }
+
+    // The software renderer decodes the textures it draws itself, from the pack or the loose files
+    if (options_.software_renderer) {
+        if (!resources_.OpenPack((resources_directory_g + "/" + pack_file_g).c_str())) {
+            printf("[?] No valid %s, loading loose files\n", pack_file_g);
+        }
+        int workers = (int) std::thread::hardware_concurrency() - 1;
+        workers = workers < 0 ? 0 : (workers > max_render_workers_g ? max_render_workers_g : workers);
+        software_renderer_.Init(window_width_g, window_height_g, &resources_, workers);
+        renderer_ = &software_renderer_;
+        printf("[!] Drawing in software on %d threads, without an OpenGL context\n", workers + 1);
+        return;
+    }
+
+    int opened = startup.Add("open pack", [this]() {
+        if (!resources_.OpenPack((resources_directory_g + "/" + pack_file_g).c_str())) {
+            printf("[?] No valid %s, loading loose files\n", pack_file_g);
+        }
+    }, false);
+
+    // Where each asset came from, and how long it took to get ready
+    // The workers start before GLFW, so they time themselves with the standard clock
+    typedef std::chrono::steady_clock Clock;
+    struct AssetTiming {
+        bool from_pack = false;
+        double seconds = 0.0;
+    };
+    AssetTiming timings[num_texture_files_g + 2];
+
+    MappedFile shader_files[2];
+    std::string_view shader_sources[2];
+    int sources = startup.Add("read shaders", [&]() {
+        AssetPack &pack = resources_.GetPack();
+        for (int i = 0; i < 2; i++) {
+            Clock::time_point start = Clock::now();
+            std::string loose = resources_directory_g + "/" + shader_files_g[i];
+            const PackEntry *entry = pack.Find(shader_files_g[i]);
+            if (entry && entry->kind == PACK_TEXT && pack.IsFresh(entry, loose.c_str())) {
+                shader_sources[i] = std::string_view(pack.GetData(entry), entry->size);
+                timings[num_texture_files_g + i].from_pack = true;
+            }
+            else {
+                if (!shader_files[i].Open(loose.c_str())) {
+                    throw(std::ios_base::failure(std::string("Error opening file ") + loose));
+                }
+                shader_sources[i] = shader_files[i].GetText();
+            }
+            timings[num_texture_files_g + i].seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+    }, false, { opened });
+
+    // SOIL only shares its last error message between threads, decoding itself is independent
+    TextureImage images[num_texture_files_g];
+    int decoded[num_texture_files_g];
+    for (int i = 0; i < num_texture_files_g; i++) {
+        decoded[i] = startup.Add("decode textures", [&, i]() {
+            Clock::time_point start = Clock::now();
+            images[i] = resources_.Decode(startup_textures[i]);
+            timings[i].from_pack = images[i].from_pack;
+            timings[i].seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        }, false, { opened });
+    }
+
+    int window = startup.Add("create window", [this]() { OpenWindow(); }, true);
+    int context = startup.Add("init opengl", [this]() { InitGraphics(); }, true, { window });
+    startup.Add("compile shaders", [&]() {
+        shader_.SetCacheDirectory(shader_cache_directory_g);
+        shader_.InitFromSource(shader_sources[0], shader_sources[1]);
+        shader_.Enable();
+    }, true, { context, sources });
+    for (int i = 0; i < num_texture_files_g; i++) {
+        startup.Add("upload textures", [&, i]() {
+            resources_.Upload(startup_textures[i], images[i]);
+        }, true, { context, decoded[i] });
+    }
+
+    // Leave a core for this thread
+    int workers = (int) std::thread::hardware_concurrency() - 1;
+    workers = workers < 1 ? 1 : (workers > max_startup_workers_g ? max_startup_workers_g : workers);
+    try {
+        startup.Run(workers);
+    }
+    catch (...) {
+        for (int i = 0; i < num_texture_files_g; i++) {
+            ResourceManager::FreeImage(images[i]);
+        }
+        throw;
+    }
+
+    startup.PrintReport();
+
+    // Time spent getting assets ready from the pack and from loose files, summed over every worker
+    int num_packed = 0;
+    double packed_time = 0.0;
+    double loose_time = 0.0;
+    for (int i = 0; i < num_texture_files_g + 2; i++) {
+        num_packed += timings[i].from_pack ? 1 : 0;
+        (timings[i].from_pack ? packed_time : loose_time) += timings[i].seconds;
+    }
+    printf("[!] Assets: %d from %s in %.2f ms, %d from loose files in %.2f ms\n",
+        num_packed, pack_file_g, packed_time * 1000.0, num_texture_files_g + 2 - num_packed, loose_time * 1000.0);
+
+    const ShaderCacheStats &cache = shader_.GetCacheStats();
+    printf("[!] Shader cache: %d hits, %d misses, %d rejected, %d saved, %.2f ms loading binaries, %.2f ms compiling\n",
+        cache.hits, cache.misses, cache.rejected, cache.saved, cache.load_ms, cache.compile_ms);
+    PrintTextureStats();
+
+    if (hot_reload_g && !options_.headless) {
+        if (watcher_.Watch(resources_directory_g) && watcher_.Watch(resources_directory_g + "/textures")) {
+            printf("[!] Watching %s for changed shaders and textures\n", resources_directory_g.c_str());
+        }
+        else {
+            printf("[?] Could not watch %s, shaders and textures won't be reloaded\n", resources_directory_g.c_str());
+        }
+    }
 }
 
 
-void Game::Init(void)
+void Game::OpenWindow(void)
 {
 
+    // Without a window, the context draws into a framebuffer the size the window would have been
+    if (options_.headless) {
+        std::string error;
+        if (!headless_.Open(window_width_g, window_height_g, error)) {
+            throw(std::runtime_error(error));
+        }
+        printf("[!] Drawing offscreen through %s\n", headless_.GetBackendName());
+        return;
+    }
+
     // Initialize the window management library (GLFW)
     if (!glfwInit()) {
         throw(std::runtime_error(std::string("Could not initialize the GLFW library")));
@@ -51,39 +362,69 @@ void Game::Init(void)
 
     // Make the window's OpenGL context the current one
     glfwMakeContextCurrent(window_);
+}
+
+
+void Game::InitGraphics(void)
+{
 
     // Initialize the GLEW library to access OpenGL extensions
     // Need to do it after initializing an OpenGL context
     glewExperimental = GL_TRUE;
     GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW built for GLX finds no GLX display with the headless contexts, but the OpenGL functions are loaded anyway
+    if (options_.headless && err == GLEW_ERROR_NO_GLX_DISPLAY) {
+        err = GLEW_OK;
+    }
+#endif
     if (err != GLEW_OK) {
         throw(std::runtime_error(std::string("Could not initialize the GLEW library: ") + std::string((const char *)glewGetErrorString(err))));
     }
 
-    // Set event callbacks
-    glfwSetFramebufferSizeCallback(window_, ResizeCallback);
+    if (options_.headless) {
+        headless_.CreateFramebuffer();
+    }
+    else {
+        InitWindowEvents();
+    }
 
-    // Set up square geometry
-    size_ = CreateSprite();
+    // Set up square geometry, the shader's attributes point into it, and the depth test and blending
+    gl_renderer_.Init(&shader_, &resources_);
+}
 
-    // Initialize shader
-    shader_.Init((resources_directory_g+std::string("/vertex_shader.glsl")).c_str(), (resources_directory_g+std::string("/fragment_shader.glsl")).c_str());
-    shader_.Enable();
 
-    // Set up z-buffer for rendering
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
+void Game::InitWindowEvents(void)
+{
 
-    // Enable Alpha blending
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    // Set event callbacks
+    glfwSetWindowUserPointer(window_, this);
+    glfwSetFramebufferSizeCallback(window_, ResizeCallback);
+    glfwSetKeyCallback(window_, KeyCallback);
+
+    // Pace frames to the display, or to the target frame rate
+    const GLFWvidmode *video_mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    refresh_rate_ = (video_mode && video_mode->refreshRate > 0) ? video_mode->refreshRate : target_fps_g;
+    tear_control_ = glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+    pacer_.SetSleep(WaitEvents);
+    SetPacing(pacing_mode_g);
 }
 
 
 Game::~Game()
 {
 
-    glfwDestroyWindow(window_);
+    // Wait for the textures still being decoded, then the textures go before their context
+    for (int i = 0; i < texture_reloads_.size(); i++) {
+        TextureImage image = texture_reloads_[i].image.get();
+        ResourceManager::FreeImage(image);
+    }
+    resources_.Clear();
+    capture_.Clear();
+    software_renderer_.Clear();
+    if (window_) {
+        glfwDestroyWindow(window_);
+    }
     glfwTerminate();
 }
 
@@ -91,711 +432,1904 @@ Game::~Game()
 void Game::Setup(void)
 {
 
-    // Load textures
-    SetAllTextures();
-
+    // Textures were loaded by Init
     state = "game";
 
-    // Setup the player object (position, texture, vertex count)
-    // Note that, in this specific implementation, the player object should always be the first object in the game object vector 
-    game_objects_.push_back(new PlayerGameObject(glm::vec3(0.0f, 0.0f, 0.0f), tex_[0], size_, "player", tex_[15]));
-    game_objects_[0]->SetROF(0.4);
-
-    GameObject* orbit = new GameObject(glm::vec3(0.5f, 0.0f, 0.0f), tex_[21], size_, "orbit");
-    orbit->SetScale(0.0f);
-    game_objects_[0]->child_.push_back(orbit);
-    orbit = new GameObject(glm::vec3(-0.5f, 0.0f, 0.0f), tex_[21], size_, "orbit");
-    orbit->SetScale(0.0f);
-    game_objects_[0]->child_.push_back(orbit);
-    orbit = new GameObject(glm::vec3(0.0f, 0.5f, 0.0f), tex_[21], size_, "orbit");
-    orbit->SetScale(0.0f);
-    game_objects_[0]->child_.push_back(orbit);
-    orbit = new GameObject(glm::vec3(0.0f, -0.5f, 0.0f), tex_[21], size_, "orbit");
-    orbit->SetScale(0.0f);
-    game_objects_[0]->child_.push_back(orbit);
-
-    GameObject* heart = new GameObject(glm::vec3(0.0f, 0.0f, 0.0f), tex_[14], size_, "heart");
-    heart->SetScale(1);
-    game_objects_.push_back(heart);
-
-    //spawn some powerups
-    //game_objects_.push_back(new GameObject(glm::vec3(-1.0f, 7.0f, 0.0f), tex_[6], size_, "health"));
-    //game_objects_.push_back(new GameObject(glm::vec3(1.0f, 8.0f, 0.0f), tex_[7], size_, "shield"));
+    // Start the simulation clock
+    sim_time_ = 0.0;
+    tick_ = 0;
+    timers_.Reset(sim_time_);
+    random_.Seed(random_seed_g);
+    session_ = (unsigned long long) std::chrono::steady_clock::now().time_since_epoch().count();
+    scripts_.Init(&timers_, [this](const Volley &volley) { EmitVolley(volley); });
+
+    // Level entities live in the level arena
+    world_.SetArena(&level_arena_);
+
+    // Tell the world about every component
+    world_.Register<Transform>();
+    world_.Register<Motion>();
+    world_.Register<Sprite>();
+    world_.Register<Collider>();
+    world_.Register<Health>();
+    world_.Register<Player>();
+    world_.Register<Enemy>();
+    world_.Register<Pickup>();
+    world_.Register<Hud>();
+    world_.Register<Attach>();
+    world_.Register<ShieldPart>();
+
+    // Setup the players, the second one starts next to the first
+    num_players_ = two_player_mode_g ? 2 : 1;
+    player_ = CreatePlayer(TEX_PLANE_BLUE, glm::vec3(0.0f, 0.0f, 0.0f));
+    players_[0] = player_;
+    if (num_players_ > 1) {
+        players_[1] = CreatePlayer(TEX_PLANE_RED, glm::vec3(1.5f, 0.0f, 0.0f));
+    }
+
+    // Hash every tick if asked to, to compare runs with the desync tool
+    const char *hash_log = getenv(hash_log_env_g);
+    if (hash_log && hash_log[0]) {
+        const char *detail = getenv(hash_detail_env_g);
+        if (hash_log_.Open(hash_log, detail && detail[0] == '1')) {
+            printf("[!] Writing the hash of every tick to %s\n", hash_log);
+        }
+        else {
+            printf("[?] Could not open hash log %s\n", hash_log);
+        }
+    }
+
+    // Nobody holds any button yet
+    inputs_.Clear();
+    peer_.SetDelay(loopback_delay_g < max_rollback_ticks_g ? loopback_delay_g : max_rollback_ticks_g);
+    rollback_time_ = 0.0;
+    rollback_ticks_ = 0;
+    meter_elapsed_ = 0.0;
+    meter_total_ = 0.0;
+    meter_max_ = 0.0;
+    meter_frames_ = 0;
+    meter_ticks_ = 0;
+    rollback_text_[0] = '\0';
 
     // Setup hud
-    GameObject* hud = new GameObject(glm::vec3(0.0001f, 0.0f, 0.0f), tex_[22], size_, "title");
-    hud->SetScale(5.0f);
-    fg_objects_.push_back(hud);
-    hud = new GameObject(glm::vec3(0.0f, -1.0f, 0.0f), tex_[16], size_, "hud_bar");
-    hud->SetScale(5.0f);
-    fg_objects_.push_back(hud);
-    hud = new GameObject(glm::vec3(0.0f, -2.0f, 0.0f), tex_[17], size_, "hud_arrow");
-    hud->SetScale(0.5f);
-    fg_objects_.push_back(hud);
-    hud = new GameObject(glm::vec3(0.0f, 1.0f, 0.0f), tex_[25], size_, "title_win");
-    hud->SetScale(0.0f);
-    fg_objects_.push_back(hud);
-    hud = new GameObject(glm::vec3(0.0f, 1.0f, 0.0f), tex_[26], size_, "title_lose");
-    hud->SetScale(0.0f);
-    fg_objects_.push_back(hud);
-    hud = new GameObject(glm::vec3(-2.0f, 6.0f, 0.0f), tex_[27], size_, "indicator1");
-    hud->SetScale(0.5f);
-    fg_objects_.push_back(hud);
-    hud = new GameObject(glm::vec3(-2.0f, 6.0f, 0.0f), tex_[28], size_, "indicator2");
-    hud->SetScale(0.5f);
-    fg_objects_.push_back(hud);
-    
-    int texnumber = 3;
-
-    // Setup background
-    for (int i = 0; i < 100; i++) {
-
-        if (i < 16) {
-            texnumber = 18;
-        }else if (i < 30) {
-            texnumber = 19;
-        }else{
-            texnumber = 20;
-        }
-
-        GameObject* background = new GameObject(glm::vec3(0.0f, i * 10, 0.0f), tex_[texnumber], size_, "ground");
-        background->SetScale(10.0);
-        bg_objects_.push_back(background);
+    struct HudSetup {
+        int kind;
+        glm::vec3 position;
+        int texture;
+        float scale;
+    };
+    HudSetup hud[] = {
+        { HUD_TITLE, glm::vec3(0.0001f, 0.0f, 0.0f), TEX_TITLE, 5.0f },
+        { HUD_BAR, glm::vec3(0.0f, -1.0f, 0.0f), TEX_PROGRESS_BAR, 5.0f },
+        { HUD_ARROW, glm::vec3(0.0f, -2.0f, 0.0f), TEX_PROGRESS_ARROW, 0.5f },
+        { HUD_WIN, glm::vec3(0.0f, 1.0f, 0.0f), TEX_TITLE_WIN, 0.0f },
+        { HUD_LOSE, glm::vec3(0.0f, 1.0f, 0.0f), TEX_TITLE_LOSE, 0.0f },
+        { HUD_WEAPON1, glm::vec3(-2.0f, 6.0f, 0.0f), TEX_INDICATOR_1, 0.5f },
+        { HUD_WEAPON2, glm::vec3(-2.0f, 6.0f, 0.0f), TEX_INDICATOR_2, 0.5f },
+        { HUD_HEART, glm::vec3(0.0f, 0.0f, 0.0f), TEX_HEART_3, 1.0f }
+    };
+    for (int i = 0; i < sizeof(hud) / sizeof(hud[0]); i++) {
+        Entity e = world_.Create(MaskOf<Transform, Sprite, Hud>());
+        world_.Get<Transform>(e).position = hud[i].position;
+        world_.Get<Transform>(e).scale = hud[i].scale;
+        world_.Get<Sprite>(e).texture = textures_[hud[i].texture];
+        world_.Get<Sprite>(e).layer = LAYER_HUD;
+        world_.Get<Hud>(e).kind = hud[i].kind;
+
+        if (hud[i].kind == HUD_BAR) {
+            hud_bar_ = e;
+        }
     }
+
+    // Keep an image of the level's entities for restarts
+    world_.Save(initial_world_);
+
+    // Setup the level
+    // The chunks and their biomes come from the level file, and are streamed in as the player moves
+    level_.Load((resources_directory_g + level_file_g).c_str(), resources_, endless_mode_g);
+    StreamLevel();
+
+    // The first tick that can be rewound to is the start of the level
+    snapshots_.resize(rewind_ticks_g);
+    snapshot_head_ = 0;
+    num_snapshots_ = 0;
+    RecordSnapshot();
 }
 
 
 void Game::MainLoop(void)
 {
 
+    if (options_.headless) {
+        RunHeadless();
+        return;
+    }
+
     // Loop while the user did not close the window
-    double lastTime = glfwGetTime();
+    double lastTime = Now();
+    double accumulator = 0.0;
+    bool first_frame = true;
     while (!glfwWindowShouldClose(window_)){
 
-        // Clear background
-        glClearColor(viewport_background_color_g.r,
-                     viewport_background_color_g.g,
-                     viewport_background_color_g.b, 0.0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // In debug builds, count the heap allocations of the frame. Once the game has warmed up there should be none
+        AllocationCounter::Start();
 
-        // Set view to zoom out, centered by default at 0,0
-        float cameraZoom = 0.25f;
-        GameObject* player = game_objects_[0];
-
-        // Use aspect ratio to properly scale the window
-        int width, height;
-        glfwGetWindowSize(window_, &width, &height);
-        float aspect_ratio = ((float)width) / ((float)height);
+        // Calculate delta time
+        double currentTime = Now();
+        double deltaTime = currentTime - lastTime;
+        lastTime = currentTime;
 
-        // Set view to zoom out, centered by default at 0,0
-        glm::mat4 window_scale = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / aspect_ratio, 1.0f, 1.0f));
-        glm::mat4 camera_zoom = glm::scale(glm::mat4(1.0f), glm::vec3(cameraZoom, cameraZoom, cameraZoom));
+        // Handle the window events that came in since the pacer's wait, right before the ticks that use them
+        glfwPollEvents();
 
-        if (state == "win" || state == "lose") {
-            camera_zoom = glm::translate(camera_zoom, -glm::vec3(0, fg_objects_[0]->GetPosition()[1] + 0.8, 0));
+        // Run the simulation ticks that are due. Each tick is recorded, so holding backspace plays them backwards
+        accumulator += deltaTime;
+        if (accumulator > max_frame_time_g) {
+            accumulator = max_frame_time_g;
         }
-        else {
-            camera_zoom = glm::translate(camera_zoom, -glm::vec3(0, player->GetPosition()[1] + 2.0f, 0));
+        while (accumulator >= sim_tick_g) {
+            TakeKeyEvents();
+            if (KeyDown(GLFW_KEY_BACKSPACE)) {
+                Rewind();
+            }
+            else {
+                StepSimulation();
+            }
+            accumulator -= sim_tick_g;
+        }
+        SnapshotControls();
+        PacingControls();
+        if (num_players_ > 1) {
+            UpdateRollbackMeter(deltaTime);
         }
 
-        glm::mat4 view_matrix = window_scale * camera_zoom;
-        shader_.SetUniformMat4("view_matrix", view_matrix);
+        // Pick up the shaders and textures that were saved since the last frame
+        HotReload();
 
-        // Calculate delta time
-        double currentTime = glfwGetTime();
-        double deltaTime = currentTime - lastTime;
-        lastTime = currentTime;
+        // Draw the game, then give back the memory of textures that went unused for longest if over the budget
+        Render();
+        resources_.Trim();
 
-        // Update the game
-        Update(deltaTime);
+        // Everything allocated for this frame is given back at once
+        frame_arena_.Reset();
+
+        int allocations = AllocationCounter::Stop();
+        if (allocations > 0) {
+            printf("[?] %d heap allocations during the frame\n", allocations);
+        }
 
         // Push buffer drawn in the background onto the display
         glfwSwapBuffers(window_);
+        MeasureInputLatency();
+        if (first_frame) {
+            double startup = std::chrono::duration<double>(std::chrono::steady_clock::now() - startup_time_).count();
+            printf("[!] First frame shown %.1f ms after startup\n", startup * 1000.0);
+            first_frame = false;
+        }
 
-        // Update other events like input handling
-        glfwPollEvents();
+        // Wait for the next frame, and measure how evenly they come
+        // A minimized window is only drawn a few times a second
+        pacer_.EndFrame(glfwGetWindowAttrib(window_, GLFW_ICONIFIED) != 0);
+        ShowFrameStats();
     }
+
+    LatencySummary latency;
+    input_latency_.Summarize(latency);
+    if (latency.count > 0) {
+        printf("[!] Input to present latency of %d key events: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+            latency.count, latency.p50 * 1000.0, latency.p90 * 1000.0, latency.p99 * 1000.0, latency.max * 1000.0);
+    }
+    PrintTextureStats();
 }
 
 
-void Game::ResizeCallback(GLFWwindow* window, int width, int height)
+void Game::RunHeadless(void)
 {
 
-    // Set OpenGL viewport based on framebuffer width and height
-    glViewport(0, 0, width, height);
-}
+    // One tick per frame, so the frames don't depend on how fast this machine draws them
+    // The run goes on at least until the last frame that is captured
+    int frames = options_.frames;
+    for (int i = 0; i < options_.capture_ticks.size(); i++) {
+        frames = std::max(frames, (int) options_.capture_ticks[i]);
+    }
+    if (!options_.capture_ticks.empty() && renderer_ == &gl_renderer_) {
+        capture_.Init(headless_.GetWidth(), headless_.GetHeight());
+    }
 
+    LatencyStats frame_times(frames > 0 ? frames : 1);
+    double start = Now();
+    unsigned int captured;
+    for (int frame = 0; frame < frames; frame++) {
+        double frame_start = Now();
+        StepSimulation();
+        Render();
+
+        // Frames are read back a few frames late, so reading them doesn't stall the one being drawn
+        // The software renderer's frames are in memory already
+        int width = capture_.GetWidth(), height = capture_.GetHeight();
+        if (std::find(options_.capture_ticks.begin(), options_.capture_ticks.end(), tick_) != options_.capture_ticks.end()) {
+            if (renderer_ == &software_renderer_) {
+                const unsigned char *pixels = software_renderer_.GetPixels();
+                frame_pixels_.assign(pixels, pixels + (std::size_t) software_renderer_.GetWidth() * software_renderer_.GetHeight() * 4);
+                CheckFrame(tick_, frame_pixels_, software_renderer_.GetWidth(), software_renderer_.GetHeight());
+            }
+            else {
+                while (capture_.IsFull() && capture_.Take(captured, frame_pixels_, true)) {
+                    CheckFrame(captured, frame_pixels_, width, height);
+                }
+                capture_.Capture(tick_);
+            }
+        }
+        while (capture_.Take(captured, frame_pixels_, false)) {
+            CheckFrame(captured, frame_pixels_, width, height);
+        }
+        resources_.Trim();
+        frame_arena_.Reset();
 
-// Create the geometry for a sprite (a squared composed of two triangles)
-// Return the number of array elements that form the square
-int Game::CreateSprite(void)
-{
-    // The face of the square is defined by four vertices and two triangles
+        // Nothing is swapped, so wait for the frame to be drawn to time it
+        if (renderer_ == &gl_renderer_) {
+            glFinish();
+        }
+        frame_times.Add(Now() - frame_start);
+        if (frame == 0) {
+            double startup = std::chrono::duration<double>(std::chrono::steady_clock::now() - startup_time_).count();
+            printf("[!] First frame drawn %.1f ms after startup\n", startup * 1000.0);
+        }
+    }
 
-    // Number of attributes for vertices and faces
-    // const int vertex_att = 7;  // 7 attributes per vertex: 2D (or 3D) position (2), RGB color (3), 2D texture coordinates (2)
-    // const int face_att = 3; // Vertex indices (3)
+    LatencySummary summary;
+    frame_times.Summarize(summary);
+    printf("[!] Drew %d frames offscreen in %.1f ms, per frame: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+        frames, (Now() - start) * 1000.0, summary.p50 * 1000.0, summary.p90 * 1000.0, summary.p99 * 1000.0,
+        summary.max * 1000.0);
+    const RenderStats &stats = renderer_->GetStats();
+    printf("[!] Renderer: %lld frames, %lld sprites (%d in the last frame), %lld draw calls, %d background bakes\n",
+        stats.frames, stats.sprites, stats.frame_sprites, stats.draw_calls, stats.bakes);
+    PrintTextureStats();
+
+    while (capture_.GetNumPending() > 0) {
+        if (capture_.Take(captured, frame_pixels_, true)) {
+            CheckFrame(captured, frame_pixels_, capture_.GetWidth(), capture_.GetHeight());
+        }
+    }
+    if (!options_.dump_file.empty() && renderer_ == &software_renderer_) {
+        if (software_renderer_.SavePNG(options_.dump_file.c_str())) {
+            printf("[!] Saved the last frame to %s\n", options_.dump_file.c_str());
+        }
+        else {
+            printf("[?] Could not save the last frame to %s\n", options_.dump_file.c_str());
+        }
+    }
+    if (options_.golden_directory.empty() || options_.update_goldens) {
+        return;
+    }
 
-    GLfloat vertex[]  = {
-        // Four vertices of a square
-        // Position      Color                Texture coordinates
-        -0.5f,  0.5f,    1.0f, 0.0f, 0.0f,    0.0f, 0.0f, // Top-left
-         0.5f,  0.5f,    0.0f, 1.0f, 0.0f,    1.0f, 0.0f, // Top-right
-         0.5f, -0.5f,    0.0f, 0.0f, 1.0f,    1.0f, 1.0f, // Bottom-right
-        -0.5f, -0.5f,    1.0f, 1.0f, 1.0f,    0.0f, 1.0f  // Bottom-left
-    };
+    // A tick the run never reached, or drew twice after a rollback, fails as well
+    int missing = (int) options_.capture_ticks.size() - goldens_checked_;
+    printf("[!] %d of %d frames matched their golden image\n", goldens_checked_ - goldens_failed_,
+        (int) options_.capture_ticks.size());
+    if (goldens_failed_ > 0 || missing != 0) {
+        throw(std::runtime_error(std::string("Frames differ from the golden images in ") + options_.golden_directory));
+    }
+}
 
-    // Two triangles referencing the vertices
-    GLuint face[] = {
-        0, 1, 2, // t1
-        2, 3, 0  //t2
-    };
 
-    // OpenGL buffers
-    GLuint vbo, ebo;
+void Game::CheckFrame(unsigned int tick, const std::vector<unsigned char> &pixels, int width, int height)
+{
 
-    // Create buffer for vertices
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertex), vertex, GL_STATIC_DRAW);
+    if (options_.golden_directory.empty()) {
+        return;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "/tick_%06u", tick);
+    std::string path = options_.golden_directory + name;
+
+    if (options_.update_goldens) {
+        std::error_code error;
+        std::filesystem::create_directories(options_.golden_directory, error);
+        if (SOIL_save_image((path + ".tga").c_str(), SOIL_SAVE_TYPE_TGA, width, height, 4, pixels.data())) {
+            printf("[!] Saved the golden image of tick %u to %s.tga\n", tick, path.c_str());
+        }
+        else {
+            printf("[?] Could not save the golden image of tick %u to %s.tga\n", tick, path.c_str());
+        }
+        return;
+    }
 
-    // Create buffer for faces (index buffer)
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(face), face, GL_STATIC_DRAW);
+    // A missing golden image, or one of another size, fails the frame
+    goldens_checked_++;
+    int golden_width = 0, golden_height = 0;
+    unsigned char *golden = SOIL_load_image((path + ".tga").c_str(), &golden_width, &golden_height, 0, SOIL_LOAD_RGBA);
+    bool passed = false;
+    if (!golden) {
+        printf("[?] Tick %u: no golden image at %s.tga\n", tick, path.c_str());
+    }
+    else if (golden_width != width || golden_height != height) {
+        printf("[?] Tick %u: the golden image is %dx%d, the frame is %dx%d\n", tick, golden_width, golden_height,
+            width, height);
+    }
+    else {
+        ImageDifference difference = CompareImages(golden, pixels.data(), width, height, golden_threshold_g);
+        double share = (double) difference.differing / ((double) width * height);
+        passed = share <= golden_tolerance_g;
+        printf("[%s] Tick %u: %d pixels differ (%.3f%%), max error %d, rms error %.3f\n", passed ? "!" : "?", tick,
+            difference.differing, share * 100.0, difference.max_error, difference.rms_error);
+    }
+    if (golden) {
+        SOIL_free_image_data(golden);
+    }
 
-    // Return number of elements in array buffer (6 in this case)
-    return sizeof(face) / sizeof(GLuint);
+    // Keep the frame that failed next to its golden image, to look at the two
+    if (!passed) {
+        goldens_failed_++;
+        SOIL_save_image((path + ".actual.tga").c_str(), SOIL_SAVE_TYPE_TGA, width, height, 4, pixels.data());
+    }
 }
 
 
-void Game::SetTexture(GLuint w, const char *fname)
+bool Game::KeyDown(int key)
 {
-    // Bind texture buffer
-    glBindTexture(GL_TEXTURE_2D, w);
 
-    // Load texture from a file to the buffer
-    int width, height;
-    unsigned char* image = SOIL_load_image(fname, &width, &height, 0, SOIL_LOAD_RGBA);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-    SOIL_free_image_data(image);
-
-    // Texture Wrapping
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    // Texture Filtering
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-}
-
-
-void Game::SetAllTextures(void)
-{
-    // Load all textures that we will need
-    glGenTextures(NUM_TEXTURES, tex_);
-    SetTexture(tex_[0], (resources_directory_g+std::string("/textures/plane_blue.png")).c_str());
-    SetTexture(tex_[1], (resources_directory_g+std::string("/textures/plane_red.png")).c_str());
-    SetTexture(tex_[2], (resources_directory_g+std::string("/textures/plane_green.png")).c_str());
-    SetTexture(tex_[3], (resources_directory_g+std::string("/textures/bg1.png")).c_str());
-    SetTexture(tex_[4], (resources_directory_g + std::string("/textures/bullet.png")).c_str());
-    SetTexture(tex_[5], (resources_directory_g + std::string("/textures/missile.png")).c_str());
-    SetTexture(tex_[6], (resources_directory_g + std::string("/textures/health.png")).c_str());
-    SetTexture(tex_[7], (resources_directory_g + std::string("/textures/shield.png")).c_str());
-    SetTexture(tex_[8], (resources_directory_g + std::string("/textures/enemy_red.png")).c_str());
-    SetTexture(tex_[9], (resources_directory_g + std::string("/textures/enemy_spinner.png")).c_str());
-    SetTexture(tex_[10], (resources_directory_g + std::string("/textures/enemy_sideshot.png")).c_str());
-    SetTexture(tex_[11], (resources_directory_g + std::string("/textures/enemy_largeboss.png")).c_str());
-    SetTexture(tex_[12], (resources_directory_g + std::string("/textures/heart_1.png")).c_str());
-    SetTexture(tex_[13], (resources_directory_g + std::string("/textures/heart_2.png")).c_str());
-    SetTexture(tex_[14], (resources_directory_g + std::string("/textures/heart_3.png")).c_str());
-    SetTexture(tex_[15], (resources_directory_g + std::string("/textures/playerShield.png")).c_str());
-    SetTexture(tex_[16], (resources_directory_g + std::string("/textures/progressbar.png")).c_str());
-    SetTexture(tex_[17], (resources_directory_g + std::string("/textures/progressbar_arrow.png")).c_str());
-    SetTexture(tex_[18], (resources_directory_g + std::string("/textures/bg1.png")).c_str());
-    SetTexture(tex_[19], (resources_directory_g + std::string("/textures/bg2.png")).c_str());
-    SetTexture(tex_[20], (resources_directory_g + std::string("/textures/bg3.png")).c_str());
-    SetTexture(tex_[21], (resources_directory_g + std::string("/textures/shield_cosmetic.png")).c_str());
-    SetTexture(tex_[22], (resources_directory_g + std::string("/textures/title.png")).c_str());
-    SetTexture(tex_[23], (resources_directory_g + std::string("/textures/bullet_green.png")).c_str());
-    SetTexture(tex_[24], (resources_directory_g + std::string("/textures/bullet_orange.png")).c_str());
-    SetTexture(tex_[25], (resources_directory_g + std::string("/textures/title_win.png")).c_str());
-    SetTexture(tex_[26], (resources_directory_g + std::string("/textures/title_lose.png")).c_str());
-    SetTexture(tex_[27], (resources_directory_g + std::string("/textures/indicator_1.png")).c_str());
-    SetTexture(tex_[28], (resources_directory_g + std::string("/textures/indicator_2.png")).c_str());
-    
-
-    glBindTexture(GL_TEXTURE_2D, tex_[0]);
+    return window_ && glfwGetKey(window_, key) == GLFW_PRESS;
 }
 
 
-void Game::Controls(void)
+void Game::GetWindowSize(int &width, int &height)
 {
-    // Get player game object
-    PlayerGameObject* player = dynamic_cast<PlayerGameObject*>(game_objects_[0]);
-    glm::vec3 curpos = player->GetPosition();
-    glm::vec3 curvel = player->GetVelocity();
-    glm::vec3 newPos;
 
-    // debug tools
-    if (glfwGetKey(window_, GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS) {
-        player->SetPosition(glm::vec3(0.0f, player->GetPosition()[1] - 1, 0.0f));
-        printf("[?] Moving player backwards...\n");
+    if (window_) {
+        glfwGetWindowSize(window_, &width, &height);
     }
-    if (glfwGetKey(window_, GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS) {
-        player->SetPosition(glm::vec3(0.0f, player->GetPosition()[1] + 1, 0.0f));
-        printf("[?] Moving player forwards...\n");
+    else if (headless_.IsOpen()) {
+        width = headless_.GetWidth();
+        height = headless_.GetHeight();
     }
-    if (glfwGetKey(window_, GLFW_KEY_BACKSLASH) == GLFW_PRESS) {
-        player->addShieldTimer(60);
-        printf("[?] Giving player 60 seconds of invincibility...\n");
+    else {
+        width = window_width_g;
+        height = window_height_g;
     }
+}
 
-    if (glfwGetKey(window_, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-        printf("[?] Closing game...\n");
-        glfwSetWindowShouldClose(window_, true);
-    }
 
-    // if the player won or lost, skip the rest of these inputs
-    // basically, ignore player input
-    if (state == "win" || state == "lose") {
+void Game::HotReload(void)
+{
+
+    if (!hot_reload_g) {
         return;
     }
 
-    // Check for player input and make changes accordingly
-    if (glfwGetKey(window_, GLFW_KEY_W) == GLFW_PRESS) {
-        if (glm::length(curvel) < 3) {
-            player->SetVelocity(curvel + glm::vec3(0.0f,0.05f,0.0f));
+    // Start decoding the textures that were saved, and note whether a shader was
+    changed_files_.clear();
+    watcher_.Poll(changed_files_);
+    bool shaders = false;
+    std::string prefix = resources_directory_g + "/";
+    for (int i = 0; i < changed_files_.size(); i++) {
+        if (changed_files_[i].compare(0, prefix.size(), prefix) != 0) {
+            continue;
         }
-    }
-    if (glfwGetKey(window_, GLFW_KEY_S) == GLFW_PRESS) {
-        if (glm::length(curvel) > 0.5) {
-            player->SetVelocity(curvel + glm::vec3(0.0f, -0.05f, 0.0f));
+        std::string name = changed_files_[i].substr(prefix.size());
+        if (name == shader_files_g[0] || name == shader_files_g[1]) {
+            shaders = true;
+            continue;
         }
-    }
-    if (glfwGetKey(window_, GLFW_KEY_D) == GLFW_PRESS) {
-        player->SetVelocity(glm::vec3(2.0f, player->GetVelocity()[1], 0.0f));
 
-        if ((player->GetPosition()[0] + 2.0f) > 4.5) {
-            player->SetVelocity(curvel);
+        // Textures that are not resident get the new file anyway, the next time they are used
+        TextureHandle texture;
+        if (!resources_.Find(name, texture)) {
+            continue;
         }
-    }
-    if (glfwGetKey(window_, GLFW_KEY_A) == GLFW_PRESS) {
-        player->SetVelocity(glm::vec3(-2.0f, player->GetVelocity()[1], 0.0f));
-
-        if ((player->GetPosition()[0] - 2.0f) < -4.5) {
-            player->SetVelocity(curvel);
+        if (!resources_.IsResident(texture)) {
+            resources_.Invalidate(texture);
+            continue;
         }
-    }
-    if (glfwGetKey(window_, GLFW_KEY_SPACE) == GLFW_PRESS) {
 
-        if (player->GetWeaponType() == 1) {
-            SpawnBullet(player, 16);
+        // A texture saved again while it is decoded is decoded once more after that
+        bool pending = false;
+        for (int j = 0; j < texture_reloads_.size(); j++) {
+            if (texture_reloads_[j].texture.index == texture.index) {
+                texture_reloads_[j].again = true;
+                pending = true;
+            }
         }
-        else if (player->GetWeaponType() == 2) {
-            double time = player->GetTime();
-            player->SetAngle(player->GetAngle() + 30);
-            SpawnBullet(player, 8);
-            player->SetTime(time);
-            player->SetAngle(player->GetAngle() -60);
-            SpawnBullet(player, 8);
-            player->SetTime(time);
-            player->SetAngle(player->GetAngle() + 30);
-            SpawnBullet(player, 8);
+        if (!pending) {
+            TextureReload reload;
+            reload.texture = texture;
+            reload.image = std::async(std::launch::async, [this, name]() { return resources_.Decode(name); });
+            reload.start = std::chrono::steady_clock::now();
+            reload.again = false;
+            texture_reloads_.push_back(std::move(reload));
         }
-
-    }
-    if (glfwGetKey(window_, GLFW_KEY_E) == GLFW_PRESS) {
-        player->setWeaponType(2);
-        //switch wepond mode
     }
-    if (glfwGetKey(window_, GLFW_KEY_Q) == GLFW_PRESS) {
-
-        player->setWeaponType(1);
-        //switch wepond mode
+    if (shaders) {
+        ReloadShaders();
     }
-}
-
-void Game::SpawnEnemies() {
 
-    if (glfwGetTime() > enemySpawnTimer_) {
-        enemySpawnTimer_ += 2;
-
-        // if the player is fighting the boss or has won or lost the game, no other enemies should spawn
-        if (state == "boss" || state == "win" || state == "lose") {
-            return;
+    // Upload the textures that are done decoding
+    for (int i = 0; i < texture_reloads_.size();) {
+        TextureReload &reload = texture_reloads_[i];
+        if (reload.image.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            i++;
+            continue;
         }
 
-        // if the player enters the "boss area", prep the boss fight and change the game state to "boss"
-        if (game_objects_[0]->GetPosition()[1] > 440 && state == "game") {
-            printf("[!] SPAWNED THE BOSS\n");
-            state = "boss";
-            GameObject* enemy = new GameObject(glm::vec3(0.0f, game_objects_[0]->GetPosition()[1] + 5.0f, 0.0f), tex_[11], size_, "planeboss");
-            enemy->SetAngle(180);
-            enemy->SetROF(0.5);
-            enemy->SetScale(2.0f);
-            enemy->addHealth(10);
-            game_objects_.push_back(enemy);
+        std::string name = resources_.GetName(reload.texture);
+        TextureImage image = reload.image.get();
+        std::chrono::steady_clock::time_point decoded = std::chrono::steady_clock::now();
+        if (!image.data) {
+            printf("[?] Could not decode %s, keeping the texture from before\n", name.c_str());
         }
-
-        //geting a random number to determin what type of enemy is spawned
-        int randomNum = rand() % 100 + 1;
-        //geting a random x value for the enemy
-        float x = rand() % 5 - 1.5;
-
-        // Depending on the random number, we spawn a certain enemy
-        // We use the random number as a sort of "rarity" meter. Rare enemies have a smaller number range to be picked
-        if (randomNum > 50) {
-            GameObject* enemy = new GameObject(glm::vec3(x, game_objects_[0]->GetPosition()[1] + 8.0f, 0.0f), tex_[8], size_, "plane");
-            enemy->SetAngle(180);
-            game_objects_.push_back(enemy);
-
-            printf("[!] SPAWNED A NEW ENEMY PLANE\n");
+        else if (!resources_.IsResident(reload.texture)) {
+            ResourceManager::FreeImage(image);
         }
-        else if(randomNum > 25){
-            GameObject* enemy = new GameObject(glm::vec3(x, game_objects_[0]->GetPosition()[1] + 8.0f, 0.0f), tex_[9], size_, "plane2");
-            game_objects_.push_back(enemy);
-
-            printf("[!] SPAWNED A NEW ENEMY PLANE2 (SPINNER)\n");
+        else {
+            resources_.Upload(reload.texture, image);
+            std::chrono::steady_clock::time_point uploaded = std::chrono::steady_clock::now();
+            printf("[!] Reloaded %s: %.2f ms decoding on a worker, %.2f ms uploading\n", name.c_str(),
+                std::chrono::duration<double, std::milli>(decoded - reload.start).count(),
+                std::chrono::duration<double, std::milli>(uploaded - decoded).count());
         }
-        else if(randomNum > 15) {
-            GameObject* enemy = new GameObject(glm::vec3(0.0f, game_objects_[0]->GetPosition()[1] + 8.0f, 0.0f), tex_[10], size_, "plane3");
-            enemy->SetVelocity(glm::vec3(0,0.06,0));
-            enemy->SetAngle(180);
-            game_objects_.push_back(enemy);
 
-            printf("[!] SPAWNED A NEW ENEMY PLANE3 (SIDE STEPPER)\n");
+        if (reload.again) {
+            reload.image = std::async(std::launch::async, [this, name]() { return resources_.Decode(name); });
+            reload.start = decoded;
+            reload.again = false;
+            i++;
         }
-        else if (randomNum > 5) {
-            GameObject* enemy = new GameObject(glm::vec3(x, game_objects_[0]->GetPosition()[1] + 8.0f, 0.0f), tex_[10], size_, "plane4");
-            enemy->SetVelocity(glm::vec3(0, -0.06, 0));
-            enemy->SetAngle(180);
-            enemy->SetROF(0.5);
-            game_objects_.push_back(enemy);
-
-            printf("[!] SPAWNED A NEW ENEMY PLANE4 (SIDESHOT)\n");
+        else {
+            texture_reloads_.erase(texture_reloads_.begin() + i);
         }
     }
-
 }
 
-void Game::SpawnPowerups() {
 
-    if (glfwGetTime() > powerupSpawnTimer_) {
-        powerupSpawnTimer_ += 8;
+void Game::ReloadShaders(void)
+{
 
-        // if the player has won or lost the game, no more powerups should spawn
-        if (state == "win" || state == "lose") {
+    // Programs can only be compiled on this thread, which has the context
+    // The sources come from the loose files, the pack's copies are out of date now
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    MappedFile files[2];
+    for (int i = 0; i < 2; i++) {
+        if (!files[i].Open((resources_directory_g + "/" + shader_files_g[i]).c_str())) {
+            printf("[?] Could not open %s, keeping the shaders from before\n", shader_files_g[i]);
             return;
         }
-
-        //geting a random number do determin what powerup should be spawned
-        if ((rand() % 100 + 1) > 50) {
-            game_objects_.push_back(new GameObject(glm::vec3(rand() % 5 - 1.5, game_objects_[0]->GetPosition()[1] + 8.0f, 0.0f), tex_[6], size_, "health"));
-            printf("[!] SPAWNED A NEW HEALTH PICKUP\n");
-        }
-        else {
-            game_objects_.push_back(new GameObject(glm::vec3(rand() % 5 - 1.5, game_objects_[0]->GetPosition()[1] + 8.0f, 0.0f), tex_[7], size_, "shield"));
-            printf("[!] SPAWNED A NEW SHIELD PUCKUP\n");
-        }
-
-
     }
 
+    try {
+        shader_.InitFromSource(files[0].GetText(), files[1].GetText());
+    }
+    catch (std::exception &e) {
+        printf("[?] Could not reload the shaders, keeping the ones from before\n%s\n", e.what());
+        return;
+    }
+    shader_.Enable();
+    gl_renderer_.BindSprite();
+    printf("[!] Reloaded the shaders in %.2f ms\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
 }
 
-void Game::SpawnBullet(GameObject* plane, int speed) {
 
-    std::string bulletTag;
-    int textureNumber =24;
+void Game::PrintTextureStats(void)
+{
 
-    //checking what type of bullet to add
-    if (plane->GetTag() == "player") {
-        bulletTag = "bullet_p";
-        PlayerGameObject* player = dynamic_cast<PlayerGameObject*>(game_objects_[0]);
-        if (player->GetWeaponType() == 1) {
-            textureNumber = 4;
-        }
-        else {
-            textureNumber = 23;
-        }
-        
-    }
-    else if (plane->GetTag() == "plane" || plane->GetTag() == "plane2" || plane->GetTag() == "plane3" || plane->GetTag() == "plane4" || plane->GetTag() == "planeboss") {
-        bulletTag = "bullet_e";
-        textureNumber = 24;
-    }
+    TextureStats stats = resources_.GetStats();
+    printf("[!] Textures: %d of %d resident (%d pinned), %.1f of %.1f MB, %d loads, %d evictions\n",
+        stats.resident, stats.registered, stats.pinned, stats.bytes / (1024.0 * 1024.0), stats.budget / (1024.0 * 1024.0),
+        stats.loads, stats.evictions);
+}
 
-    //checking if the plane or player is ready to spawn a new bullet
-    if (plane->GetTime() < glfwGetTime()) {
-        //seting all attributes of the bullet
-        GameObject* bullet = new GameObject(glm::vec3(0.0f, 0.0f, 0.0f), tex_[textureNumber], size_, bulletTag);
-        bullet->SetPosition(plane->GetPosition());
-        bullet->SetAngle(plane->GetAngle());
-        bullet->SetScale(0.5);
-        bullet->SetVelocity((glm::vec3((speed * cos((plane->GetAngle() + 90) * ((atan(1) * 4)) / 180)), speed * sin((plane->GetAngle() + 90) * ((atan(1) * 4)) / 180), 0)));
-        game_objects_.push_back(bullet);
-        plane->SetTime(0);
-    }
-    if (plane->GetTime() == 0) {
-        plane->SetTime(glfwGetTime() + plane->GetROF());
-    }
 
+void Game::ResizeCallback(GLFWwindow* window, int width, int height)
+{
+
+    // Set OpenGL viewport based on framebuffer width and height
+    glViewport(0, 0, width, height);
 }
 
-bool Game::CheckOutOfBounds(GameObject* object) {
 
-    int width, height;
-    glfwGetWindowSize(window_, &width, &height);
+void Game::KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
 
-    // If the object is outside the width of the screen
-    if ((object->GetPosition()[0] < -(width / 2)) || (object->GetPosition()[0] > (width / 2))) {
-        return true;
+    // Held keys repeat, but the simulation only cares when they go down or up
+    if (key < 0 || key > GLFW_KEY_LAST || action == GLFW_REPEAT) {
+        return;
     }
 
-    // If the object is outside the height of the screen (plus a little wiggle room at the top for things to spawn!!)
-    if ((object->GetPosition()[1] < (game_objects_[0]->GetPosition()[1] - 3.0f)) || (object->GetPosition()[1] > (game_objects_[0]->GetPosition()[1] + 8.0f))) {
-        return true;
+    Game *game = (Game *) glfwGetWindowUserPointer(window);
+    KeyEvent event = { key, action, Now() };
+    if (!game->key_events_.Push(event)) {
+        game->key_events_lost_ = true;
     }
+}
 
-    return false;
 
+void Game::WaitEvents(double seconds)
+{
+
+    glfwWaitEventsTimeout(seconds);
 }
 
-void Game::Update(double delta_time)
+
+Entity Game::CreatePlayer(int texture, const glm::vec3 &position)
 {
 
-    // Handle user input
-    Controls();
+    Entity player = world_.Create(MaskOf<Transform, Motion, Sprite, Collider, Health, Player>());
+    world_.Get<Transform>(player).position = position;
+    world_.Get<Transform>(player).scale = 1.0f;
+    world_.Get<Sprite>(player).texture = textures_[texture];
+    world_.Get<Sprite>(player).layer = LAYER_PLAYER;
+    world_.Get<Collider>(player).radius = 0.5f;
+    world_.Get<Collider>(player).kind = COLLIDE_PLAYER;
+    world_.Get<Health>(player).health = 3;
+    world_.Get<Player>(player).weapon_type = 1;
+    world_.Get<Player>(player).rof = 0.4;
+
+    // The shield bubble, and the particles that orbit the player while the shield is up
+    Entity part = world_.Create(MaskOf<Transform, Sprite, Attach, ShieldPart>());
+    world_.Get<Sprite>(part).texture = textures_[TEX_PLAYER_SHIELD];
+    world_.Get<Sprite>(part).layer = LAYER_SHIELD;
+    world_.Get<Attach>(part).parent = player;
+    world_.Get<ShieldPart>(part).scale = 1.2f;
+
+    glm::vec3 orbits[] = { glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(-0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, -0.5f, 0.0f) };
+    for (int i = 0; i < 4; i++) {
+        part = world_.Create(MaskOf<Transform, Sprite, Attach, ShieldPart>());
+        world_.Get<Transform>(part).position = orbits[i];
+        world_.Get<Sprite>(part).texture = textures_[TEX_SHIELD_ORBIT];
+        world_.Get<Sprite>(part).layer = LAYER_ORBIT;
+        world_.Get<Attach>(part).parent = player;
+        world_.Get<Attach>(part).orbit = 1;
+        world_.Get<Attach>(part).spin = 5.0f;
+        world_.Get<ShieldPart>(part).scale = 0.2f;
+    }
 
-    CheckAllCollisions(game_objects_, delta_time);
+    return player;
+}
 
-    // Enemies + powerups will not spawn if the player hasn't "started" the game by moving forward a bit
 
-    if (game_objects_[0]->GetPosition()[1] > 10) {
-        SpawnEnemies();
-        SpawnPowerups();
+void Game::Controls(void)
+{
+    // Get the player's components
+    Transform &transform = world_.Get<Transform>(player_);
+
+    // debug tools
+    // They change the simulation from outside, so a rollback doesn't play them again
+    if (KeyDown(GLFW_KEY_LEFT_BRACKET)) {
+        transform.position = glm::vec3(0.0f, transform.position[1] - 1, 0.0f);
+        printf("[?] Moving player backwards...\n");
+    }
+    if (KeyDown(GLFW_KEY_RIGHT_BRACKET)) {
+        transform.position = glm::vec3(0.0f, transform.position[1] + 1, 0.0f);
+        printf("[?] Moving player forwards...\n");
+    }
+    if (KeyDown(GLFW_KEY_BACKSLASH)) {
+        AddShield(player_, 60);
+        printf("[?] Giving player 60 seconds of invincibility...\n");
+    }
+
+    if (KeyDown(GLFW_KEY_ESCAPE)) {
+        printf("[?] Closing game...\n");
+        glfwSetWindowShouldClose(window_, true);
     }
-    else if (game_objects_[0]->GetPosition()[1] <= 10) {
-        enemySpawnTimer_ = glfwGetTime();
-        powerupSpawnTimer_ = glfwGetTime();
+
+    // Once the game is won or lost, the level can be played again right away
+    if (KeyDown(GLFW_KEY_R) && (state == "win" || state == "lose")) {
+        Restart();
     }
+}
+
+PlayerInput Game::ReadInput(int player)
+{
 
-    // Main iteration
-    // This is where all three layers of objects are iterated upon individually
-    // There are three layers: Foreground, middleground, and background 
-    // Each have different rules for how they are handled
+    PlayerInput input = 0;
+    for (int i = 0; i < num_input_buttons_g; i++) {
+        int key = input_keys_g[player][i];
+        if (keys_down_[key] || keys_tapped_[key]) {
+            input |= 1 << i;
+        }
+    }
+    return input;
+}
 
-    // [1] FOREGROUND FG_OBJECTS_ (Heads up display)
+void Game::TakeKeyEvents(void)
+{
 
-    for (int i = 0; i < fg_objects_.size(); i++) {
-        GameObject* current_game_object = fg_objects_[i];
+    // Taps only count for the tick right after them
+    std::fill(keys_tapped_, keys_tapped_ + GLFW_KEY_LAST + 1, false);
 
-        // if the player is in gameplay, the hud will follow them
-        // if the player won or lost, the hud stops (and hides) for the camera to focus on
-        if (state != "win" && state != "lose") {
-            current_game_object->SetPosition(glm::vec3(current_game_object->GetPosition()[0], game_objects_[0]->GetPosition()[1], 0.0f));
+    KeyEvent event;
+    while (key_events_.Pop(event)) {
+        keys_down_[event.key] = event.action == GLFW_PRESS;
+        if (event.action == GLFW_PRESS) {
+            keys_tapped_[event.key] = true;
         }
 
-        if (current_game_object->GetTag() == "title") {
-            // if the game has "started", make the title slide off screen and then die
-            if (game_objects_[0]->GetPosition()[1] > 5) {
-                current_game_object->SetPosition(glm::vec3(current_game_object->GetPosition()[0] * 1.1, current_game_object->GetPosition()[1] + 3, 0.0f));
-                // This kills the title card when it's out of bounds
-                if (CheckOutOfBounds(current_game_object)) {
-                    printf("[X] Removed title object\n");
-                    fg_objects_.erase(fg_objects_.begin() + i);
+        // Only the keys of the players are timed
+        for (int i = 0; i < num_players_ * num_input_buttons_g; i++) {
+            if (input_keys_g[i / num_input_buttons_g][i % num_input_buttons_g] == event.key) {
+                if (num_input_times_ < MAX_FRAME_INPUTS) {
+                    input_times_[num_input_times_++] = event.time;
                 }
+                break;
             }
-            else {
-                // If the player hasn't moved enough yet, keep the title card on screen
-                current_game_object->SetPosition(glm::vec3(current_game_object->GetPosition()[0], current_game_object->GetPosition()[1] + 3, 0.0f));
-            }
+        }
+    }
+
+    // If the queue overflowed some events are gone, so read the keys as they are now
+    if (key_events_lost_) {
+        key_events_lost_ = false;
+        for (int key = 0; key <= GLFW_KEY_LAST; key++) {
+            keys_down_[key] = KeyDown(key);
+        }
+    }
+}
+
+void Game::MeasureInputLatency(void)
+{
+
+    // The swap only queues the frame, so this is a lower bound of when the input shows up on screen
+    double now = Now();
+    for (int i = 0; i < num_input_times_; i++) {
+        input_latency_.Add(now - input_times_[i]);
+    }
+    num_input_times_ = 0;
+}
+
+void Game::ApplyInput(Entity player, PlayerInput input)
+{
+    // if the player won or lost, skip the rest of these inputs
+    // basically, ignore player input
+    // Players that are down can't do anything either
+    if (state == "win" || state == "lose" || world_.Get<Health>(player).health <= 0) {
+        return;
+    }
+
+    // Get the player's components
+    Transform &transform = world_.Get<Transform>(player);
+    Motion &motion = world_.Get<Motion>(player);
+    glm::vec3 curvel = motion.velocity;
+
+    // Check for player input and make changes accordingly
+    if (input & INPUT_UP) {
+        if (glm::length(curvel) < 3) {
+            motion.velocity = curvel + glm::vec3(0.0f, 0.05f, 0.0f);
+        }
+    }
+    if (input & INPUT_DOWN) {
+        if (glm::length(curvel) > 0.5) {
+            motion.velocity = curvel + glm::vec3(0.0f, -0.05f, 0.0f);
+        }
+    }
+    if (input & INPUT_RIGHT) {
+        motion.velocity = glm::vec3(2.0f, motion.velocity[1], 0.0f);
+
+        if ((transform.position[0] + 2.0f) > 4.5) {
+            motion.velocity = curvel;
+        }
+    }
+    if (input & INPUT_LEFT) {
+        motion.velocity = glm::vec3(-2.0f, motion.velocity[1], 0.0f);
+
+        if ((transform.position[0] - 2.0f) < -4.5) {
+            motion.velocity = curvel;
+        }
+    }
+    // The player can only fire once the previous shot's cooldown timer is done
+    if ((input & INPUT_FIRE) && !timers_.IsPending(world_.Get<Player>(player).cooldown)) {
+
+        if (world_.Get<Player>(player).weapon_type == 1) {
+            SpawnBullets(player, player_shot_g, 0);
+        }
+        else if (world_.Get<Player>(player).weapon_type == 2) {
+            SpawnBullets(player, player_spread_g, 0);
+        }
+
+        Player &components = world_.Get<Player>(player);
+        components.cooldown = timers_.Schedule(components.rof, TIMER_COOLDOWN, player);
+    }
+    if (input & INPUT_WEAPON2) {
+        world_.Get<Player>(player).weapon_type = 2;
+        //switch wepond mode
+    }
+    if (input & INPUT_WEAPON1) {
+
+        world_.Get<Player>(player).weapon_type = 1;
+        //switch wepond mode
+    }
+}
+
+void Game::Restart(void)
+{
+
+    double start = Now();
+
+    // Stop everything that belongs to the old level
+    scripts_.Clear();
+    sim_time_ = 0.0;
+    tick_ = 0;
+    timers_.Reset(sim_time_);
+    random_.Seed(random_seed_g);
+    enemySpawnTimer_ = 0;
+    powerupSpawnTimer_ = 0;
+
+    // Every entity lives in the level arena, so the arena is given back whole and refilled from the image
+    // It is filled in the same order as the first time, so restarting never needs more memory
+    world_.Release();
+    level_arena_.Reset();
+    world_.Load(initial_world_);
+    bullets_.Clear();
+
+    state = "game";
+    level_.Restart();
+    StreamLevel();
+
+    // Rewinding stops at the start of the new level, and input of the old one is dropped
+    num_snapshots_ = 0;
+    RecordSnapshot();
+    inputs_.Clear();
+    peer_.Clear();
+
+    printf("[!] Restarted the level in %.3f ms\n", (Now() - start) * 1000.0);
+}
+
+void Game::SpawnEnemies() {
+
+    // Called by the enemy wave timer, which is scheduled again every 2 seconds
+    enemySpawnTimer_ = timers_.Schedule(2.0, TIMER_ENEMY_WAVE, NO_ENTITY);
+
+    // if the player is fighting the boss or has won or lost the game, no other enemies should spawn
+    if (state == "boss" || state == "win" || state == "lose") {
+        return;
+    }
+
+    //geting a random number to determin what type of enemy is spawned
+    int randomNum = random_.Range(100) + 1;
+    //geting a random x value for the enemy
+    float x = random_.Range(5) - 1.5;
+    float y = world_.Get<Transform>(player_).position[1] + 8.0f;
+
+    // Depending on the random number, we spawn a certain enemy
+    // We use the random number as a sort of "rarity" meter. Rare enemies have a smaller number range to be picked
+    if (randomNum > 50) {
+        SpawnObject("plane", glm::vec3(x, y, 0.0f));
+    }
+    else if(randomNum > 25){
+        SpawnObject("plane2", glm::vec3(x, y, 0.0f));
+    }
+    else if(randomNum > 15) {
+        SpawnObject("plane3", glm::vec3(0.0f, y, 0.0f));
+    }
+    else if (randomNum > 5) {
+        SpawnObject("plane4", glm::vec3(x, y, 0.0f));
+    }
+
+}
+
+Entity Game::SpawnObject(const std::string &tag, const glm::vec3 &position) {
+
+    // Enemies and pickups are set up from their tables, so a new kind only needs a new entry
+    for (int kind = 0; kind < num_enemy_kinds_g; kind++) {
+        const EnemySetup &setup = enemy_setup_g[kind];
+        if (tag != setup.tag) {
+            continue;
+        }
+
+        Entity enemy = world_.Create(MaskOf<Transform, Motion, Sprite, Collider, Health, Enemy>());
+        Transform &transform = world_.Get<Transform>(enemy);
+        transform.position = position;
+        transform.angle = setup.angle;
+        transform.scale = setup.scale;
+        world_.Get<Motion>(enemy).velocity = setup.velocity;
+        world_.Get<Sprite>(enemy).texture = textures_[setup.texture];
+        world_.Get<Sprite>(enemy).layer = LAYER_OBJECTS;
+        world_.Get<Collider>(enemy).radius = 0.5f;
+        world_.Get<Collider>(enemy).kind = (kind == ENEMY_BOSS) ? COLLIDE_BOSS : COLLIDE_ENEMY;
+        world_.Get<Health>(enemy).health = setup.health;
+        world_.Get<Enemy>(enemy).kind = kind;
+        world_.Get<Enemy>(enemy).rof = setup.rof;
+
+        // Spinners start at a random angle
+        if (kind == ENEMY_SPINNER) {
+            transform.angle = random_.Range(360) + 1;
+        }
+
+        printf("[!] SPAWNED %s\n", setup.message);
+        StartScripts(enemy);
+        return enemy;
+    }
+
+    for (int kind = 0; kind < num_pickup_kinds_g; kind++) {
+        const PickupSetup &setup = pickup_setup_g[kind];
+        if (tag != setup.tag) {
+            continue;
+        }
+
+        Entity pickup = world_.Create(MaskOf<Transform, Motion, Sprite, Collider, Pickup>());
+        world_.Get<Transform>(pickup).position = position;
+        world_.Get<Transform>(pickup).scale = 1.0f;
+        world_.Get<Sprite>(pickup).texture = textures_[setup.texture];
+        world_.Get<Sprite>(pickup).layer = LAYER_OBJECTS;
+        world_.Get<Collider>(pickup).radius = 0.5f;
+        world_.Get<Collider>(pickup).kind = COLLIDE_PICKUP;
+        world_.Get<Pickup>(pickup).kind = kind;
+
+        printf("[!] SPAWNED %s\n", setup.message);
+        return pickup;
+    }
+
+    printf("[?] Unknown object to spawn: %s\n", tag.c_str());
+    return NO_ENTITY;
+}
+
+void Game::StartScripts(Entity enemy) {
+
+    // Every enemy runs a weapon script with its firing pattern
+    // Enemies that move on their own also run a movement script every tick
+    double rof = world_.Get<Enemy>(enemy).rof;
+
+    switch (world_.Get<Enemy>(enemy).kind) {
+        case ENEMY_PLANE:
+            scripts_.Start(PlaneScript(enemy), enemy);
+            scripts_.Start(WeaponScript(enemy, Volley(enemy, enemy_shot_g), rof), enemy);
+            break;
+        case ENEMY_SPINNER:
+            // 4 way shot, one bullet every 90 degrees
+            scripts_.Start(SpinnerScript(enemy), enemy);
+            scripts_.Start(WeaponScript(enemy, Volley(enemy, spinner_shot_g), rof), enemy);
+            break;
+        case ENEMY_SIDESTEPPER:
+            scripts_.Start(SideStepperScript(enemy), enemy);
+            scripts_.Start(WeaponScript(enemy, Volley(enemy, enemy_shot_g), rof), enemy);
+            break;
+        case ENEMY_SIDESHOT:
+            // Fires to both sides, it just flies straight so it has no movement script
+            scripts_.Start(WeaponScript(enemy, Volley(enemy, sideshot_g), rof), enemy);
+            break;
+        case ENEMY_BOSS:
+            // On top of its main gun, the boss fires a turning ring of bullets
+            scripts_.Start(BossScript(enemy), enemy);
+            scripts_.Start(WeaponScript(enemy, Volley(enemy, enemy_shot_g), rof), enemy);
+            scripts_.Start(WeaponScript(enemy, Volley(enemy, boss_spiral_g, 3, 0.25), 2.5), enemy);
+            break;
+    }
+}
+
+// Fires the volley right away, and then again every delay seconds
+Behaviour Game::WeaponScript(Entity plane, Volley volley, double delay) {
+
+    for (;;) {
+        co_await volley;
+        volley.turn += volley.bursts;
+        co_await Delay(delay);
+    }
+}
+
+// Flies straight, and creeps towards the player once it is close
+// Components are looked up again after every co_await, since other entities may have moved them in the meantime
+Behaviour Game::PlaneScript(Entity plane) {
+
+    for (;;) {
+        Transform &transform = world_.Get<Transform>(plane);
+        float distance_p_p = glm::length(transform.position - world_.Get<Transform>(player_).position);
+        if (distance_p_p < 9) {
+            transform.position += glm::vec3(0, -0.01, 0);
+        }
+        co_await NextTick();
+    }
+}
+
+// Keeps spinning, so its 4 way shot sweeps around
+Behaviour Game::SpinnerScript(Entity plane) {
+
+    for (;;) {
+        double delta_time = co_await NextTick();
+        world_.Get<Transform>(plane).angle += delta_time*40;
+    }
+}
+
+// Swings left and right across the screen
+Behaviour Game::SideStepperScript(Entity plane) {
+
+    for (;;) {
+        Transform &transform = world_.Get<Transform>(plane);
+        transform.position = glm::vec3(cos(sim_time_)*2.0, transform.position[1], 0);
+        co_await NextTick();
+    }
+}
+
+// Swings left and right, and keeps up with the player
+Behaviour Game::BossScript(Entity plane) {
+
+    for (;;) {
+        Transform &transform = world_.Get<Transform>(plane);
+        transform.position = glm::vec3(cos(sim_time_) * 2.0, transform.position[1], 0);
+        world_.Get<Motion>(plane).velocity = glm::vec3(0.0f, world_.Get<Motion>(player_).velocity[1], 0.0f);
+        co_await NextTick();
+    }
+}
+
+void Game::StreamLevel(void) {
 
+    level_events_.clear();
+    float player_y = world_.Get<Transform>(player_).position[1];
+
+    // Rebake the ground whenever a chunk was streamed in or retired
+    if (level_.Update(player_y, level_events_)) {
+        BakeGround();
+    }
+
+    for (int i = 0; i < level_events_.size(); i++) {
+        const LevelEvent &event = level_events_[i];
+
+        if (event.type == EVENT_SPAWN) {
+            // Scripted spawns wait for the game to start, like random ones
+            if (state == "game" || state == "boss") {
+                SpawnObject(event.tag, event.position);
+            }
+        }
+        else if (event.type == EVENT_BIOME) {
+            printf("[!] ENTERED BIOME %s\n", event.tag.c_str());
         }
-        if (current_game_object->GetTag() == "hud_bar") {
-            // If the player won, stop moving the bar
-            if (state == "win") {
-                continue;
+        else if (event.type == EVENT_BOSS) {
+            // When the player enters the "boss area", prep the boss fight and change the game state to "boss"
+            if (state == "game") {
+                state = "boss";
+                SpawnObject("planeboss", glm::vec3(0.0f, player_y + 5.0f, 0.0f));
             }
-            // If the player is still in gameplay, keep the hud on the screen
-            if (state != "lose") {
-                current_game_object->SetPosition(glm::vec3(current_game_object->GetPosition()[0], current_game_object->GetPosition()[1] + 0.5, 0.0f));
+        }
+    }
+}
+
+void Game::SpawnPowerups() {
+
+    // Called by the powerup wave timer, which is scheduled again every 8 seconds
+    powerupSpawnTimer_ = timers_.Schedule(8.0, TIMER_POWERUP_WAVE, NO_ENTITY);
+
+    // if the player has won or lost the game, no more powerups should spawn
+    if (state == "win" || state == "lose") {
+        return;
+    }
+
+    //geting a random number do determin what powerup should be spawned
+    float y = world_.Get<Transform>(player_).position[1] + 8.0f;
+    if ((random_.Range(100) + 1) > 50) {
+        SpawnObject("health", glm::vec3(random_.Range(5) - 1.5, y, 0.0f));
+    }
+    else {
+        SpawnObject("shield", glm::vec3(random_.Range(5) - 1.5, y, 0.0f));
+    }
+
+}
+
+void Game::SpawnBullets(Entity plane, const BulletPattern &pattern, int turn) {
+
+    int side = BULLET_ENEMY;
+    int textureNumber = TEX_BULLET_ORANGE;
+
+    //checking what type of bullet to add
+    if (world_.Has<Player>(plane)) {
+        side = BULLET_PLAYER;
+        if (world_.Get<Player>(plane).weapon_type == 1) {
+            textureNumber = TEX_BULLET;
+        }
+        else {
+            textureNumber = TEX_BULLET_GREEN;
+        }
+    }
+
+    // The fire rate is handled by the caller through the timer wheel, so the bullets are always spawned
+    // The whole volley is laid out by the pattern emitter first, then the bullets are created from it
+    BulletSpawn *spawns = frame_arena_.Allocate<BulletSpawn>(pattern.count);
+    const Transform &shooter = world_.Get<Transform>(plane);
+    int count = PatternEmitter::Emit(pattern, shooter.position, shooter.angle, world_.Get<Transform>(player_).position, turn, spawns);
+
+    for (int i = 0; i < count; i++) {
+        bullets_.Spawn(spawns[i].position, spawns[i].velocity, spawns[i].angle, side, textures_[textureNumber]);
+    }
+
+}
+
+void Game::EmitVolley(const Volley &volley) {
+
+    SpawnBullets(volley.shooter, volley.pattern, volley.turn);
+}
+
+void Game::HandleTimer(const TimerExpiry &timer) {
+
+    if (timer.event == TIMER_SCRIPT) {
+        scripts_.Resume(timer.target);
+    }
+    else if (timer.event == TIMER_ENEMY_WAVE) {
+        SpawnEnemies();
+    }
+    else if (timer.event == TIMER_POWERUP_WAVE) {
+        SpawnPowerups();
+    }
+    // TIMER_COOLDOWN and TIMER_SHIELD need no work, the systems check if those timers are still pending
+}
+
+bool Game::CheckOutOfBounds(const glm::vec3 &position) {
+
+    int width, height;
+    GetWindowSize(width, height);
+
+    // If the object is outside the width of the screen
+    if ((position[0] < -(width / 2)) || (position[0] > (width / 2))) {
+        return true;
+    }
+
+    // If the object is outside the height of the screen (plus a little wiggle room at the top for things to spawn!!)
+    float player_y = world_.Get<Transform>(player_).position[1];
+    if ((position[1] < (player_y - 3.0f)) || (position[1] > (player_y + 8.0f))) {
+        return true;
+    }
+
+    return false;
+
+}
+
+void Game::Kill(Entity entity) {
+
+    // Entities are only removed at the end of the tick, so the systems never see them disappear
+    // Until then they stop colliding, so a bullet can't hit two enemies
+    if (world_.Has<Collider>(entity)) {
+        world_.Get<Collider>(entity).kind = COLLIDE_NONE;
+    }
+    world_.DestroyLater(entity);
+}
+
+void Game::DamagePlayer(Entity player, int damage) {
+
+    Health &health = world_.Get<Health>(player);
+    if (health.health > 0 && !timers_.IsPending(world_.Get<Player>(player).shield)) {
+        health.health -= damage;
+    }
+}
+
+void Game::AddShield(Entity player, double seconds) {
+
+    // Extend the shield by rescheduling its timer with the time that was left
+    Player &components = world_.Get<Player>(player);
+    double remaining = timers_.GetRemaining(components.shield);
+    timers_.Cancel(components.shield);
+    components.shield = timers_.Schedule(remaining + seconds, TIMER_SHIELD, player);
+}
+
+void Game::CollisionResponce(const Contact &contact) {
+
+    // Skip entities that an earlier contact of this tick already removed
+    if (world_.Get<Collider>(contact.a).kind == COLLIDE_NONE || world_.Get<Collider>(contact.b).kind == COLLIDE_NONE) {
+        return;
+    }
+
+    //checking for combinations of objects and performing appropriate responce
+    if (contact.kind_a == COLLIDE_PLAYER && contact.kind_b == COLLIDE_ENEMY) {
+        // Only some kinds of enemy hurt the player by flying into it, the others pass over
+        if (enemy_setup_g[world_.Get<Enemy>(contact.b).kind].rams) {
+            DamagePlayer(contact.a, 1);
+            Kill(contact.b);
+        }
+    }
+    else if (contact.kind_a == COLLIDE_PLAYER && contact.kind_b == COLLIDE_PICKUP) {
+        if (world_.Get<Pickup>(contact.b).kind == PICKUP_HEALTH) {
+            Health &health = world_.Get<Health>(contact.a);
+            if (health.health < 3) {
+                health.health += 1;
             }
+        }
+        else {
+            AddShield(contact.a, 5);
+        }
+        Kill(contact.b);
+    }
+}
+
+void Game::CollisionSystem(void) {
 
+    std::pmr::vector<Contact> contacts(&frame_arena_);
+    CheckAllCollisions(world_, contacts);
+    for (int i = 0; i < contacts.size(); i++) {
+        CollisionResponce(contacts[i]);
+    }
+
+    // Then the bullets, one pass over all of them for each plane they can hit
+    std::pmr::vector<int> hits(&frame_arena_);
+    world_.Each<Transform, Collider>([&](Entity entity, Transform &transform, Collider &collider) {
+        if (collider.kind == COLLIDE_PLAYER) {
+            int count = bullets_.Query(BULLET_ENEMY, transform.position, collider.radius, hits);
+            for (int i = 0; i < count; i++) {
+                DamagePlayer(entity, 1);
+                bullets_.Kill(hits[i]);
+            }
         }
-        if (current_game_object->GetTag() == "hud_arrow") {
-            // If the player won, stop moving the arrow
-            if (state == "win") {
-                continue;
+        else if (collider.kind == COLLIDE_ENEMY) {
+            if (bullets_.Query(BULLET_PLAYER, transform.position, collider.radius, hits) > 0) {
+                bullets_.Kill(hits[0]);
+                Kill(entity);
             }
-            // If the player is still in gameplay, keep the hud on the screen
-            if (state != "lose") {
-                current_game_object->SetPosition(glm::vec3((game_objects_[0]->GetPosition()[1] / 100) - 2.2, current_game_object->GetPosition()[1] - 1.2, 0.0f));
-                if (current_game_object->GetPosition()[0] > 2.2) {
-                    current_game_object->SetPosition(glm::vec3(2.2, current_game_object->GetPosition()[1], 0.0f));
+        }
+        else if (collider.kind == COLLIDE_BOSS) {
+            // The boss takes a few hits, and the player wins once it goes down
+            int count = bullets_.Query(BULLET_PLAYER, transform.position, collider.radius, hits);
+            Health &health = world_.Get<Health>(entity);
+            for (int i = 0; i < count && health.health > 0; i++) {
+                bullets_.Kill(hits[i]);
+                health.health -= 1;
+                if (health.health <= 0) {
+                    Kill(entity);
+                    state = "win";
                 }
             }
         }
-        // If the player won, show the win message
-        if (current_game_object->GetTag() == "title_win" && state == "win") {
-            current_game_object->SetScale(5.0f);
+    });
+}
+
+void Game::MovementSystem(double delta_time) {
+
+    // Update positions with Euler integration
+    world_.Each<Transform, Motion>([delta_time](Entity entity, Transform &transform, Motion &motion) {
+        transform.position += motion.velocity * ((float) delta_time);
+    });
+    bullets_.Update((float) delta_time);
+
+    // Turn the attached entities, this makes the shield particles orbit the player
+    world_.Each<Transform, Attach>([](Entity entity, Transform &transform, Attach &attach) {
+        transform.angle += attach.spin;
+    });
+}
+
+void Game::PlayerSystem(void) {
+
+    float lead_y = world_.Get<Transform>(player_).position[1];
+
+    world_.Each<Transform, Motion, Collider, Health, Player>([&](Entity entity, Transform &transform, Motion &motion, Collider &collider, Health &health, Player &player) {
+
+        // The fire rate depends on the weapon
+        if (player.weapon_type == 1) {
+            player.rof = 0.5;
         }
-        // If the player lost, show the lose message
-        if (current_game_object->GetTag() == "title_lose" && state == "lose") {
-            current_game_object->SetScale(5.0f);
+        else {
+            player.rof = 0.8;
         }
 
-        // Manage the weapon indicator in the top left
-        // It's actually two indicators, but only one is shown at a time
-        // One represents Weapon 1, one represents Weapon 2
-        if (current_game_object->GetTag() == "indicator1") {
-            current_game_object->SetPosition(glm::vec3(-2.6f, current_game_object->GetPosition()[1] + 5.5f, 0.0f));
+        // Make the player not slide around on the x axis
+        motion.velocity.x = 0;
 
-            // Depending on the player's current weapon, the current indicator will either be shown or hidden
-            PlayerGameObject* player = dynamic_cast<PlayerGameObject*>(game_objects_[0]);
-            if (player->GetWeaponType() == 1) {
-                current_game_object->SetScale(0.5f);
+        // If the player won, stop them from moving
+        if (state == "win") {
+            motion.velocity = glm::vec3(0.0f, 0.0f, 0.0f);
+        }
+        // If the player's health is 0, make them "lose" and make them disappear
+        // We don't remove them though because we need to keep them on screen for the camera to stay on
+        // The other players just drop out, the game goes on as long as the first player is alive
+        if (health.health <= 0) {
+            if (entity == player_) {
+                state = "lose";
             }
-            else if (player->GetWeaponType() == 2) {
-                current_game_object->SetScale(0.0f);
+            else {
+                collider.kind = COLLIDE_NONE;
             }
+            motion.velocity = glm::vec3(0.0f, 0.0f, 0.0f);
+            transform.scale = 0.0f;
         }
-        if (current_game_object->GetTag() == "indicator2") {
-            current_game_object->SetPosition(glm::vec3(-2.6f, current_game_object->GetPosition()[1] + 5.5f, 0.0f));
 
-            // Depending on the player's current weapon, the current indicator will either be shown or hidden
-            PlayerGameObject* player = dynamic_cast<PlayerGameObject*>(game_objects_[0]);
-            if (player->GetWeaponType() == 1) {
-                current_game_object->SetScale(0.0f);
+        // The camera follows the first player, so the others have to stay on screen with it
+        if (entity != player_) {
+            if (transform.position[1] < lead_y - 2.0f) {
+                transform.position[1] = lead_y - 2.0f;
             }
-            else if (player->GetWeaponType() == 2) {
-                current_game_object->SetScale(0.5f);
+            else if (transform.position[1] > lead_y + 5.5f) {
+                transform.position[1] = lead_y + 5.5f;
             }
         }
+    });
+}
+
+void Game::ShieldSystem(void) {
+
+    // Shield parts are only shown while the shield timer of their parent is pending
+    world_.Each<Transform, Attach, ShieldPart>([this](Entity entity, Transform &transform, Attach &attach, ShieldPart &part) {
+        if (world_.IsAlive(attach.parent) && world_.Get<Health>(attach.parent).health > 0 && timers_.IsPending(world_.Get<Player>(attach.parent).shield)) {
+            transform.scale = part.scale;
+        }
+        else {
+            transform.scale = 0.0f;
+        }
+    });
+}
+
+void Game::HudSystem(void) {
+
+    float player_y = world_.Get<Transform>(player_).position[1];
+    int weapon_type = world_.Get<Player>(player_).weapon_type;
+    int health = world_.Get<Health>(player_).health;
+
+    world_.Each<Transform, Sprite, Hud>([&](Entity entity, Transform &transform, Sprite &sprite, Hud &hud) {
+
+        // if the player is in gameplay, the hud will follow them
+        // if the player won or lost, the hud stops (and hides) for the camera to focus on
+        if (state != "win" && state != "lose") {
+            transform.position[1] = player_y;
+        }
+
+        switch (hud.kind) {
+            case HUD_TITLE:
+                // if the game has "started", make the title slide off screen and then die
+                if (player_y > 5) {
+                    transform.position = glm::vec3(transform.position[0] * 1.1, transform.position[1] + 3, 0.0f);
+                    // This kills the title card when it's out of bounds
+                    if (CheckOutOfBounds(transform.position)) {
+                        printf("[X] Removed title object\n");
+                        Kill(entity);
+                    }
+                }
+                else {
+                    // If the player hasn't moved enough yet, keep the title card on screen
+                    transform.position[1] += 3;
+                }
+                break;
+
+            case HUD_BAR:
+                // If the player won, stop moving the bar and hide it
+                if (state == "win") {
+                    transform.scale = 0.0f;
+                }
+                // If the player is still in gameplay, keep the hud on the screen
+                else if (state != "lose") {
+                    transform.position[1] += 0.5;
+                }
+                break;
+
+            case HUD_ARROW:
+                // If the player won, stop moving the arrow and hide it
+                if (state == "win") {
+                    transform.scale = 0.0f;
+                }
+                // If the player is still in gameplay, keep the hud on the screen
+                else if (state != "lose") {
+                    transform.position = glm::vec3((player_y / level_.GetLength()) * 4.4 - 2.2, transform.position[1] - 1.2, 0.0f);
+                    if (transform.position[0] > 2.2) {
+                        transform.position[0] = 2.2;
+                    }
+                }
+                break;
+
+            // If the player won or lost, show the message
+            case HUD_WIN:
+                if (state == "win") {
+                    transform.scale = 5.0f;
+                }
+                break;
+            case HUD_LOSE:
+                if (state == "lose") {
+                    transform.scale = 5.0f;
+                }
+                break;
+
+            // Manage the weapon indicator in the top left
+            // It's actually two indicators, but only one is shown at a time
+            case HUD_WEAPON1:
+                transform.position = glm::vec3(-2.6f, transform.position[1] + 5.5f, 0.0f);
+                transform.scale = (weapon_type == 1) ? 0.5f : 0.0f;
+                break;
+            case HUD_WEAPON2:
+                transform.position = glm::vec3(-2.6f, transform.position[1] + 5.5f, 0.0f);
+                transform.scale = (weapon_type == 2) ? 0.5f : 0.0f;
+                break;
+
+            // The heart in the top right shows the player's health
+            case HUD_HEART:
+                transform.position = glm::vec3(2.5, 5.7 + player_y, 0);
+                if (health > 0) {
+                    sprite.texture = textures_[TEX_HEART_1 + health - 1];
+                }
+                else {
+                    transform.scale = 0.0f;
+                }
+                break;
+        }
+    });
+}
+
+void Game::CleanupSystem(void) {
+
+    // Remove the objects that left the screen
+    world_.Each<Transform, Collider>([this](Entity entity, Transform &transform, Collider &collider) {
+        if (world_.Has<Player>(entity) || collider.kind == COLLIDE_NONE || !CheckOutOfBounds(transform.position)) {
+            return;
+        }
+
+        printf("[X] Removed OOB object\n");
+        // If the object in question is the boss, then change the game state to "win"
+        if (collider.kind == COLLIDE_BOSS) {
+            state = "win";
+        }
+        Kill(entity);
+    });
 
-        current_game_object->Render(shader_);
+    // The bullets use the same bounds, without a message for each one
+    int width, height;
+    GetWindowSize(width, height);
+    float player_y = world_.Get<Transform>(player_).position[1];
+    bullets_.Cull((float) -(width / 2), (float) (width / 2), player_y - 3.0f, player_y + 8.0f);
+    bullets_.Flush();
+
+    // Remove everything that died during the tick, and stop its scripts
+    destroyed_.clear();
+    world_.Flush(&destroyed_);
+    for (int i = 0; i < destroyed_.size(); i++) {
+        scripts_.Kill(destroyed_[i]);
     }
+}
 
-    // [2] MIDDLEGROUND GAME_OBJECTS_ (Player objects, enemies, powerups, etc etc)
-    for (int i = 0; i < game_objects_.size(); i++) {
+// Transformation matrix of a sprite relative to its parent
+// Orbiting sprites turn around the parent's anchor, the others turn on their own
+static glm::mat4 TransformMatrix(const Transform &transform, bool orbit) {
 
-        // Get the current game object
-        GameObject* current_game_object = game_objects_[i];
+    glm::mat4 scaling_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(transform.scale, transform.scale, 1.0));
+    glm::mat4 translation_matrix = glm::translate(glm::mat4(1.0f), transform.position);
+    glm::mat4 rotation_matrix = glm::rotate(glm::mat4(1.0f), transform.angle, glm::vec3(0.0f, 0.0f, 1.0f));
 
-        // Check if the current object is out of bounds
-        if (CheckOutOfBounds(current_game_object)) {
-            printf("[X] Removed OOB object\n");
-            // If the object in question is the boss, then change the game state to "win"
-            if (current_game_object->GetTag() == "planeboss") {
-                state = "win";
-            }
-            // Remove the object
-            game_objects_.erase(game_objects_.begin() + i);
+    if (orbit) {
+        return rotation_matrix * translation_matrix * scaling_matrix;
+    }
+    return translation_matrix * rotation_matrix * scaling_matrix;
+}
+
+void Game::RenderSystem(void) {
+
+    // Count the visible sprites of each layer, then lay out the render list layer by layer
+    // This keeps the spawn order inside each layer without sorting
+    int start[NUM_SPRITE_LAYERS + 1] = { 0 };
+    world_.Each<Transform, Sprite>([&](Entity entity, Transform &transform, Sprite &sprite) {
+        if (transform.scale != 0.0f) {
+            start[sprite.layer + 1]++;
         }
+    });
+    for (int i = 0; i < NUM_SPRITE_LAYERS; i++) {
+        start[i + 1] += start[i];
+    }
 
-        // Update player
-        if (current_game_object->GetTag() == "player") {
-            PlayerGameObject* player = dynamic_cast<PlayerGameObject*>(current_game_object);
+    int count = start[NUM_SPRITE_LAYERS];
+    Entity *render_list = frame_arena_.Allocate<Entity>(count);
+    world_.Each<Transform, Sprite>([&](Entity entity, Transform &transform, Sprite &sprite) {
+        if (transform.scale != 0.0f) {
+            render_list[start[sprite.layer]++] = entity;
+        }
+    });
 
-            // If the player won, stop them from moving
-            if (state == "win") {
-                player->SetVelocity(glm::vec3(0.0f, 0.0f, 0.0f));
-            }
-            // If the player's health is 0, make them "lose" and make them disappear
-            // We don't remove them though because we need to keep them on screen for the camera to stay on
-            if (player->GetHealth() <= 0) {
-                state = "lose";
-                player->SetVelocity(glm::vec3(0.0f, 0.0f, 0.0f));
-                player->SetScale(0.0f);
-            }
+    // Draw the layers front to back
+    for (int i = 0; i < count; i++) {
+        Entity entity = render_list[i];
+        Transform &transform = world_.Get<Transform>(entity);
+
+        glm::mat4 matrix;
+        if (world_.Has<Attach>(entity) && world_.IsAlive(world_.Get<Attach>(entity).parent)) {
+            Attach &attach = world_.Get<Attach>(entity);
+            matrix = TransformMatrix(world_.Get<Transform>(attach.parent), false) * TransformMatrix(transform, attach.orbit != 0);
+        }
+        else {
+            matrix = TransformMatrix(transform, false);
+        }
+
+        renderer_->SubmitSprite(world_.Get<Sprite>(entity).texture, matrix);
+    }
+
+    // Bullets come last, under everything else
+    Transform bullet = { glm::vec3(0.0f), 0.0f, bullet_scale_g };
+    for (int i = 0; i < bullets_.GetCount(); i++) {
+        bullet.position = bullets_.GetPosition(i);
+        bullet.angle = bullets_.GetAngle(i);
+        renderer_->SubmitSprite(bullets_.GetTexture(i), TransformMatrix(bullet, false));
+    }
+}
+
+void Game::Update(double delta_time)
+{
+
+    // Advance the simulation clock and handle the timers that expired
+    // Only the entities whose timer fired are touched here
+    tick_++;
+    sim_time_ += delta_time;
+    expired_timers_.clear();
+    timers_.Advance(sim_time_, expired_timers_);
+    for (int i = 0; i < expired_timers_.size(); i++) {
+        HandleTimer(expired_timers_[i]);
+    }
+
+    // Enemy AI: resume the enemy scripts that wait for every tick
+    scripts_.Tick(delta_time);
+
+    // Handle the input of every player
+    for (int i = 0; i < num_players_; i++) {
+        ApplyInput(players_[i], tick_inputs_[i]);
+    }
+
+    // Bring in the part of the level around the player
+    StreamLevel();
+
+    CollisionSystem();
+
+    // Enemies + powerups will not spawn if the player hasn't "started" the game by moving forward a bit
+    // Once started, the spawn waves run on their own timers
+    if (world_.Get<Transform>(player_).position[1] > 10) {
+        if (!timers_.IsPending(enemySpawnTimer_)) {
+            SpawnEnemies();
+        }
+        if (!timers_.IsPending(powerupSpawnTimer_)) {
+            SpawnPowerups();
         }
+    }
+    else {
+        timers_.Cancel(enemySpawnTimer_);
+        timers_.Cancel(powerupSpawnTimer_);
+    }
+
+    // Run the rest of the simulation
+    MovementSystem(delta_time);
+    PlayerSystem();
+    ShieldSystem();
+    HudSystem();
+    CleanupSystem();
 
-        // Update enemy
-        if (current_game_object->GetTag() == "plane") {
-            float distance_p_p = glm::length(current_game_object->GetPosition() - game_objects_[0]->GetPosition());
-            if (distance_p_p < 9) {
-                current_game_object->SetPosition(current_game_object->GetPosition() + glm::vec3(0, -0.01, 0));
+    if (hash_log_.IsOpen()) {
+        LogStateHash();
+    }
+}
+
+void Game::Render(void)
+{
+
+    // Use aspect ratio to properly scale the window
+    int width, height;
+    GetWindowSize(width, height);
+    float aspect_ratio = ((float)width) / ((float)height);
+
+    // Clear background
+    renderer_->BeginFrame(viewport_background_color_g);
+
+    // Set view to zoom out, centered by default at 0,0
+    float cameraZoom = 0.25f;
+    glm::mat4 window_scale = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / aspect_ratio, 1.0f, 1.0f));
+    glm::mat4 camera_zoom = glm::scale(glm::mat4(1.0f), glm::vec3(cameraZoom, cameraZoom, cameraZoom));
+
+    // The camera follows the player, and stays on the hud once the game is won or lost
+    float camera_y;
+    if (state == "win" || state == "lose") {
+        camera_y = world_.Get<Transform>(hud_bar_).position[1] + 0.8;
+    }
+    else {
+        camera_y = world_.Get<Transform>(player_).position[1] + 2.0f;
+    }
+    camera_zoom = glm::translate(camera_zoom, -glm::vec3(0, camera_y, 0));
+
+    // The view spans one unit in each direction after zooming
+    view_bottom_ = camera_y - 1.0f / cameraZoom;
+    view_top_ = camera_y + 1.0f / cameraZoom;
+
+    glm::mat4 view_matrix = window_scale * camera_zoom;
+    renderer_->SetView(view_matrix, view_bottom_, view_top_);
+
+    // The sprites of the heads up display, the player, enemies and bullets are drawn from the render list,
+    // and the baked ground tiles are drawn last, only the ones the camera can see
+    RenderSystem();
+    renderer_->EndFrame();
+}
+
+void Game::SaveSnapshot(std::vector<char> &buffer)
+{
+
+    // The header is filled in last, once the size is known
+    buffer.clear();
+    buffer.resize(sizeof(SnapshotHeader));
+    SnapshotWriter writer(buffer);
+
+    // The level goes first, so a snapshot of another level is refused before anything is loaded
+    level_.Write(writer);
+
+    char state_name[16] = { 0 };
+    strncpy(state_name, state.c_str(), sizeof(state_name) - 1);
+    writer.Write(sim_time_);
+    writer.Write(state_name);
+    writer.Write(enemySpawnTimer_);
+    writer.Write(powerupSpawnTimer_);
+    writer.Write(random_.GetState());
+    writer.Write(players_);
+    writer.Write(hud_bar_);
+
+    world_.Write(writer);
+    bullets_.Write(writer);
+    timers_.Write(writer);
+
+    // The scripts go last, so snapshots of another run can stop reading before them
+    scripts_.Write(writer);
+
+    SnapshotHeader header = { SNAPSHOT_MAGIC, SNAPSHOT_VERSION, (unsigned int) (buffer.size() - sizeof(SnapshotHeader)), tick_, session_ };
+    memcpy(buffer.data(), &header, sizeof(header));
+}
+
+void Game::LoadSnapshot(const std::vector<char> &buffer)
+{
+
+    // Check the header before touching anything, so a snapshot of another version leaves the game as it was
+    SnapshotHeader header;
+    if (buffer.size() < sizeof(header)) {
+        throw(std::runtime_error(std::string("Snapshot is truncated")));
+    }
+    memcpy(&header, buffer.data(), sizeof(header));
+    if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION || header.size != buffer.size() - sizeof(header)) {
+        throw(std::runtime_error(std::string("Snapshot is not from this version of the game")));
+    }
+    SnapshotReader reader(buffer.data() + sizeof(header), header.size);
+
+    // The level checks that the snapshot is of the same level before it changes anything
+    int first_tile = level_.GetFirstTile();
+    int end_tile = level_.GetEndTile();
+    level_.Read(reader);
+
+    // Coroutine frames can only be restored in the run that saved them
+    bool same_session = (header.session == session_);
+    if (!same_session) {
+        scripts_.Clear();
+    }
+
+    char state_name[16];
+    unsigned long long random_state;
+    tick_ = header.tick;
+    reader.Read(sim_time_);
+    reader.Read(state_name);
+    reader.Read(enemySpawnTimer_);
+    reader.Read(powerupSpawnTimer_);
+    reader.Read(random_state);
+    reader.Read(players_);
+    reader.Read(hud_bar_);
+    state_name[sizeof(state_name) - 1] = '\0';
+    state = state_name;
+    random_.SetState(random_state);
+    player_ = players_[0];
+
+    world_.Read(reader);
+    bullets_.Read(reader);
+    timers_.Read(reader);
+
+    if (same_session) {
+        scripts_.Read(reader);
+    }
+    else {
+        // Drop the timers of the old scripts, and start the scripts of every enemy over
+        timers_.CancelEvent(TIMER_SCRIPT);
+        std::pmr::vector<Entity> enemies(&frame_arena_);
+        world_.Each<Enemy>([&](Entity entity, Enemy &enemy) {
+            enemies.push_back(entity);
+        });
+        for (int i = 0; i < enemies.size(); i++) {
+            StartScripts(enemies[i]);
+        }
+    }
+
+    // Bake the ground of the chunks that were streamed in at the time
+    // Rollbacks mostly go back a few ticks, where the same chunks are streamed in, and keep the ground as it is
+    if (level_.GetFirstTile() != first_tile || level_.GetEndTile() != end_tile) {
+        BakeGround();
+    }
+}
+
+
+void Game::BakeGround(void)
+{
+
+    level_.GetTiles(level_tiles_);
+    renderer_->SetBackground(level_tiles_);
+
+    // Pin the new textures before letting the old ones go, so the ones in both stay resident
+    next_ground_textures_.clear();
+    for (int i = 0; i < level_tiles_.size(); i++) {
+        TextureHandle texture = level_tiles_[i].texture;
+        if (std::find_if(next_ground_textures_.begin(), next_ground_textures_.end(),
+            [texture](TextureHandle t) { return t.index == texture.index; }) == next_ground_textures_.end()) {
+            next_ground_textures_.push_back(texture);
+            resources_.Acquire(texture);
+        }
+    }
+    for (int i = 0; i < ground_textures_.size(); i++) {
+        resources_.Release(ground_textures_[i]);
+    }
+    ground_textures_.swap(next_ground_textures_);
+}
+
+void Game::LogStateHash(void)
+{
+
+    TickHash hash;
+    memset(&hash, 0, sizeof(hash));
+    hash.tick = tick_;
+    for (int i = 0; i < num_players_; i++) {
+        hash.inputs[i] = tick_inputs_[i];
+    }
+
+    // Every part is hashed straight from the component arrays, field by field so padding doesn't count
+    unsigned long long transforms = HASH_SEED;
+    world_.Each<Transform>([&](Entity entity, Transform &transform) {
+        transforms = HashValue(transforms, entity);
+        transforms = HashValue(transforms, transform.position);
+        transforms = HashValue(transforms, transform.angle);
+        transforms = HashValue(transforms, transform.scale);
+    });
+    unsigned long long motion = HASH_SEED;
+    world_.Each<Motion>([&](Entity entity, Motion &m) {
+        motion = HashValue(motion, entity);
+        motion = HashValue(motion, m.velocity);
+    });
+    unsigned long long health = HASH_SEED;
+    world_.Each<Health>([&](Entity entity, Health &h) {
+        health = HashValue(health, entity);
+        health = HashValue(health, h.health);
+    });
+
+    unsigned long long game = HashValue(HASH_SEED, sim_time_);
+    game = HashBytes(game, state.data(), state.size());
+    game = HashValue(game, enemySpawnTimer_);
+    game = HashValue(game, powerupSpawnTimer_);
+    game = HashValue(game, scripts_.GetNumScripts());
+    world_.Each<Player>([&](Entity entity, Player &player) {
+        game = HashValue(game, player.weapon_type);
+        game = HashValue(game, player.rof);
+        game = HashValue(game, player.cooldown);
+        game = HashValue(game, player.shield);
+    });
+
+    hash.parts[HASH_ENTITIES] = world_.Hash();
+    hash.parts[HASH_TRANSFORMS] = transforms;
+    hash.parts[HASH_MOTION] = motion;
+    hash.parts[HASH_HEALTH] = health;
+    hash.parts[HASH_TIMERS] = timers_.Hash();
+    hash.parts[HASH_RANDOM] = HashValue(HASH_SEED, random_.GetState());
+    hash.parts[HASH_GAME] = game;
+    hash.parts[HASH_BULLETS] = bullets_.Hash();
+    hash.total = HashBytes(HASH_SEED, hash.parts, sizeof(hash.parts));
+
+    // Detailed logs keep the values too, so the desync tool can tell which fields differ
+    hash_entities_.clear();
+    if (hash_log_.IsDetailed()) {
+        world_.Each<Transform>([&](Entity entity, Transform &transform) {
+            EntityState e;
+            memset(&e, 0, sizeof(e));
+            e.entity = entity;
+            e.mask = world_.GetMask(entity);
+            memcpy(e.position, &transform.position, sizeof(e.position));
+            e.angle = transform.angle;
+            e.scale = transform.scale;
+            if (world_.Has<Motion>(entity)) {
+                memcpy(e.velocity, &world_.Get<Motion>(entity).velocity, sizeof(e.velocity));
+            }
+            if (world_.Has<Health>(entity)) {
+                e.health = world_.Get<Health>(entity).health;
             }
+            hash_entities_.push_back(e);
+        });
+    }
+    hash.num_entities = (int) hash_entities_.size();
+    hash_log_.Write(hash, hash_entities_.data());
+}
+
+void Game::RecordSnapshot(void)
+{
 
-            SpawnBullet(current_game_object, 2);
-        }
-        else if (current_game_object->GetTag() == "plane2") {
-            //rotateing the enemy 90 degrees each time a bullet is spawned
-            //this happens 4 times so it will bring the player back to where they started
-            double time = current_game_object->GetTime();
-            current_game_object->SetAngle(current_game_object->GetAngle() + 90);
-            SpawnBullet(current_game_object, 2);
-            current_game_object->SetTime(time);
-            current_game_object->SetAngle(current_game_object->GetAngle() + 90);
-            SpawnBullet(current_game_object, 2);
-            current_game_object->SetTime(time);
-            current_game_object->SetAngle(current_game_object->GetAngle() + 90);
-            SpawnBullet(current_game_object, 2);
-            current_game_object->SetTime(time);
-            current_game_object->SetAngle(current_game_object->GetAngle() + 90);
-            SpawnBullet(current_game_object, 2);
-            current_game_object->SetAngle(current_game_object->GetAngle() + delta_time*40);
-        }
-        else if (current_game_object->GetTag() == "plane3") {
-            //std::printf("plane 3 x:%f\n", cos(glfwGetTime()) * 2.0);
-            current_game_object->SetPosition(glm::vec3(cos(glfwGetTime())*2.0, current_game_object->GetPosition()[1], 0));
-            SpawnBullet(current_game_object, 2);
-        }
-        else if (current_game_object->GetTag() == "plane4") {
-            double time = current_game_object->GetTime();
-            current_game_object->SetAngle(current_game_object->GetAngle() - 90);
-            SpawnBullet(current_game_object, 2);
-            current_game_object->SetTime(time);
-            current_game_object->SetAngle(current_game_object->GetAngle() + 180);
-            SpawnBullet(current_game_object, 2);
-            current_game_object->SetAngle(current_game_object->GetAngle() - 90);
-        }
-        else if (current_game_object->GetTag() == "planeboss") {
-            current_game_object->SetPosition(glm::vec3(cos(glfwGetTime()) * 2.0, current_game_object->GetPosition()[1], 0));
-            current_game_object->SetVelocity(glm::vec3(0.0f, game_objects_[0]->GetVelocity()[1], 0.0f));
-            SpawnBullet(current_game_object, 2);
-        }
-
-        if (current_game_object->GetTag() == "heart") {
-            PlayerGameObject* player = dynamic_cast<PlayerGameObject*>(game_objects_[0]);
-            current_game_object->SetTex(tex_[11 + player->GetHealth()]);
-            float x = player->GetPosition()[1];
-            current_game_object->SetPosition(glm::vec3(2.5, 5.7 + x, 0));
-        }
-
-        // Switch weapon
-        //if (current_game_object->GetTag() == "bullet" & !shoot) {
-            //current_game_object->SetTex(tex_[3+type_weapon]);
-        //}
-        
-        // Update the current game object
-        current_game_object->Update(delta_time);
-
-        // Check for collision with other game objects
-        for (int j = i + 1; j < game_objects_.size(); j++) {
-            GameObject* other_game_object = game_objects_[j];
-
-            float distance = glm::length(current_game_object->GetPosition() - other_game_object->GetPosition());
-            if (distance < 0.5f ) {
-               
-                
-                // This is where you would perform collision response between objects
+    // Once the ring is full, the oldest snapshot is overwritten
+    SaveSnapshot(snapshots_[(snapshot_head_ + num_snapshots_) % rewind_ticks_g]);
+    if (num_snapshots_ < rewind_ticks_g) {
+        num_snapshots_++;
+    }
+    else {
+        snapshot_head_ = (snapshot_head_ + 1) % rewind_ticks_g;
+    }
+}
+
+void Game::Rewind(void)
+{
+
+    // The latest snapshot is the tick being shown, so drop it and go back to the one before
+    // The oldest snapshot is kept, rewinding stops there
+    if (num_snapshots_ > 1) {
+        num_snapshots_--;
+    }
+    LoadSnapshot(snapshots_[(snapshot_head_ + num_snapshots_ - 1) % rewind_ticks_g]);
+
+    // Input in flight belongs to ticks that are gone now
+    inputs_.Clear();
+    peer_.Clear();
+}
+
+void Game::StepSimulation(void) {
+
+    Controls();
+    unsigned int tick = tick_ + 1;
+
+    // The first player's input is known right away
+    inputs_.Set(tick, 0, ReadInput(0));
+
+    if (num_players_ > 1) {
+        // The second player's input goes through the peer, and comes back some ticks late
+        InputMessage message = { tick, 1, ReadInput(1) };
+        peer_.Send(message, tick);
+
+        // If the input that arrived differs from what was predicted for those ticks, run them again
+        unsigned int earliest = tick;
+        InputMessage received;
+        while (peer_.Receive(tick, received)) {
+            unsigned int changed;
+            if (inputs_.Confirm(received.tick, received.player, received.input, tick_, &changed) && changed < earliest) {
+                earliest = changed;
             }
         }
+        if (earliest < tick) {
+            Rollback(earliest);
+        }
 
-        // Render game object
-        current_game_object->Render(shader_);
+        if (!inputs_.IsConfirmed(tick, 1)) {
+            inputs_.Predict(tick, 1);
+        }
     }
 
-    // [3] BACKGROUND BG_OBJECTS_ (Background tiles, decorations behind players/enemies)
-    for (int i = 0; i < bg_objects_.size(); i++) {
-        GameObject* current_game_object = bg_objects_[i];
+    for (int i = 0; i < num_players_; i++) {
+        tick_inputs_[i] = inputs_.Get(tick, i);
+    }
+    Update(sim_tick_g);
+    RecordSnapshot();
+}
+
+void Game::Rollback(unsigned int tick) {
 
-        // Background objects have no logic, so we just render them without doing anything else
-        current_game_object->Render(shader_);
+    // The snapshot of the tick before is needed, which is only there for the last few ticks
+    unsigned int latest = tick_;
+    int back = (int) (latest - tick) + 1;
+    if (back > max_rollback_ticks_g || back >= num_snapshots_) {
+        printf("[?] Input for tick %u arrived too late to roll back\n", tick);
+        return;
     }
 
+    double start = Now();
+
+    // Drop the snapshots of the ticks that are run again, so each one is recorded over
+    num_snapshots_ -= back;
+    LoadSnapshot(snapshots_[(snapshot_head_ + num_snapshots_ - 1) % rewind_ticks_g]);
+
+    for (unsigned int t = tick; t <= latest; t++) {
+        for (int i = 0; i < num_players_; i++) {
+            tick_inputs_[i] = inputs_.Get(t, i);
+        }
+        Update(sim_tick_g);
+        RecordSnapshot();
+    }
+
+    rollback_time_ += Now() - start;
+    rollback_ticks_ += back;
+}
+
+void Game::UpdateRollbackMeter(double frame_time) {
+
+    // Take the resimulation time of this frame
+    meter_total_ += rollback_time_;
+    if (rollback_time_ > meter_max_) {
+        meter_max_ = rollback_time_;
+    }
+    meter_ticks_ += rollback_ticks_;
+    meter_frames_++;
+    rollback_time_ = 0.0;
+    rollback_ticks_ = 0;
+
+    // Sum up the average and worst cost per frame once a second, for the window title
+    meter_elapsed_ += frame_time;
+    if (meter_elapsed_ >= 1.0) {
+        snprintf(rollback_text_, sizeof(rollback_text_), "rollback %.3f ms/frame (max %.3f ms), %d ticks resimulated",
+            meter_total_ * 1000.0 / meter_frames_, meter_max_ * 1000.0, meter_ticks_);
+
+        meter_elapsed_ = 0.0;
+        meter_total_ = 0.0;
+        meter_max_ = 0.0;
+        meter_frames_ = 0;
+        meter_ticks_ = 0;
+    }
 }
-       
+
+void Game::SetPacing(int mode) {
+
+    pacer_.SetMode(mode, mode == PACING_ADAPTIVE ? refresh_rate_ : target_fps_g);
+    glfwSwapInterval(pacer_.GetSwapInterval(tear_control_));
+    printf("[!] Frame pacing: %s\n", FramePacer::GetModeName(mode));
+}
+
+
+void Game::PacingControls(void) {
+
+    // Switch to the next pacing mode on P, once per key press
+    bool pacing_key = KeyDown(GLFW_KEY_P);
+    if (pacing_key && !pacing_key_down_) {
+        SetPacing((pacer_.GetMode() + 1) % NUM_PACING_MODES);
+    }
+    pacing_key_down_ = pacing_key;
+}
+
+
+void Game::ShowFrameStats(void) {
+
+    PacingReport report;
+    if (!pacer_.GetReport(report)) {
+        return;
+    }
+
+    // Frame rate, frame time with its jitter, and CPU use in the window title, with the rollback meter when there is one
+    char title[256];
+    int length = snprintf(title, sizeof(title), "%s - %s %.1f fps, %.2f ms +/- %.2f ms (worst %.2f ms), cpu %.0f%%",
+        window_title_g, FramePacer::GetModeName(report.mode), report.fps, report.frame_ms, report.jitter_ms, report.worst_ms,
+        report.cpu * 100.0);
+    if (num_players_ > 1 && rollback_text_[0] != '\0' && length < (int) sizeof(title)) {
+        length += snprintf(title + length, sizeof(title) - length, " - %s", rollback_text_);
+    }
+
+    // Latency of the latest key presses, from when they reached the game to the swap
+    LatencySummary latency;
+    input_latency_.Summarize(latency);
+    if (latency.count > 0 && length < (int) sizeof(title)) {
+        snprintf(title + length, sizeof(title) - length, " - input p50 %.1f ms, p99 %.1f ms", latency.p50 * 1000.0, latency.p99 * 1000.0);
+    }
+    glfwSetWindowTitle(window_, title);
+}
+
+
+void Game::SnapshotControls(void) {
+
+    // Save on F5 and load on F9, once per key press
+    bool save_key = KeyDown(GLFW_KEY_F5);
+    bool load_key = KeyDown(GLFW_KEY_F9);
+
+    if (save_key && !save_key_down_) {
+        const std::vector<char> &latest = snapshots_[(snapshot_head_ + num_snapshots_ - 1) % rewind_ticks_g];
+        std::ofstream file(quicksave_file_g, std::ios::binary);
+        file.write(latest.data(), latest.size());
+        if (file) {
+            printf("[!] Saved tick %u to %s (%d bytes)\n", tick_, quicksave_file_g, (int) latest.size());
+        }
+        else {
+            printf("[?] Could not save to %s\n", quicksave_file_g);
+        }
+    }
+
+    if (load_key && !load_key_down_) {
+        bool loading = false;
+        try {
+            std::vector<char> buffer;
+            LoadFile(quicksave_file_g, buffer);
+            double start = Now();
+            loading = true;
+            LoadSnapshot(buffer);
+            loading = false;
+            printf("[!] Loaded tick %u from %s in %.3f ms\n", tick_, quicksave_file_g, (Now() - start) * 1000.0);
+
+            // The game goes on from the loaded tick, rewinding stops there
+            num_snapshots_ = 0;
+            RecordSnapshot();
+            inputs_.Clear();
+            peer_.Clear();
+        }
+        catch (std::exception &e) {
+            printf("[?] Could not load %s: %s\n", quicksave_file_g, e.what());
+
+            // A damaged file can throw halfway through, with part of the game already loaded
+            // The latest snapshot is the tick the game was at, so go back to it
+            if (loading) {
+                try {
+                    LoadSnapshot(snapshots_[(snapshot_head_ + num_snapshots_ - 1) % rewind_ticks_g]);
+                }
+                catch (std::exception &e) {
+                    printf("[?] Could not go back to tick %u: %s\n", tick_, e.what());
+                }
+            }
+        }
+    }
+
+    save_key_down_ = save_key;
+    load_key_down_ = load_key;
+}
+
 } // namespace game
@@ -4,14 +4,85 @@
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <chrono>
+#include <future>
+#include <string>
 #include <vector>
 
 #include "shader.h"
-#include "game_object.h"
+#include "arena.h"
+#include "ecs.h"
+#include "components.h"
 #include "collision.h"
+#include "bullet_system.h"
+#include "background_layer.h"
+#include "renderer.h"
+#include "software_renderer.h"
+#include "level_streamer.h"
+#include "timer_wheel.h"
+#include "behaviour.h"
+#include "snapshot.h"
+#include "random.h"
+#include "netplay.h"
+#include "state_hash.h"
+#include "frame_pacer.h"
+#include "input_events.h"
+#include "resource_manager.h"
+#include "file_watcher.h"
+#include "headless_context.h"
+#include "frame_capture.h"
 
 namespace game {
 
+    // Textures the game's sprites are drawn with, in the order of their files in texture_files_g
+    enum GameTexture {
+        TEX_PLANE_BLUE,
+        TEX_PLANE_RED,
+        TEX_BULLET,
+        TEX_HEALTH,
+        TEX_SHIELD,
+        TEX_ENEMY_RED,
+        TEX_ENEMY_SPINNER,
+        TEX_ENEMY_SIDESHOT,
+        TEX_ENEMY_BOSS,
+        TEX_HEART_1,
+        TEX_HEART_2,
+        TEX_HEART_3,
+        TEX_PLAYER_SHIELD,
+        TEX_PROGRESS_BAR,
+        TEX_PROGRESS_ARROW,
+        TEX_SHIELD_ORBIT,
+        TEX_TITLE,
+        TEX_BULLET_GREEN,
+        TEX_BULLET_ORANGE,
+        TEX_TITLE_WIN,
+        TEX_TITLE_LOSE,
+        TEX_INDICATOR_1,
+        TEX_INDICATOR_2,
+        NUM_GAME_TEXTURES
+    };
+
+    // How the game was asked to run, from the command line
+    struct GameOptions {
+        // Draw offscreen without a window, for machines with no display (see headless_context.h)
+        // Every frame runs one simulation tick with no input, so the frames are the same on every run
+        bool headless = false;
+        int frames = 600;
+
+        // Frames of a headless run to read back, by tick, and the directory of their golden images
+        // They are compared with the golden images, or saved as the new ones with update_goldens
+        std::vector<unsigned int> capture_ticks;
+        std::string golden_directory;
+        bool update_goldens = false;
+
+        // Run headless through the null renderer, with no OpenGL context at all, to time the simulation alone
+        bool null_renderer = false;
+
+        // Run headless through the software renderer, with no OpenGL context, and save its last frame to a PNG file
+        bool software_renderer = false;
+        std::string dump_file;
+    };
+
     // A class for holding the main game objects
     class Game {
 
@@ -21,8 +92,8 @@ namespace game {
             ~Game();
 
             // Call Init() before calling any other method
-            // Initialize graphics libraries and main window
-            void Init(void); 
+            // Initialize graphics libraries and main window, or the offscreen context when headless
+            void Init(const GameOptions &options = GameOptions());
 
             // Set up the game (scene, game objects, etc.)
             void Setup(void);
@@ -31,14 +102,41 @@ namespace game {
             void MainLoop(void); 
 
         private:
-            // Main window: pointer to the GLFW window structure
+            // Main window: pointer to the GLFW window structure, NULL when headless
             GLFWwindow *window_;
 
+            // Offscreen context used in place of the window when headless
+            GameOptions options_;
+            HeadlessContext headless_;
+
+            // Draw the frames of a headless run as fast as possible, and report how long they took
+            void RunHeadless(void);
+
+            // Frames read back during a headless run, and how many of them matched their golden image
+            FrameCapture capture_;
+            std::vector<unsigned char> frame_pixels_;
+            int goldens_checked_;
+            int goldens_failed_;
+            void CheckFrame(unsigned int tick, const std::vector<unsigned char> &pixels, int width, int height);
+
+            // Whether a key is held, never when headless
+            bool KeyDown(int key);
+
+            // Size of the window, or of the offscreen framebuffer
+            void GetWindowSize(int &width, int &height);
+
             // Shader for rendering the scene
             Shader shader_;
 
-            // Size of geometry to be rendered
-            int size_;
+            // Everything is drawn through renderer_, which is the OpenGL one unless the null one was asked for
+            Renderer *renderer_;
+            GLRenderer gl_renderer_;
+            NullRenderer null_renderer_;
+            SoftwareRenderer software_renderer_;
+
+            // World space range of y values currently seen by the camera
+            float view_bottom_;
+            float view_top_;
 
             //if shooting
             bool shoot = false;
@@ -47,48 +145,257 @@ namespace game {
             // game state
             std::string state;
 
-            // References to textures
-#define NUM_TEXTURES 30
-            GLuint tex_[NUM_TEXTURES];
+            // Every texture, loaded by name. The game's own textures are pinned for as long as it runs,
+            // and the textures of the ground only while a chunk streamed in uses them
+            ResourceManager resources_;
+            TextureHandle textures_[NUM_GAME_TEXTURES];
+            std::vector<TextureHandle> ground_textures_;
+            std::vector<TextureHandle> next_ground_textures_;
+
+            // Shaders and textures saved while the game runs are loaded again between frames
+            // Textures are decoded on a worker thread, and only the upload happens on this one
+            struct TextureReload {
+                TextureHandle texture;
+                std::future<TextureImage> image;
+                std::chrono::steady_clock::time_point start;
+                bool again;
+            };
+            FileWatcher watcher_;
+            std::vector<std::string> changed_files_;
+            std::vector<TextureReload> texture_reloads_;
+            void HotReload(void);
+            void ReloadShaders(void);
+
+            // Memory of everything that lives as long as the level, given back all at once on restart
+            // Must come before world_, whose chunks it holds
+            Arena level_arena_;
+
+            // Every entity of the game, with their chunks in the level arena
+            World world_;
 
-            // List of game objects
-            std::vector<GameObject*> game_objects_;
+            // The entities at the start of the level, to restart without setting the level up again
+            World::Image initial_world_;
 
-            // List of background objects
-            std::vector<GameObject*> bg_objects_;
+            // Bullets are by far the most numerous objects, so they are kept apart from the entities as plain data
+            BulletSystem bullets_;
 
-            // List of foreground objects
-            std::vector<GameObject*> fg_objects_;
+            // Entities the systems need to find directly
+            // The first player is created first, and is never removed. The camera, the hud and the spawns follow it
+            Entity player_;
+            Entity hud_bar_;
+
+            // Every player, the first one is player_
+            Entity players_[MAX_PLAYERS];
+            int num_players_;
+
+            // Entities removed at the end of the tick
+            std::vector<Entity> destroyed_;
+
+            // Scratch memory for data that only lives during one frame (collision contacts, the render list,
+            // bullet volleys), given back all at once at the end of Update
+            Arena frame_arena_;
+
+            // The level, streamed in chunks around the player
+            LevelStreamer level_;
+            std::vector<LevelEvent> level_events_;
+            std::vector<BackgroundTile> level_tiles_;
 
             // Callback for when the window is resized
             static void ResizeCallback(GLFWwindow* window, int width, int height);
 
-            // Create a square for drawing textures
-            int CreateSprite(void);
+            // Bake the ground tiles of the streamed in chunks, and pin their textures in place of the ones before
+            void BakeGround(void);
 
-            // Set a specific texture
-            void SetTexture(GLuint w, const char *fname);
+            // Steps of Init that have to run on the main thread: the window, then everything that needs its context
+            void OpenWindow(void);
+            void InitGraphics(void);
 
-            // Load all textures
-            void SetAllTextures();
+            // Set up the window's callbacks and the frame pacing
+            void InitWindowEvents(void);
 
-            // Handle user input
+            // When Init started, to report how long the first frame took
+            std::chrono::steady_clock::time_point startup_time_;
+
+            // Handle the keys that are not part of the simulation (closing, restarting, debug tools)
             void Controls(void);
 
-            // Update the game based on user input and simulation
+            // Create a player, with its shield bubble and the particles orbiting it
+            Entity CreatePlayer(int texture, const glm::vec3 &position);
+
+            // Read the buttons a player holds from the keyboard
+            PlayerInput ReadInput(int player);
+
+            // Key events, pushed by the key callback whenever window events are handled and taken right before each tick
+            // The pacer handles window events while it waits, so events are timed close to when they arrive
+            static void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
+            static void WaitEvents(double seconds);
+            void TakeKeyEvents(void);
+            KeyEventQueue key_events_;
+            bool key_events_lost_ = false;
+
+            // Keys held as of the last tick, and keys pressed since the tick before, so quick taps still last one tick
+            bool keys_down_[GLFW_KEY_LAST + 1] = {};
+            bool keys_tapped_[GLFW_KEY_LAST + 1] = {};
+
+            // When the player key events taken during the frame arrived, to measure the latency up to the swap showing them
+            enum { MAX_FRAME_INPUTS = 64 };
+            double input_times_[MAX_FRAME_INPUTS];
+            int num_input_times_ = 0;
+            LatencyStats input_latency_;
+            void MeasureInputLatency(void);
+
+            // Print how much texture memory is used, and how often textures were loaded and evicted
+            void PrintTextureStats(void);
+
+            // Move a player and fire its weapon according to its input for the tick
+            void ApplyInput(Entity player, PlayerInput input);
+
+            // Input of each player for the tick being simulated, and for the ticks before it
+            PlayerInput tick_inputs_[MAX_PLAYERS];
+            InputHistory inputs_;
+
+            // The second player plays through a stand-in for a network peer, so its input arrives late
+            // The simulation goes on with predicted input, and rolls back when the real input turns out different
+            LoopbackPeer peer_;
+
+            // Gather the input of every player and run one tick, rolling back first if late input arrived
+            void StepSimulation(void);
+
+            // Go back to the end of the tick before the given one, and run the ticks since then again
+            void Rollback(unsigned int tick);
+
+            // Time spent resimulating during the frame, and the meter shown in the window title
+            double rollback_time_;
+            int rollback_ticks_;
+            void UpdateRollbackMeter(double frame_time);
+            double meter_elapsed_;
+            double meter_total_;
+            double meter_max_;
+            int meter_frames_;
+            int meter_ticks_;
+            char rollback_text_[128];
+
+            // Waits between frames according to the pacing mode, and measures frame times and CPU use
+            FramePacer pacer_;
+            double refresh_rate_;
+            bool tear_control_;
+            void SetPacing(int mode);
+
+            // Cycle through the pacing modes, and show the frame times in the window title
+            void PacingControls(void);
+            void ShowFrameStats(void);
+            bool pacing_key_down_ = false;
+
+            // Start the level again from its initial image
+            void Restart(void);
+
+            // Advance the simulation by one fixed tick, based on user input
             void Update(double delta_time);
 
+            // Draw the current state of the game
+            void Render(void);
+
+            // Systems, run in this order by Update
+            // Enemy AI runs in the behaviour scripts, before the systems
+            void MovementSystem(double delta_time);
+            void PlayerSystem(void);
+            void ShieldSystem(void);
+            void CollisionSystem(void);
+            void CleanupSystem(void);
+            void HudSystem(void);
+            void RenderSystem(void);
+
+            // Handle a contact found by the collision checks
+            void CollisionResponce(const Contact &contact);
+
+            // Remove an entity at the end of the tick
+            void Kill(Entity entity);
+
+            // Damage a player, unless its shield is up
+            void DamagePlayer(Entity player, int damage);
+
+            // Extend a player's shield by some seconds
+            void AddShield(Entity player, double seconds);
+
+            // Simulation clock, in seconds since the game was set up, and the number of ticks run so far
+            double sim_time_;
+            unsigned int tick_;
+
+            // Random numbers of the simulation, saved with the rest of its state
+            Random random_;
+
+            // Save the whole state of the simulation to a flat snapshot, or restore it from one
+            // Snapshots of this run restore the enemy scripts exactly, for snapshots of another run the scripts are started over
+            // A damaged snapshot throws, and may leave the game partly loaded, so the caller has to load a good one after
+            void SaveSnapshot(std::vector<char> &buffer);
+            void LoadSnapshot(const std::vector<char> &buffer);
+
+            // Snapshots of the last ticks, oldest first from snapshot_head_, for rewinding
+            // The buffers keep their memory, so recording a tick doesn't allocate once they have grown
+            std::vector<std::vector<char> > snapshots_;
+            int snapshot_head_;
+            int num_snapshots_;
+
+            // Identifies this run of the game in its snapshots
+            unsigned long long session_;
+
+            // Record the tick that just ran, or go back one tick
+            void RecordSnapshot(void);
+            void Rewind(void);
+
+            // Hash of every tick, written to the file named by the GAME_HASH_LOG environment variable
+            // With GAME_HASH_DETAIL=1 the values of every entity are written too, for the desync tool
+            HashLog hash_log_;
+            std::vector<EntityState> hash_entities_;
+            void LogStateHash(void);
+
+            // Quick save and load of the latest snapshot to a file
+            void SnapshotControls(void);
+            bool save_key_down_ = false;
+            bool load_key_down_ = false;
+
+            // Every timer of the simulation (fire rates, cooldowns, spawn waves, the shield)
+            TimerWheel timers_;
+            std::vector<TimerExpiry> expired_timers_;
+
+            // Handle a timer that expired
+            void HandleTimer(const TimerExpiry &timer);
+
+            // Enemy behaviour scripts
+            // Must come after timers_, since stopping a script cancels its timer
+            BehaviourScheduler scripts_;
+
             // Function that handles enemy spawning
             void SpawnEnemies(void);
             void SpawnPowerups(void);
-            double enemySpawnTimer_ = 1;
-            double powerupSpawnTimer_ = 1;
+            TimerId enemySpawnTimer_ = 0;
+            TimerId powerupSpawnTimer_ = 0;
+
+            // Spawn a single enemy or powerup by its tag
+            Entity SpawnObject(const std::string &tag, const glm::vec3 &position);
+
+            // Start the behaviour scripts of a newly spawned enemy
+            void StartScripts(Entity enemy);
+
+            // Behaviour scripts of the enemies
+            Behaviour WeaponScript(Entity plane, Volley volley, double delay);
+            Behaviour PlaneScript(Entity plane);
+            Behaviour SpinnerScript(Entity plane);
+            Behaviour SideStepperScript(Entity plane);
+            Behaviour BossScript(Entity plane);
+
+            // Stream the level around the player and handle the events it triggers
+            void StreamLevel(void);
+
+            // Function that checks if a position is outside of the viewport
+            bool CheckOutOfBounds(const glm::vec3 &position);
 
-            // Function that checks if an object is outside of the viewport
-            bool CheckOutOfBounds(GameObject* object);
+            // Function that handles bullet spawning, automatically assumes whether the shooter is a player or enemy
+            // Every bullet of the pattern's volley is spawned at once
+            void SpawnBullets(Entity plane, const BulletPattern &pattern, int turn);
 
-            // Function that handles bullet spawning, automatically assumes whether the object is a player or enemy
-            void SpawnBullet(GameObject* plane, int speed);
+            // Fire one burst of a volley
+            void EmitVolley(const Volley &volley);
 
     }; // class Game
 
@@ -0,0 +1,191 @@
+#include <cstring>
+
+#include "headless_context.h"
+
+#ifdef GAME_HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
+
+#ifdef GAME_HAVE_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+namespace game {
+
+HeadlessContext::HeadlessContext(void)
+{
+
+    backend_ = NULL;
+    width_ = 0;
+    height_ = 0;
+    framebuffer_ = 0;
+    color_ = 0;
+    depth_ = 0;
+    display_ = NULL;
+    context_ = NULL;
+    osmesa_ = NULL;
+}
+
+
+HeadlessContext::~HeadlessContext()
+{
+
+    Close();
+}
+
+
+bool HeadlessContext::Open(int width, int height, std::string &error)
+{
+
+    Close();
+    width_ = width;
+    height_ = height;
+
+    // Each backend adds why it failed, so the error says what was tried
+    error = "No headless OpenGL context:";
+    return OpenEGL(error) || OpenOSMesa(error);
+}
+
+
+bool HeadlessContext::OpenEGL(std::string &error)
+{
+
+#ifdef GAME_HAVE_EGL
+    // The surfaceless platform needs no display server or GPU, only Mesa
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay display = get_platform_display ?
+        get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL) : EGL_NO_DISPLAY;
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        error += " EGL has no surfaceless platform.";
+        return false;
+    }
+
+    const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context") || !eglBindAPI(EGL_OPENGL_API)) {
+        eglTerminate(display);
+        error += " EGL can't make desktop OpenGL contexts without a surface.";
+        return false;
+    }
+
+    // The same kind of context GLFW makes by default, so the same shaders work
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint num_configs = 0;
+    EGLContext context = EGL_NO_CONTEXT;
+    if (eglChooseConfig(display, config_attributes, &config, 1, &num_configs) && num_configs > 0) {
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    }
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        if (context != EGL_NO_CONTEXT) {
+            eglDestroyContext(display, context);
+        }
+        eglTerminate(display);
+        error += " EGL could not make a context.";
+        return false;
+    }
+
+    display_ = display;
+    context_ = context;
+    backend_ = "EGL surfaceless";
+    return true;
+#else
+    error += " Built without EGL.";
+    return false;
+#endif
+}
+
+
+bool HeadlessContext::OpenOSMesa(std::string &error)
+{
+
+#ifdef GAME_HAVE_OSMESA
+    OSMesaContext context = OSMesaCreateContextExt(OSMESA_RGBA, 24, 8, 0, NULL);
+    if (!context) {
+        error += " OSMesa could not make a context.";
+        return false;
+    }
+    osmesa_buffer_.resize((std::size_t) width_ * height_ * 4);
+    if (!OSMesaMakeCurrent(context, osmesa_buffer_.data(), GL_UNSIGNED_BYTE, width_, height_)) {
+        OSMesaDestroyContext(context);
+        error += " OSMesa could not make its context current.";
+        return false;
+    }
+
+    osmesa_ = context;
+    backend_ = "OSMesa";
+    return true;
+#else
+    error += " Built without OSMesa.";
+    return false;
+#endif
+}
+
+
+void HeadlessContext::CreateFramebuffer(void)
+{
+
+    glGenRenderbuffers(1, &color_);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width_, height_);
+
+    // The sprites are sorted by the depth test, so the framebuffer needs depth like the window's
+    glGenRenderbuffers(1, &depth_);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width_, height_);
+
+    glGenFramebuffers(1, &framebuffer_);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_);
+    glViewport(0, 0, width_, height_);
+}
+
+
+void HeadlessContext::Close(void)
+{
+
+    if (!backend_) {
+        return;
+    }
+    if (framebuffer_) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer_);
+        glDeleteRenderbuffers(1, &color_);
+        glDeleteRenderbuffers(1, &depth_);
+        framebuffer_ = 0;
+        color_ = 0;
+        depth_ = 0;
+    }
+
+#ifdef GAME_HAVE_EGL
+    if (context_) {
+        eglMakeCurrent((EGLDisplay) display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext((EGLDisplay) display_, (EGLContext) context_);
+        eglTerminate((EGLDisplay) display_);
+    }
+#endif
+#ifdef GAME_HAVE_OSMESA
+    if (osmesa_) {
+        OSMesaDestroyContext((OSMesaContext) osmesa_);
+    }
+#endif
+
+    display_ = NULL;
+    context_ = NULL;
+    osmesa_ = NULL;
+    osmesa_buffer_.clear();
+    backend_ = NULL;
+}
+
+} // namespace game
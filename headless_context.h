@@ -0,0 +1,68 @@
+#ifndef HEADLESS_CONTEXT_H_
+#define HEADLESS_CONTEXT_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+namespace game {
+
+    /*
+        HeadlessContext makes an OpenGL context without a window or a display, for machines that have neither
+        It tries EGL on Mesa's surfaceless platform first, then OSMesa. Both work on Mesa's software rasterizer
+        Frames are drawn into a framebuffer object of a fixed size, in place of the window's framebuffer
+        The backends are only there when the build found their libraries (GAME_HAVE_EGL, GAME_HAVE_OSMESA)
+    */
+    class HeadlessContext {
+
+        public:
+            HeadlessContext(void);
+            ~HeadlessContext();
+
+            HeadlessContext(const HeadlessContext &) = delete;
+            HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+            // Make a context and make it current. Returns false, with the reason in error, if no backend works
+            bool Open(int width, int height, std::string &error);
+
+            // Make the framebuffer object and bind it. Call once the OpenGL functions are loaded
+            void CreateFramebuffer(void);
+
+            // Delete the framebuffer and the context
+            void Close(void);
+
+            // Getters
+            inline bool IsOpen(void) { return backend_ != NULL; }
+            inline const char *GetBackendName(void) { return backend_; }
+            inline GLuint GetFramebuffer(void) { return framebuffer_; }
+            inline int GetWidth(void) { return width_; }
+            inline int GetHeight(void) { return height_; }
+
+        private:
+            // Name of the backend that made the context, NULL when there is none
+            const char *backend_;
+            int width_;
+            int height_;
+
+            // Framebuffer object and the color and depth buffers attached to it
+            GLuint framebuffer_;
+            GLuint color_;
+            GLuint depth_;
+
+            // EGL display and context
+            void *display_;
+            void *context_;
+
+            // OSMesa context, and the buffer it insists on drawing the default framebuffer into
+            void *osmesa_;
+            std::vector<unsigned char> osmesa_buffer_;
+
+            bool OpenEGL(std::string &error);
+            bool OpenOSMesa(std::string &error);
+
+    }; // class HeadlessContext
+
+} // namespace game
+
+#endif // HEADLESS_CONTEXT_H_
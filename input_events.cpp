@@ -0,0 +1,60 @@
+#include <algorithm>
+
+#include "input_events.h"
+
+namespace game {
+
+LatencyStats::LatencyStats(int capacity)
+{
+
+    capacity_ = capacity > 0 ? capacity : 1;
+    samples_.reserve(capacity_);
+    sorted_.reserve(capacity_);
+    Clear();
+}
+
+
+void LatencyStats::Add(double seconds)
+{
+
+    if (samples_.size() < capacity_) {
+        samples_.push_back(seconds);
+    }
+    else {
+        samples_[next_] = seconds;
+    }
+    next_ = (next_ + 1) % capacity_;
+    total_++;
+}
+
+
+void LatencyStats::Clear(void)
+{
+
+    samples_.clear();
+    next_ = 0;
+    total_ = 0;
+}
+
+
+void LatencyStats::Summarize(LatencySummary &summary)
+{
+
+    summary.count = total_;
+    if (samples_.empty()) {
+        summary.p50 = summary.p90 = summary.p99 = summary.max = 0.0;
+        return;
+    }
+
+    sorted_.assign(samples_.begin(), samples_.end());
+    std::sort(sorted_.begin(), sorted_.end());
+
+    // Each percentile is the sample at its rank, without interpolating
+    int n = (int) sorted_.size();
+    summary.p50 = sorted_[(n - 1) * 50 / 100];
+    summary.p90 = sorted_[(n - 1) * 90 / 100];
+    summary.p99 = sorted_[(n - 1) * 99 / 100];
+    summary.max = sorted_[n - 1];
+}
+
+} // namespace game
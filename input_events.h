@@ -0,0 +1,62 @@
+#ifndef INPUT_EVENTS_H_
+#define INPUT_EVENTS_H_
+
+#include <vector>
+
+#include "spsc_queue.h"
+
+namespace game {
+
+    // A key going down or up, with the time (glfwGetTime) it reached the game
+    struct KeyEvent {
+        int key;
+        int action;
+        double time;
+    };
+
+    // Key events from the window's key callback to the simulation
+    typedef SpscQueue<KeyEvent, 256> KeyEventQueue;
+
+    // Latency percentiles of the samples kept by LatencyStats, in seconds
+    struct LatencySummary {
+        int count;
+        double p50;
+        double p90;
+        double p99;
+        double max;
+    };
+
+    /*
+        LatencyStats keeps the latest latency samples, and works out their percentiles
+        Samples go in a ring of fixed size, so adding one never allocates and old ones drop out
+    */
+    class LatencyStats {
+
+        public:
+            LatencyStats(int capacity = 4096);
+
+            void Add(double seconds);
+
+            // Forget every sample
+            void Clear(void);
+
+            // Percentiles of the samples in the ring, and the number of samples added since the last Clear
+            void Summarize(LatencySummary &summary);
+
+            // Getters
+            inline int GetNumSamples(void) { return (int) samples_.size(); }
+
+        private:
+            std::vector<double> samples_;
+            int capacity_;
+            int next_;
+            int total_;
+
+            // Copy of the samples that gets sorted, so working out percentiles doesn't allocate either
+            std::vector<double> sorted_;
+
+    }; // class LatencyStats
+
+} // namespace game
+
+#endif // INPUT_EVENTS_H_
@@ -0,0 +1,267 @@
+#include <stdexcept>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+
+#include "file_utils.h"
+#include "level_streamer.h"
+
+namespace game {
+
+// Size of one ground tile in world units
+const float tile_size_g = 10.0f;
+
+// How far ahead of and behind the player chunks are kept active
+// The camera sees about 6 units ahead and 2 behind the player
+const float stream_ahead_g = 20.0f;
+const float stream_behind_g = 20.0f;
+
+// Scripted spawns appear this far ahead of the player, the same as random spawns
+const float spawn_ahead_g = 8.0f;
+
+// Directory of the biome textures, relative to the resources directory
+const std::string biome_directory_g = "textures/";
+
+LevelStreamer::LevelStreamer(void)
+{
+
+    next_def_ = 0;
+    next_tile_ = 0;
+    loop_ = 0;
+    endless_ = false;
+    finished_ = true;
+    biome_ = -1;
+    length_ = 0.0f;
+}
+
+
+void LevelStreamer::Load(const char *filename, ResourceManager &resources, bool endless)
+{
+    // The file is parsed straight from its mapping, a line at a time
+    MappedFile file;
+    if (!file.Open(filename)) {
+        throw(std::runtime_error(std::string("Could not open level file ") + std::string(filename)));
+    }
+    std::string_view text = file.GetText();
+
+    defs_.clear();
+    active_.clear();
+    loop_ = 0;
+    length_ = 0.0f;
+
+    int tiles = 0;
+    std::string line;
+    while (!text.empty()) {
+        std::size_t end = text.find('\n');
+        line.assign(text.substr(0, end));
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+        std::istringstream words(line);
+        std::string keyword;
+        if (!(words >> keyword) || keyword[0] == '#') {
+            continue;
+        }
+
+        if (keyword == "chunk") {
+            ChunkDef def;
+            if (!(words >> def.biome >> def.tiles) || def.tiles <= 0) {
+                throw(std::runtime_error(std::string("Bad chunk in level file ") + std::string(filename) + std::string(": ") + line));
+            }
+            std::string texture = biome_directory_g + def.biome + ".png";
+            if (!resources.Exists(texture)) {
+                throw(std::runtime_error(std::string("Unknown biome in level file ") + std::string(filename) + std::string(": ") + def.biome));
+            }
+            def.texture = resources.GetTexture(texture);
+            def.boss = false;
+            defs_.push_back(def);
+            tiles += def.tiles;
+        }
+        else if (keyword == "spawn" && !defs_.empty()) {
+            Spawn spawn;
+            if (!(words >> spawn.tag >> spawn.x >> spawn.tile)) {
+                throw(std::runtime_error(std::string("Bad spawn in level file ") + std::string(filename) + std::string(": ") + line));
+            }
+            defs_.back().spawns.push_back(spawn);
+        }
+        else if (keyword == "boss" && !defs_.empty()) {
+            defs_.back().boss = true;
+            if (length_ == 0.0f) {
+                length_ = (tiles - defs_.back().tiles) * tile_size_g;
+            }
+        }
+        else if (keyword == "loop") {
+            words >> loop_;
+        }
+        else {
+            throw(std::runtime_error(std::string("Unknown line in level file ") + std::string(filename) + std::string(": ") + line));
+        }
+    }
+
+    if (defs_.empty()) {
+        throw(std::runtime_error(std::string("Level file has no chunks: ") + std::string(filename)));
+    }
+    if (loop_ < 0 || loop_ >= defs_.size()) {
+        loop_ = 0;
+    }
+
+    // Spawns inside a chunk are triggered in order of their tile
+    for (int i = 0; i < defs_.size(); i++) {
+        std::stable_sort(defs_[i].spawns.begin(), defs_[i].spawns.end(),
+            [](const Spawn &a, const Spawn &b) { return a.tile < b.tile; });
+    }
+
+    // Without a boss, the end of the level is the end of the last chunk
+    if (length_ == 0.0f) {
+        length_ = tiles * tile_size_g;
+    }
+
+    endless_ = endless;
+    Restart();
+}
+
+
+void LevelStreamer::Restart(void)
+{
+
+    active_.clear();
+    finished_ = false;
+    next_def_ = 0;
+    next_tile_ = 0;
+    biome_ = -1;
+}
+
+
+bool LevelStreamer::Update(float player_y, std::vector<LevelEvent> &events)
+{
+    bool changed = false;
+
+    // Activate the chunks coming into range ahead of the player
+    while (!finished_ && (next_tile_ - 0.5f) * tile_size_g < player_y + stream_ahead_g) {
+        Chunk chunk = { next_def_, next_tile_, 0, false };
+        active_.push_back(chunk);
+        next_tile_ += defs_[next_def_].tiles;
+        changed = true;
+
+        next_def_++;
+        if (next_def_ >= defs_.size()) {
+            if (endless_) {
+                next_def_ = loop_;
+            }
+            else {
+                finished_ = true;
+            }
+        }
+    }
+
+    // Retire the chunks that are far enough behind the player
+    while (!active_.empty()) {
+        const Chunk &chunk = active_.front();
+        float top = (chunk.first_tile + defs_[chunk.def].tiles - 0.5f) * tile_size_g;
+        if (top >= player_y - stream_behind_g) {
+            break;
+        }
+        active_.pop_front();
+        changed = true;
+    }
+
+    // Trigger the events of the active chunks
+    for (int i = 0; i < active_.size(); i++) {
+        Chunk &chunk = active_[i];
+        const ChunkDef &def = defs_[chunk.def];
+        float start = chunk.first_tile * tile_size_g;
+
+        if (!chunk.entered && player_y > start) {
+            chunk.entered = true;
+
+            if (biome_ == -1 || def.biome != defs_[biome_].biome) {
+                biome_ = chunk.def;
+                LevelEvent event = { EVENT_BIOME, def.biome, glm::vec3(0.0f, start, 0.0f) };
+                events.push_back(event);
+            }
+            if (def.boss && !endless_) {
+                LevelEvent event = { EVENT_BOSS, "planeboss", glm::vec3(0.0f, start, 0.0f) };
+                events.push_back(event);
+            }
+        }
+
+        while (chunk.next_spawn < def.spawns.size()) {
+            const Spawn &spawn = def.spawns[chunk.next_spawn];
+            float y = (chunk.first_tile + spawn.tile) * tile_size_g;
+            if (y > player_y + spawn_ahead_g) {
+                break;
+            }
+            LevelEvent event = { EVENT_SPAWN, spawn.tag, glm::vec3(spawn.x, y, 0.0f) };
+            events.push_back(event);
+            chunk.next_spawn++;
+        }
+    }
+
+    return changed;
+}
+
+
+void LevelStreamer::GetTiles(std::vector<BackgroundTile> &tiles)
+{
+
+    tiles.clear();
+    for (int i = 0; i < active_.size(); i++) {
+        const Chunk &chunk = active_[i];
+        const ChunkDef &def = defs_[chunk.def];
+        for (int j = 0; j < def.tiles; j++) {
+            BackgroundTile tile = { glm::vec3(0.0f, (chunk.first_tile + j) * tile_size_g, 0.0f), tile_size_g, def.texture };
+            tiles.push_back(tile);
+        }
+    }
+}
+
+
+void LevelStreamer::Write(SnapshotWriter &writer)
+{
+
+    writer.Write((int) active_.size());
+    for (int i = 0; i < active_.size(); i++) {
+        writer.Write(active_[i]);
+    }
+    writer.Write(next_def_);
+    writer.Write(next_tile_);
+    writer.Write(finished_);
+    writer.Write(biome_);
+}
+
+
+void LevelStreamer::Read(SnapshotReader &reader)
+{
+
+    // Everything is checked before the streamer changes, so a snapshot of another level leaves it as it was
+    int num_active = reader.ReadCount(sizeof(Chunk));
+    const char *chunks = reader.Skip(sizeof(Chunk) * num_active);
+    int next_def, next_tile, biome;
+    bool finished;
+    reader.Read(next_def);
+    reader.Read(next_tile);
+    reader.Read(finished);
+    reader.Read(biome);
+
+    // A finished level has streamed in every chunk, so the next one is past the end
+    int num_defs = (int) defs_.size();
+    bool valid = next_def >= 0 && next_def <= num_defs && (next_def < num_defs || finished) && biome >= -1 && biome < num_defs;
+    for (int i = 0; valid && i < num_active; i++) {
+        Chunk chunk;
+        memcpy(&chunk, chunks + i * sizeof(Chunk), sizeof(Chunk));
+        valid = chunk.def >= 0 && chunk.def < num_defs;
+    }
+    if (!valid) {
+        throw(std::runtime_error(std::string("Snapshot doesn't match the level")));
+    }
+
+    active_.resize(num_active);
+    for (int i = 0; i < num_active; i++) {
+        memcpy(&active_[i], chunks + i * sizeof(Chunk), sizeof(Chunk));
+    }
+    next_def_ = next_def;
+    next_tile_ = next_tile;
+    finished_ = finished;
+    biome_ = biome;
+}
+
+} // namespace game
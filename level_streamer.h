@@ -0,0 +1,117 @@
+#ifndef LEVEL_STREAMER_H_
+#define LEVEL_STREAMER_H_
+
+#include <glm/glm.hpp>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+#include "background_layer.h"
+#include "snapshot.h"
+#include "resource_manager.h"
+
+namespace game {
+
+    // Things that happen as the player moves through the level
+    enum LevelEventType {
+        EVENT_SPAWN,    // A scripted enemy or powerup comes into view
+        EVENT_BIOME,    // The player entered a chunk with a different biome
+        EVENT_BOSS      // The player entered the boss chunk
+    };
+
+    struct LevelEvent {
+        LevelEventType type;
+        std::string tag;
+        glm::vec3 position;
+    };
+
+    /*
+        LevelStreamer reads the level as a sequence of chunks from a data file (see level.txt)
+        Only the chunks around the player are active: they are activated just ahead of the camera
+        and retired once they are far enough behind it, so the work per frame and the number of
+        live tiles do not depend on the length of the level
+    */
+    class LevelStreamer {
+
+        public:
+            LevelStreamer(void);
+
+            // Read the chunk list. Each biome is drawn with the texture of the same name, registered with the resource manager
+            // In endless mode the level loops forever and never reaches the boss
+            void Load(const char *filename, ResourceManager &resources, bool endless);
+
+            // Go back to the start of the level, without reading the file again
+            void Restart(void);
+
+            // Activate and retire chunks around the player, and collect the events the player triggered
+            // Returns true if the set of active tiles changed
+            bool Update(float player_y, std::vector<LevelEvent> &events);
+
+            // Get the ground tiles of all active chunks, sorted by y
+            void GetTiles(std::vector<BackgroundTile> &tiles);
+
+            // Save or restore how far the level has streamed, as part of a game snapshot
+            // The level file itself is not saved, the same one must be loaded
+            void Write(SnapshotWriter &writer);
+            void Read(SnapshotReader &reader);
+
+            // Getters
+            inline float GetLength(void) { return length_; }
+            inline int GetNumActiveChunks(void) { return (int) active_.size(); }
+
+            // Tiles of the active chunks, from the first to one past the last
+            // Chunks always stream in the same order, so the same range means the same ground
+            inline int GetFirstTile(void) { return active_.empty() ? next_tile_ : active_.front().first_tile; }
+            inline int GetEndTile(void) { return next_tile_; }
+
+        private:
+            struct Spawn {
+                std::string tag;
+                float x;
+                int tile;
+            };
+
+            // A chunk as described in the level file
+            struct ChunkDef {
+                std::string biome;
+                TextureHandle texture;
+                int tiles;
+                bool boss;
+                std::vector<Spawn> spawns;
+            };
+
+            // A chunk that is currently streamed in
+            struct Chunk {
+                int def;
+                int first_tile;
+                int next_spawn;
+                bool entered;
+            };
+
+            std::vector<ChunkDef> defs_;
+            std::deque<Chunk> active_;
+
+            // Next chunk to stream in and the tile it starts at
+            int next_def_;
+            int next_tile_;
+
+            // Chunk to go back to after the last one in endless mode
+            int loop_;
+            bool endless_;
+
+            // Set once the last chunk has been streamed in
+            bool finished_;
+
+            // Chunk definition whose biome the player is in, -1 before the first chunk
+            int biome_;
+
+            // Distance from the start of the level to the boss chunk
+            float length_;
+
+    }; // class LevelStreamer
+
+} // namespace game
+
+#endif // LEVEL_STREAMER_H_
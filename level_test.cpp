@@ -0,0 +1,124 @@
+/*
+ *
+ * Checks that the level streamer can be rolled back to any tick, past the boss chunk and in endless mode
+ *
+ * Usage: level_test <resources directory>
+ * Streams level.txt in the way the player moves through it, saving a snapshot every step. Every step the streamer
+ * is also rolled back a few steps and run forward again, and fails if it ends up anywhere else, or a snapshot
+ * doesn't load
+ *
+ */
+
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "level_streamer.h"
+
+using namespace game;
+
+// Distance the player moves each step, and the steps rolled back
+const float step_g = 0.5f;
+const int rollback_steps_g = 8;
+
+// Where the streamer is, enough to tell two of them apart
+struct StreamState {
+    int first_tile;
+    int end_tile;
+    int num_chunks;
+    int num_events;
+};
+
+static StreamState GetState(LevelStreamer &level, int num_events)
+{
+
+    StreamState state = { level.GetFirstTile(), level.GetEndTile(), level.GetNumActiveChunks(), num_events };
+    return state;
+}
+
+static bool SameState(const StreamState &a, const StreamState &b)
+{
+
+    return a.first_tile == b.first_tile && a.end_tile == b.end_tile && a.num_chunks == b.num_chunks &&
+        a.num_events == b.num_events;
+}
+
+// Stream the level up to a distance, rolling back every step. Returns the number of failures
+static int RunLevel(const std::string &directory, bool endless, float distance)
+{
+
+    ResourceManager resources;
+    resources.SetDirectory(directory);
+    LevelStreamer level;
+    level.Load((directory + "/level.txt").c_str(), resources, endless);
+
+    int failures = 0;
+    std::vector<std::vector<char> > snapshots;
+    std::vector<StreamState> states;
+    std::vector<int> events_per_step;
+    std::vector<LevelEvent> events;
+    int num_events = 0;
+
+    for (int step = 0; step * step_g <= distance; step++) {
+        events.clear();
+        level.Update(step * step_g, events);
+        num_events += (int) events.size();
+        events_per_step.push_back((int) events.size());
+
+        snapshots.push_back(std::vector<char>());
+        SnapshotWriter writer(snapshots.back());
+        level.Write(writer);
+        states.push_back(GetState(level, num_events));
+
+        if (step < rollback_steps_g) {
+            continue;
+        }
+
+        // Go back to the snapshot before the rolled back steps, and run them again
+        try {
+            int from = step - rollback_steps_g;
+            SnapshotReader reader(snapshots[from].data(), snapshots[from].size());
+            level.Read(reader);
+            int resimulated = states[from].num_events;
+            for (int s = from + 1; s <= step; s++) {
+                events.clear();
+                level.Update(s * step_g, events);
+                resimulated += (int) events.size();
+            }
+            if (!SameState(GetState(level, resimulated), states[step])) {
+                printf("%s: rolling back to y = %.1f ends up somewhere else\n", endless ? "Endless" : "Level", from * step_g);
+                failures++;
+            }
+        }
+        catch (std::exception &e) {
+            printf("%s: rolling back from y = %.1f failed: %s\n", endless ? "Endless" : "Level", step * step_g, e.what());
+            failures++;
+        }
+    }
+
+    printf("%s: streamed %.0f units, %d tiles, %d events, %d failures\n", endless ? "Endless" : "Level", distance,
+        level.GetEndTile(), num_events, failures);
+    return failures;
+}
+
+int main(int argc, char *argv[])
+{
+
+    if (argc != 2) {
+        printf("Usage: level_test <resources directory>\n");
+        return 1;
+    }
+
+    int failures = 0;
+    try {
+        // Well past the boss chunk, which is the last one
+        failures += RunLevel(argv[1], false, 1000.0f);
+        failures += RunLevel(argv[1], true, 3000.0f);
+    }
+    catch (std::exception &e) {
+        printf("%s\n", e.what());
+        failures++;
+    }
+    return (failures == 0) ? 0 : 1;
+}
@@ -8,19 +8,94 @@
 
 #include <iostream>
 #include <exception>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 #include "game.h"
 
 // Macro for printing exceptions
 #define PrintException(exception_object)\
     std::cerr << exception_object.what() << std::endl
 
+// Command line options
+const char *usage_g = "Usage: game [--headless | --null-render | --software-render [--dump <file>]] [--frames <count>]\n"
+    "            [--golden <directory> [--update-golden]] [--ticks <list>]\n"
+    "  --headless              draw offscreen through EGL or OSMesa, without a window or a display\n"
+    "  --frames <count>        frames to draw when headless (600 by default)\n"
+    "  --golden <directory>    compare frames with the golden images in directory, headless, fails if any differ\n"
+    "  --update-golden         save the frames as the new golden images instead\n"
+    "  --ticks <list>          ticks of the frames to compare, separated by commas (1,60,300,600 by default)\n"
+    "  --null-render           run headless without drawing or any OpenGL context, to time the simulation alone\n"
+    "  --software-render       run headless, drawing on the CPU without any OpenGL context\n"
+    "  --dump <file>           save the last frame of --software-render to a PNG file";
+
+// Read a list of ticks like 1,60,300, false if it isn't one
+static bool ParseTicks(const char *text, std::vector<unsigned int> &ticks)
+{
+
+    ticks.clear();
+    while (*text) {
+        char *end;
+        long tick = strtol(text, &end, 10);
+        if (end == text || tick <= 0 || (*end != ',' && *end != '\0')) {
+            return false;
+        }
+        ticks.push_back((unsigned int) tick);
+        text = *end ? end + 1 : end;
+    }
+    return !ticks.empty();
+}
+
 // Main function that builds and runs the game
-int main(void){
+int main(int argc, char **argv){
+    game::GameOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            options.headless = true;
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options.frames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+            options.golden_directory = argv[++i];
+            options.headless = true;
+        }
+        else if (strcmp(argv[i], "--null-render") == 0) {
+            options.null_renderer = true;
+            options.headless = true;
+        }
+        else if (strcmp(argv[i], "--software-render") == 0) {
+            options.software_renderer = true;
+            options.headless = true;
+        }
+        else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            options.dump_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--update-golden") == 0) {
+            options.update_goldens = true;
+        }
+        else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc && ParseTicks(argv[i + 1], options.capture_ticks)) {
+            i++;
+        }
+        else {
+            std::cerr << usage_g << std::endl;
+            return 2;
+        }
+    }
+    // Golden images need frames, which the null renderer doesn't draw
+    bool goldens = !options.golden_directory.empty();
+    bool usage = (options.update_goldens && !goldens) || (options.null_renderer && goldens) ||
+        (options.null_renderer && options.software_renderer) || (!options.dump_file.empty() && !options.software_renderer);
+    if (usage) {
+        std::cerr << usage_g << std::endl;
+        return 2;
+    }
+
     game::Game the_game;
 
     try {
         // Initialize graphics libraries and main window
-        the_game.Init();
+        the_game.Init(options);
         // Setup the game (scene, game objects, etc.)
         the_game.Setup();
         // Run the game
@@ -29,6 +104,7 @@ int main(void){
     catch (std::exception &e){
         // Catch and print any errors
         PrintException(e);
+        return 1;
     }
 
     return 0;
@@ -0,0 +1,162 @@
+#include "netplay.h"
+
+namespace game {
+
+LoopbackPeer::LoopbackPeer(void)
+{
+
+    head_ = 0;
+    count_ = 0;
+    delay_ = 0;
+}
+
+
+void LoopbackPeer::SetDelay(int ticks)
+{
+
+    delay_ = (ticks > 0) ? ticks : 0;
+}
+
+
+bool LoopbackPeer::Send(const InputMessage &message, unsigned int now)
+{
+
+    if (count_ == CAPACITY) {
+        return false;
+    }
+    InFlight &in_flight = in_flight_[(head_ + count_) % CAPACITY];
+    in_flight.message = message;
+    in_flight.arrival = now + delay_;
+    count_++;
+    return true;
+}
+
+
+bool LoopbackPeer::Receive(unsigned int now, InputMessage &message)
+{
+
+    if (count_ == 0 || in_flight_[head_].arrival > now) {
+        return false;
+    }
+    message = in_flight_[head_].message;
+    head_ = (head_ + 1) % CAPACITY;
+    count_--;
+    return true;
+}
+
+
+void LoopbackPeer::Clear(void)
+{
+
+    head_ = 0;
+    count_ = 0;
+}
+
+
+InputHistory::InputHistory(void)
+{
+
+    Clear();
+}
+
+
+void InputHistory::Clear(void)
+{
+
+    for (int i = 0; i < SIZE; i++) {
+        entries_[i].tick = i;
+        for (int p = 0; p < MAX_PLAYERS; p++) {
+            entries_[i].input[p] = 0;
+            entries_[i].confirmed[p] = false;
+        }
+    }
+    for (int p = 0; p < MAX_PLAYERS; p++) {
+        last_input_[p] = 0;
+        last_tick_[p] = 0;
+    }
+}
+
+
+InputHistory::Entry &InputHistory::Slot(unsigned int tick)
+{
+
+    Entry &entry = entries_[tick % SIZE];
+    if (entry.tick != tick) {
+        entry.tick = tick;
+        for (int p = 0; p < MAX_PLAYERS; p++) {
+            entry.input[p] = 0;
+            entry.confirmed[p] = false;
+        }
+    }
+    return entry;
+}
+
+
+void InputHistory::Set(unsigned int tick, int player, PlayerInput input)
+{
+
+    Entry &entry = Slot(tick);
+    entry.input[player] = input;
+    entry.confirmed[player] = true;
+    if (tick >= last_tick_[player]) {
+        last_input_[player] = input;
+        last_tick_[player] = tick;
+    }
+}
+
+
+void InputHistory::Predict(unsigned int tick, int player)
+{
+
+    Entry &entry = Slot(tick);
+    entry.input[player] = last_input_[player];
+    entry.confirmed[player] = false;
+}
+
+
+PlayerInput InputHistory::Get(unsigned int tick, int player)
+{
+
+    const Entry &entry = entries_[tick % SIZE];
+    return (entry.tick == tick) ? entry.input[player] : 0;
+}
+
+
+bool InputHistory::IsConfirmed(unsigned int tick, int player)
+{
+
+    const Entry &entry = entries_[tick % SIZE];
+    return entry.tick == tick && entry.confirmed[player];
+}
+
+
+bool InputHistory::Confirm(unsigned int tick, int player, PlayerInput input, unsigned int latest, unsigned int *changed)
+{
+
+    // Input older than the history can't be rolled back to anymore
+    if (tick + SIZE <= latest) {
+        return false;
+    }
+
+    bool rollback = false;
+    if (tick <= latest && Get(tick, player) != input) {
+        rollback = true;
+        *changed = tick;
+    }
+    Set(tick, player, input);
+
+    // The ticks after it were predicted with older input
+    for (unsigned int t = tick + 1; t <= latest; t++) {
+        if (IsConfirmed(t, player)) {
+            continue;
+        }
+        if (Get(t, player) != last_input_[player] && !rollback) {
+            rollback = true;
+            *changed = t;
+        }
+        Predict(t, player);
+    }
+    return rollback;
+}
+
+} // namespace game
@@ -0,0 +1,122 @@
+#ifndef NETPLAY_H_
+#define NETPLAY_H_
+
+namespace game {
+
+    // Players that can play at once
+    const int MAX_PLAYERS = 2;
+
+    // Buttons of a player's input, one bit each
+    enum InputButton {
+        INPUT_UP = 1 << 0,
+        INPUT_DOWN = 1 << 1,
+        INPUT_LEFT = 1 << 2,
+        INPUT_RIGHT = 1 << 3,
+        INPUT_FIRE = 1 << 4,
+        INPUT_WEAPON1 = 1 << 5,
+        INPUT_WEAPON2 = 1 << 6
+    };
+
+    // Buttons a player holds during one tick
+    // The simulation only ever sees these, never the keyboard, so a tick can be run again with the same input
+    typedef unsigned char PlayerInput;
+
+    // Input of a player for a tick, as sent to the other side
+    struct InputMessage {
+        unsigned int tick;
+        int player;
+        PlayerInput input;
+    };
+
+    /*
+        LoopbackPeer stands in for a network peer, for playing a remote player on the same machine
+        Messages sent to it come back a fixed number of ticks later, in the order they were sent,
+        like over a connection with that much latency
+    */
+    class LoopbackPeer {
+
+        public:
+            LoopbackPeer(void);
+
+            void SetDelay(int ticks);
+
+            // Send a message at the given tick of the sender
+            // Returns false if too many messages are in flight, the message is dropped then
+            bool Send(const InputMessage &message, unsigned int now);
+
+            // Get the next message that has arrived by the given tick, false if there is none
+            bool Receive(unsigned int now, InputMessage &message);
+
+            // Drop every message in flight
+            void Clear(void);
+
+            // Getters
+            inline int GetDelay(void) { return delay_; }
+
+        private:
+            struct InFlight {
+                InputMessage message;
+                unsigned int arrival;
+            };
+
+            // Messages in flight, in a ring so sending never allocates
+            enum { CAPACITY = 64 };
+            InFlight in_flight_[CAPACITY];
+            int head_;
+            int count_;
+            int delay_;
+
+    }; // class LoopbackPeer
+
+    /*
+        InputHistory keeps the input of every player for the last ticks, for rolling back
+        Input that hasn't arrived yet is predicted by repeating the last confirmed input of the player
+    */
+    class InputHistory {
+
+        public:
+            // Ticks kept, the furthest a rollback can go back
+            enum { SIZE = 64 };
+
+            InputHistory(void);
+
+            // Forget every input, starting over with no buttons held
+            void Clear(void);
+
+            // Set the confirmed input of a player for a tick
+            void Set(unsigned int tick, int player, PlayerInput input);
+
+            // Predict the input of a player for a tick that has no confirmed input yet
+            void Predict(unsigned int tick, int player);
+
+            // Confirm input that arrived late, up to the latest tick simulated so far
+            // Predictions after the tick are redone with the new input. Returns true, with the first tick
+            // whose input changed in changed, if ticks that were already simulated need to run again
+            bool Confirm(unsigned int tick, int player, PlayerInput input, unsigned int latest, unsigned int *changed);
+
+            // Input of a player for a tick, and whether it is confirmed
+            // Ticks that have left the history have no buttons held and aren't confirmed
+            PlayerInput Get(unsigned int tick, int player);
+            bool IsConfirmed(unsigned int tick, int player);
+
+        private:
+            struct Entry {
+                unsigned int tick;
+                PlayerInput input[MAX_PLAYERS];
+                bool confirmed[MAX_PLAYERS];
+            };
+
+            Entry entries_[SIZE];
+
+            // Slot of a tick, emptied first if it still holds the tick SIZE ticks earlier
+            Entry &Slot(unsigned int tick);
+
+            // Last confirmed input of each player, and its tick
+            PlayerInput last_input_[MAX_PLAYERS];
+            unsigned int last_tick_[MAX_PLAYERS];
+
+    }; // class InputHistory
+
+} // namespace game
+
+#endif // NETPLAY_H_
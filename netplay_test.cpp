@@ -0,0 +1,86 @@
+/*
+ *
+ * Checks the rollback input history against a loopback peer, over more ticks than the history holds
+ *
+ * Usage: netplay_test
+ * Plays the second player's input through a peer with a few ticks of delay, the way the game does,
+ * and fails if a tick is simulated with input that is neither confirmed nor the last confirmed one,
+ * or if there are more rollbacks than changes of input
+ *
+ */
+
+#include <cstdio>
+
+#include "netplay.h"
+
+using namespace game;
+
+// Ticks to run, several times the history
+const unsigned int num_ticks_g = 500;
+
+// Delay of the peer, in ticks
+const int delay_g = 4;
+
+// Input the second player holds at a tick, changing every so often
+static PlayerInput RemoteInput(unsigned int tick)
+{
+
+    return (PlayerInput) (((tick / 37) % 2 == 0) ? INPUT_LEFT : INPUT_FIRE);
+}
+
+int main(void)
+{
+
+    InputHistory inputs;
+    LoopbackPeer peer;
+    peer.SetDelay(delay_g);
+
+    int failures = 0;
+    int rollbacks = 0;
+    int changes = 0;
+    unsigned int latest = 0;
+    PlayerInput last_confirmed = 0;
+
+    for (unsigned int tick = 1; tick <= num_ticks_g; tick++) {
+        inputs.Set(tick, 0, 0);
+
+        InputMessage message = { tick, 1, RemoteInput(tick) };
+        peer.Send(message, tick);
+
+        // Before any input arrives, no buttons are predicted
+        PlayerInput previous = (tick > 1) ? RemoteInput(tick - 1) : 0;
+        if (RemoteInput(tick) != previous) {
+            changes++;
+        }
+
+        InputMessage received;
+        while (peer.Receive(tick, received)) {
+            unsigned int changed;
+            if (inputs.Confirm(received.tick, received.player, received.input, latest, &changed)) {
+                rollbacks++;
+            }
+            last_confirmed = received.input;
+        }
+
+        if (!inputs.IsConfirmed(tick, 1)) {
+            inputs.Predict(tick, 1);
+        }
+
+        // Input of a tick that hasn't arrived must be the last that has
+        PlayerInput expected = inputs.IsConfirmed(tick, 1) ? RemoteInput(tick) : last_confirmed;
+        if (inputs.Get(tick, 1) != expected) {
+            printf("Tick %u simulated with input %d, expected %d\n", tick, inputs.Get(tick, 1), expected);
+            failures++;
+        }
+        latest = tick;
+    }
+
+    // Every change of input is mispredicted once, and nothing else is
+    if (rollbacks != changes) {
+        printf("%d rollbacks for %d changes of input\n", rollbacks, changes);
+        failures++;
+    }
+
+    printf("%d ticks, %d rollbacks, %d failures\n", num_ticks_g, rollbacks, failures);
+    return (failures == 0) ? 0 : 1;
+}
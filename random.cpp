@@ -0,0 +1,29 @@
+#include "random.h"
+
+namespace game {
+
+Random::Random(unsigned long long seed)
+{
+
+    Seed(seed);
+}
+
+
+void Random::Seed(unsigned long long seed)
+{
+
+    // The state must never be zero, or the generator gets stuck there
+    state_ = seed ? seed : 0x9E3779B97F4A7C15ull;
+}
+
+
+unsigned int Random::Next(void)
+{
+
+    state_ ^= state_ >> 12;
+    state_ ^= state_ << 25;
+    state_ ^= state_ >> 27;
+    return (unsigned int) ((state_ * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+} // namespace game
@@ -0,0 +1,35 @@
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+namespace game {
+
+    /*
+        Random is the random number generator of the simulation (xorshift64*)
+        Its whole state is one integer, so it can be saved and restored with the rest of the game,
+        and the same seed always plays out the same way, unlike rand()
+    */
+    class Random {
+
+        public:
+            Random(unsigned long long seed = 1);
+
+            void Seed(unsigned long long seed);
+
+            // Next 32 random bits
+            unsigned int Next(void);
+
+            // Random integer from 0 to n - 1
+            inline int Range(int n) { return (int) (Next() % (unsigned int) n); }
+
+            // Getters and setters of the whole state
+            inline unsigned long long GetState(void) { return state_; }
+            inline void SetState(unsigned long long state) { state_ = state; }
+
+        private:
+            unsigned long long state_;
+
+    }; // class Random
+
+} // namespace game
+
+#endif // RANDOM_H_
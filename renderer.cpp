@@ -0,0 +1,179 @@
+#include "renderer.h"
+
+namespace game {
+
+Renderer::Renderer(void)
+{
+
+    stats_.frames = 0;
+    stats_.sprites = 0;
+    stats_.draw_calls = 0;
+    stats_.bakes = 0;
+    stats_.frame_sprites = 0;
+}
+
+
+Renderer::~Renderer()
+{
+}
+
+
+GLRenderer::GLRenderer(void)
+{
+    // Buffers are created by Init(), once there is an OpenGL context
+    shader_ = NULL;
+    resources_ = NULL;
+    sprite_vbo_ = 0;
+    sprite_ebo_ = 0;
+    size_ = 0;
+    view_bottom_ = 0.0f;
+    view_top_ = 0.0f;
+}
+
+
+GLRenderer::~GLRenderer()
+{
+
+    if (sprite_vbo_ != 0) {
+        glDeleteBuffers(1, &sprite_vbo_);
+        glDeleteBuffers(1, &sprite_ebo_);
+    }
+}
+
+
+void GLRenderer::Init(Shader *shader, ResourceManager *resources)
+{
+
+    shader_ = shader;
+    resources_ = resources;
+
+    // The face of the square is defined by four vertices and two triangles
+    GLfloat vertex[]  = {
+        // Four vertices of a square
+        // Position      Color                Texture coordinates
+        -0.5f,  0.5f,    1.0f, 0.0f, 0.0f,    0.0f, 0.0f, // Top-left
+         0.5f,  0.5f,    0.0f, 1.0f, 0.0f,    1.0f, 0.0f, // Top-right
+         0.5f, -0.5f,    0.0f, 0.0f, 1.0f,    1.0f, 1.0f, // Bottom-right
+        -0.5f, -0.5f,    1.0f, 1.0f, 1.0f,    0.0f, 1.0f  // Bottom-left
+    };
+
+    // Two triangles referencing the vertices
+    GLuint face[] = {
+        0, 1, 2, // t1
+        2, 3, 0  //t2
+    };
+
+    // Create buffer for vertices
+    glGenBuffers(1, &sprite_vbo_);
+    glBindBuffer(GL_ARRAY_BUFFER, sprite_vbo_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertex), vertex, GL_STATIC_DRAW);
+
+    // Create buffer for faces (index buffer)
+    glGenBuffers(1, &sprite_ebo_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sprite_ebo_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(face), face, GL_STATIC_DRAW);
+    size_ = sizeof(face) / sizeof(GLuint);
+
+    // Set up z-buffer for rendering
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    // Enable Alpha blending
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+
+void GLRenderer::BindSprite(void)
+{
+
+    glBindBuffer(GL_ARRAY_BUFFER, sprite_vbo_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sprite_ebo_);
+    shader_->SetAttributes();
+}
+
+
+void GLRenderer::BeginFrame(const glm::vec3 &clear_color)
+{
+
+    glClearColor(clear_color.r, clear_color.g, clear_color.b, 0.0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    stats_.frame_sprites = 0;
+}
+
+
+void GLRenderer::SetView(const glm::mat4 &view_matrix, float bottom, float top)
+{
+
+    shader_->SetUniformMat4("view_matrix", view_matrix);
+    view_bottom_ = bottom;
+    view_top_ = top;
+}
+
+
+void GLRenderer::SubmitSprite(TextureHandle texture, const glm::mat4 &transformation)
+{
+
+    glBindTexture(GL_TEXTURE_2D, resources_->Use(texture));
+    shader_->SetUniformMat4("transformation_matrix", transformation);
+    glDrawElements(GL_TRIANGLES, size_, GL_UNSIGNED_INT, 0);
+    stats_.sprites++;
+    stats_.frame_sprites++;
+    stats_.draw_calls++;
+}
+
+
+void GLRenderer::SetBackground(const std::vector<BackgroundTile> &tiles)
+{
+
+    background_.Bake(tiles);
+    BindSprite();
+    stats_.bakes++;
+}
+
+
+void GLRenderer::EndFrame(void)
+{
+
+    // The sprites passed the depth test first, so the ground only fills in around them
+    background_.Render(*shader_, *resources_, view_bottom_, view_top_);
+    BindSprite();
+    stats_.draw_calls += background_.GetNumDrawCalls();
+    stats_.frames++;
+}
+
+
+void NullRenderer::BeginFrame(const glm::vec3 &clear_color)
+{
+
+    stats_.frame_sprites = 0;
+}
+
+
+void NullRenderer::SetView(const glm::mat4 &view_matrix, float bottom, float top)
+{
+}
+
+
+void NullRenderer::SubmitSprite(TextureHandle texture, const glm::mat4 &transformation)
+{
+
+    stats_.sprites++;
+    stats_.frame_sprites++;
+}
+
+
+void NullRenderer::SetBackground(const std::vector<BackgroundTile> &tiles)
+{
+
+    stats_.bakes++;
+}
+
+
+void NullRenderer::EndFrame(void)
+{
+
+    stats_.frames++;
+}
+
+} // namespace game
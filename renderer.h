@@ -0,0 +1,115 @@
+#ifndef RENDERER_H_
+#define RENDERER_H_
+
+#include <glm/glm.hpp>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <vector>
+
+#include "shader.h"
+#include "resource_manager.h"
+#include "background_layer.h"
+
+namespace game {
+
+    // What a renderer was asked to draw, counted since it was made
+    struct RenderStats {
+        long long frames;
+        long long sprites;          // Sprites submitted
+        long long draw_calls;       // Draw calls issued, the null renderer issues none
+        int bakes;                  // Times the background was replaced
+        int frame_sprites;          // Sprites submitted during the last frame
+    };
+
+    /*
+        Renderer is what the game draws through, so the same gameplay code runs with or without OpenGL
+        A frame is BeginFrame, SetView, any number of SubmitSprite, then EndFrame
+        Sprites are drawn in the order they are submitted, and the background goes behind them
+    */
+    class Renderer {
+
+        public:
+            Renderer(void);
+            virtual ~Renderer();
+
+            // Start a frame cleared to a color
+            virtual void BeginFrame(const glm::vec3 &clear_color) = 0;
+
+            // Matrix of the camera, and the world space range of y values it sees
+            virtual void SetView(const glm::mat4 &view_matrix, float bottom, float top) = 0;
+
+            // Draw a textured square, transformation places it in the world
+            virtual void SubmitSprite(TextureHandle texture, const glm::mat4 &transformation) = 0;
+
+            // Replace the static background tiles
+            virtual void SetBackground(const std::vector<BackgroundTile> &tiles) = 0;
+
+            // Finish the frame, the part of the background in view is drawn here
+            virtual void EndFrame(void) = 0;
+
+            // Getters
+            inline const RenderStats &GetStats(void) { return stats_; }
+
+        protected:
+            RenderStats stats_;
+
+    }; // class Renderer
+
+    /*
+        GLRenderer draws with OpenGL, through the game's shader and the textures of the resource manager
+        Each sprite is a draw of one shared square, the background is a BackgroundLayer baked into its own buffers
+    */
+    class GLRenderer : public Renderer {
+
+        public:
+            GLRenderer(void);
+            ~GLRenderer();
+
+            // Make the sprite geometry and set up the depth test and blending. Needs the OpenGL context
+            void Init(Shader *shader, ResourceManager *resources);
+
+            // Bind the sprite geometry again, after drawing something else or reloading the shader
+            void BindSprite(void);
+
+            void BeginFrame(const glm::vec3 &clear_color) override;
+            void SetView(const glm::mat4 &view_matrix, float bottom, float top) override;
+            void SubmitSprite(TextureHandle texture, const glm::mat4 &transformation) override;
+            void SetBackground(const std::vector<BackgroundTile> &tiles) override;
+            void EndFrame(void) override;
+
+        private:
+            Shader *shader_;
+            ResourceManager *resources_;
+
+            // Buffers of the sprite geometry, and the number of indices to draw
+            GLuint sprite_vbo_;
+            GLuint sprite_ebo_;
+            int size_;
+
+            // Static background tiles, baked into a single vertex buffer
+            BackgroundLayer background_;
+
+            // World space range of y values seen by the camera this frame
+            float view_bottom_;
+            float view_top_;
+
+    }; // class GLRenderer
+
+    /*
+        NullRenderer draws nothing and needs no OpenGL context, it only counts what it was given
+        It lets the gameplay code run exactly as it would with graphics, for simulation benchmarks
+    */
+    class NullRenderer : public Renderer {
+
+        public:
+            void BeginFrame(const glm::vec3 &clear_color) override;
+            void SetView(const glm::mat4 &view_matrix, float bottom, float top) override;
+            void SubmitSprite(TextureHandle texture, const glm::mat4 &transformation) override;
+            void SetBackground(const std::vector<BackgroundTile> &tiles) override;
+            void EndFrame(void) override;
+
+    }; // class NullRenderer
+
+} // namespace game
+
+#endif // RENDERER_H_
@@ -0,0 +1,308 @@
+#include <cstdio>
+#include <SOIL/SOIL.h>
+
+#include "resource_manager.h"
+
+namespace game {
+
+ResourceManager::ResourceManager(void)
+{
+
+    newest_ = -1;
+    oldest_ = -1;
+    fallback_ = 0;
+    budget_ = 0;
+    bytes_ = 0;
+    loads_ = 0;
+    evictions_ = 0;
+}
+
+
+void ResourceManager::SetDirectory(const std::string &directory)
+{
+
+    directory_ = directory;
+}
+
+
+bool ResourceManager::OpenPack(const char *filename)
+{
+
+    return pack_.Open(filename);
+}
+
+
+void ResourceManager::SetBudget(std::size_t bytes)
+{
+
+    budget_ = bytes;
+}
+
+
+TextureHandle ResourceManager::GetTexture(const std::string &name)
+{
+
+    std::unordered_map<std::string, int>::iterator found = names_.find(name);
+    if (found != names_.end()) {
+        TextureHandle handle = { found->second };
+        return handle;
+    }
+
+    Texture texture;
+    texture.name = name;
+    texture.id = 0;
+    texture.bytes = 0;
+    texture.refs = 0;
+    texture.generation = 0;
+    texture.missing = false;
+    texture.newer = -1;
+    texture.older = -1;
+    textures_.push_back(texture);
+
+    TextureHandle handle = { (int) textures_.size() - 1 };
+    names_[name] = handle.index;
+    return handle;
+}
+
+
+bool ResourceManager::Find(const std::string &name, TextureHandle &texture)
+{
+
+    std::unordered_map<std::string, int>::iterator found = names_.find(name);
+    if (found == names_.end()) {
+        return false;
+    }
+    texture.index = found->second;
+    return true;
+}
+
+
+bool ResourceManager::Exists(const std::string &name)
+{
+
+    unsigned long long size;
+    long long time;
+    const PackEntry *entry = pack_.IsOpen() ? pack_.Find(name.c_str()) : NULL;
+    return (entry && entry->kind == PACK_TEXTURE) || GetFileStamp((directory_ + "/" + name).c_str(), size, time);
+}
+
+
+void ResourceManager::Acquire(TextureHandle texture)
+{
+
+    textures_[texture.index].refs++;
+}
+
+
+void ResourceManager::Release(TextureHandle texture)
+{
+
+    // Nothing is evicted here, the texture is only let go by the next Trim
+    textures_[texture.index].refs--;
+}
+
+
+TextureImage ResourceManager::Decode(TextureHandle texture)
+{
+
+    return Decode(textures_[texture.index].name);
+}
+
+
+TextureImage ResourceManager::Decode(const std::string &name)
+{
+
+    std::string loose = directory_ + "/" + name;
+    TextureImage image;
+
+    const PackEntry *entry = pack_.IsOpen() ? pack_.Find(name.c_str()) : NULL;
+    if (entry && entry->kind == PACK_TEXTURE && pack_.IsFresh(entry, loose.c_str())) {
+        image.data = (const unsigned char *) pack_.GetData(entry);
+        image.width = entry->width;
+        image.height = entry->height;
+        image.levels = entry->levels;
+        image.from_pack = true;
+    }
+    else {
+        image.data = SOIL_load_image(loose.c_str(), &image.width, &image.height, 0, SOIL_LOAD_RGBA);
+        image.owned = image.data != NULL;
+    }
+    return image;
+}
+
+
+void ResourceManager::FreeImage(TextureImage &image)
+{
+
+    if (image.owned) {
+        SOIL_free_image_data((unsigned char *) image.data);
+    }
+    image.data = NULL;
+    image.owned = false;
+}
+
+
+void ResourceManager::Upload(TextureHandle texture, TextureImage &image)
+{
+
+    Texture &t = textures_[texture.index];
+    if (!image.data) {
+        printf("[?] Could not load texture %s\n", t.name.c_str());
+        t.missing = t.id == 0;
+        FreeImage(image);
+        return;
+    }
+    t.missing = false;
+    if (t.id == 0) {
+        glGenTextures(1, &t.id);
+    }
+    else {
+        Unlink(texture.index);
+        bytes_ -= t.bytes;
+    }
+    glBindTexture(GL_TEXTURE_2D, t.id);
+
+    // Copy the decoded image to the texture, and its smaller mip levels that follow it
+    const unsigned char *level = image.data;
+    int width = image.width;
+    int height = image.height;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (int i = 0; i < image.levels; i++) {
+        glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level);
+        if (level) {
+            level += (std::size_t) width * height * 4;
+        }
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels - 1);
+
+    // Texture Wrapping
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Texture Filtering
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    t.bytes = MipChainSize(image.width, image.height, image.levels);
+    bytes_ += t.bytes;
+    PushNewest(texture.index);
+    t.generation++;
+    loads_++;
+    FreeImage(image);
+}
+
+
+GLuint ResourceManager::Use(TextureHandle texture)
+{
+
+    Texture &t = textures_[texture.index];
+    if (t.id == 0 && !t.missing) {
+        TextureImage image = Decode(texture);
+        Upload(texture, image);
+    }
+    else if (t.id != 0 && newest_ != texture.index) {
+        Unlink(texture.index);
+        PushNewest(texture.index);
+    }
+    if (t.id != 0) {
+        return t.id;
+    }
+
+    // The alpha test discards every pixel of it, like the software renderer skips textures it can't load
+    if (fallback_ == 0) {
+        const unsigned char clear[4] = { 0, 0, 0, 0 };
+        glGenTextures(1, &fallback_);
+        glBindTexture(GL_TEXTURE_2D, fallback_);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, clear);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    return fallback_;
+}
+
+
+void ResourceManager::Trim(void)
+{
+
+    int index = oldest_;
+    while (bytes_ > budget_ && index != -1) {
+        int newer = textures_[index].newer;
+        if (textures_[index].refs <= 0) {
+            Evict(index);
+        }
+        index = newer;
+    }
+}
+
+
+void ResourceManager::Invalidate(TextureHandle texture)
+{
+
+    textures_[texture.index].generation++;
+    textures_[texture.index].missing = false;
+}
+
+
+void ResourceManager::Clear(void)
+{
+
+    while (oldest_ != -1) {
+        Evict(oldest_);
+    }
+    if (fallback_ != 0) {
+        glDeleteTextures(1, &fallback_);
+        fallback_ = 0;
+    }
+}
+
+
+TextureStats ResourceManager::GetStats(void)
+{
+
+    TextureStats stats = { (int) textures_.size(), 0, 0, bytes_, budget_, loads_, evictions_ };
+    for (int i = 0; i < textures_.size(); i++) {
+        stats.resident += textures_[i].id != 0 ? 1 : 0;
+        stats.pinned += textures_[i].refs > 0 ? 1 : 0;
+    }
+    return stats;
+}
+
+
+void ResourceManager::Unlink(int index)
+{
+
+    Texture &t = textures_[index];
+    (t.newer == -1 ? newest_ : textures_[t.newer].older) = t.older;
+    (t.older == -1 ? oldest_ : textures_[t.older].newer) = t.newer;
+    t.newer = -1;
+    t.older = -1;
+}
+
+
+void ResourceManager::PushNewest(int index)
+{
+
+    Texture &t = textures_[index];
+    t.newer = -1;
+    t.older = newest_;
+    (newest_ == -1 ? oldest_ : textures_[newest_].newer) = index;
+    newest_ = index;
+}
+
+
+void ResourceManager::Evict(int index)
+{
+
+    Texture &t = textures_[index];
+    Unlink(index);
+    glDeleteTextures(1, &t.id);
+    t.id = 0;
+    bytes_ -= t.bytes;
+    t.bytes = 0;
+    t.generation++;
+    evictions_++;
+}
+
+} // namespace game
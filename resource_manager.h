@@ -0,0 +1,158 @@
+#ifndef RESOURCE_MANAGER_H_
+#define RESOURCE_MANAGER_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "asset_pack.h"
+
+namespace game {
+
+    // Names a texture of the resource manager
+    // A handle stays valid for as long as the manager lives, also while its texture is evicted
+    struct TextureHandle {
+        int index;
+    };
+
+    // A decoded RGBA8 image, with levels - 1 smaller mip levels after it
+    struct TextureImage {
+        const unsigned char *data = NULL;
+        int width = 0;
+        int height = 0;
+        int levels = 1;
+
+        // Images decoded by SOIL are freed once uploaded, images in the pack are not
+        bool owned = false;
+        bool from_pack = false;
+    };
+
+    // How the textures use their budget
+    struct TextureStats {
+        int registered;
+        int resident;
+        int pinned;
+        std::size_t bytes;
+        std::size_t budget;
+        int loads;
+        int evictions;
+    };
+
+    /*
+        ResourceManager loads textures by name on demand, and hands out handles to them
+        Names are paths relative to the resources directory, and each one comes from the asset pack when it has
+        a fresh copy, or from the loose file otherwise
+        Textures are pinned while something holds a reference to them. Once the budget is exceeded, the least
+        recently used textures that are not pinned are evicted, and loaded again the next time they are used
+    */
+    class ResourceManager {
+
+        public:
+            ResourceManager(void);
+
+            ResourceManager(const ResourceManager &) = delete;
+            ResourceManager &operator=(const ResourceManager &) = delete;
+
+            // Where textures are loaded from, and the asset pack to prefer. Returns false if the pack can't be used
+            void SetDirectory(const std::string &directory);
+            bool OpenPack(const char *filename);
+
+            // Bytes of texture memory to stay under, counting every mip level
+            void SetBudget(std::size_t bytes);
+
+            // Handle of a texture, registering the name the first time. Nothing is loaded until it is used
+            TextureHandle GetTexture(const std::string &name);
+
+            // Find the handle of a texture that was registered, without registering it. Returns false if it wasn't
+            bool Find(const std::string &name, TextureHandle &texture);
+
+            // Check that a texture can be loaded, from the pack or from its loose file
+            bool Exists(const std::string &name);
+
+            // Pin a texture, or let it be evicted again once every reference is released
+            void Acquire(TextureHandle texture);
+            void Release(TextureHandle texture);
+
+            // Decode the image of a texture without touching OpenGL, so it can run on a worker thread
+            // No texture may be registered while images are decoded by handle. Decoding by name has no such limit,
+            // it only needs the pack to stay open
+            TextureImage Decode(TextureHandle texture);
+            TextureImage Decode(const std::string &name);
+            static void FreeImage(TextureImage &image);
+
+            // Copy a decoded image to a texture, replacing what it held, and free the image if it is owned
+            // An image that failed to decode leaves the texture as it was, a texture that wasn't loaded yet is marked missing
+            void Upload(TextureHandle texture, TextureImage &image);
+
+            // The OpenGL texture to draw with, loaded now if it is not resident. Counts as a use for the eviction order
+            // Missing textures draw with a transparent one instead, and aren't loaded again until they are invalidated
+            GLuint Use(TextureHandle texture);
+
+            // Evict textures until the budget is met, or only pinned ones are left. Call it once a frame
+            void Trim(void);
+
+            // Note that the file of a texture changed, when it isn't resident to be uploaded again
+            // A missing texture is tried again the next time it is used
+            void Invalidate(TextureHandle texture);
+
+            // Delete every texture. Needs the OpenGL context, so call it before the window is destroyed
+            void Clear(void);
+
+            // Getters
+            TextureStats GetStats(void);
+            inline AssetPack &GetPack(void) { return pack_; }
+            inline const std::string &GetName(TextureHandle texture) { return textures_[texture.index].name; }
+            inline bool IsResident(TextureHandle texture) { return textures_[texture.index].id != 0; }
+
+            // Bumped whenever a texture is uploaded, evicted or invalidated, so images decoded elsewhere can tell they are stale
+            inline unsigned int GetGeneration(TextureHandle texture) { return textures_[texture.index].generation; }
+
+        private:
+            struct Texture {
+                std::string name;
+                GLuint id;
+                std::size_t bytes;
+                int refs;
+                unsigned int generation;
+
+                // Set when the texture couldn't be loaded
+                bool missing;
+
+                // Neighbours in the list of resident textures, from the most to the least recently used
+                int newer;
+                int older;
+            };
+
+            std::vector<Texture> textures_;
+            std::unordered_map<std::string, int> names_;
+
+            // Ends of the list of resident textures, -1 when none are resident
+            int newest_;
+            int oldest_;
+
+            std::string directory_;
+            AssetPack pack_;
+
+            // Transparent texture drawn in place of missing ones, outside the budget
+            GLuint fallback_;
+
+            std::size_t budget_;
+            std::size_t bytes_;
+            int loads_;
+            int evictions_;
+
+            // Take a resident texture off the list, or put it at its newest end
+            void Unlink(int index);
+            void PushNewest(int index);
+
+            // Give back the memory of a resident texture
+            void Evict(int index);
+
+    }; // class ResourceManager
+
+} // namespace game
+
+#endif // RESOURCE_MANAGER_H_
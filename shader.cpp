@@ -1,32 +1,139 @@
 #include <iostream>
 #include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "file_utils.h"
+#include "state_hash.h"
 #include "shader.h"
 
 namespace game {
 
+// Cached program binaries start with this header
+// The version changes whenever the header or the key changes, and binaries of another version are refused
+const unsigned int program_binary_magic_g = 0x48534B48; // "HKSH"
+const unsigned int program_binary_version_g = 1;
+
+struct ProgramBinaryHeader {
+    unsigned int magic;
+    unsigned int version;
+
+    // Hash of the sources and the driver the binary was made from
+    unsigned long long key;
+
+    // Driver specific format of the binary, and its size in bytes after the header
+    unsigned int format;
+    unsigned int size;
+};
+
+// Milliseconds since a point in time
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// Check that the driver can give program binaries back, some only support the calls without any format
+static bool ProgramBinariesSupported(void)
+{
+
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+        return false;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+
+// A binary only works with the driver that made it, so its name is the driver's hash along with the sources'
+static unsigned long long ProgramKey(std::string_view vertex_source, std::string_view fragment_source)
+{
+
+    unsigned long long hash = HashValue(HASH_SEED, program_binary_version_g);
+    hash = HashValue(hash, vertex_source.size());
+    hash = HashBytes(hash, vertex_source.data(), vertex_source.size());
+    hash = HashValue(hash, fragment_source.size());
+    hash = HashBytes(hash, fragment_source.data(), fragment_source.size());
+
+    GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (int i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        const char *s = (const char *) glGetString(strings[i]);
+        std::string_view driver(s ? s : "");
+        hash = HashValue(hash, driver.size());
+        hash = HashBytes(hash, driver.data(), driver.size());
+    }
+    return hash;
+}
+
+
 Shader::Shader(void)
 {
     // Don't do work in the constructor, leave it for the Init() function
+    shader_program_ = 0;
+    cache_stats_ = ShaderCacheStats();
+}
+
+
+void Shader::SetCacheDirectory(const std::string &directory)
+{
+
+    cache_directory_ = directory;
 }
 
 
 void Shader::Init(const char *vertPath, const char *fragPath)
 {
    
-    // Load shader program source code
-    // Vertex program
-    std::string vp = LoadTextFile(vertPath);
-    const char *source_vp = vp.c_str();
-    // Fragment program
-    std::string fp = LoadTextFile(fragPath);
-    const char *source_fp = fp.c_str();
+    // Map the shader program source code, it is compiled straight from the mappings
+    MappedFile vertex, fragment;
+    if (!vertex.Open(vertPath)) {
+        throw(std::ios_base::failure(std::string("Error opening file ") + std::string(vertPath)));
+    }
+    if (!fragment.Open(fragPath)) {
+        throw(std::ios_base::failure(std::string("Error opening file ") + std::string(fragPath)));
+    }
+    InitFromSource(vertex.GetText(), fragment.GetText());
+}
+
+
+void Shader::InitFromSource(std::string_view vertex_source, std::string_view fragment_source)
+{
+
+    // Use the cached binary of these sources if there is one
+    std::string cache_file;
+    unsigned long long key = 0;
+    if (!cache_directory_.empty() && ProgramBinariesSupported()) {
+        key = ProgramKey(vertex_source, fragment_source);
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx.bin", key);
+        cache_file = cache_directory_ + name;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        GLuint program;
+        bool loaded = LoadProgramBinary(cache_file, key, program);
+        cache_stats_.load_ms += MillisecondsSince(start);
+        if (loaded) {
+            ReplaceProgram(program);
+            return;
+        }
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const char *source_vp = vertex_source.data();
+    const char *source_fp = fragment_source.data();
+    GLint length_vp = (GLint) vertex_source.size();
+    GLint length_fp = (GLint) fragment_source.size();
 
     // Create a shader from vertex program source code
     GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vs, 1, &source_vp, NULL);
+    glShaderSource(vs, 1, &source_vp, &length_vp);
     glCompileShader(vs);
 
     // Check if shader compiled successfully
@@ -35,12 +142,13 @@ void Shader::Init(const char *vertPath, const char *fragPath)
     if (status != GL_TRUE) {
         char buffer[512];
         glGetShaderInfoLog(vs, 512, NULL, buffer);
+        glDeleteShader(vs);
         throw(std::ios_base::failure(std::string("Error compiling vertex shader: ") + std::string(buffer)));
     }
 
     // Create a shader from the fragment program source code
     GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fs, 1, &source_fp, NULL);
+    glShaderSource(fs, 1, &source_fp, &length_fp);
     glCompileShader(fs);
 
     // Check if shader compiled successfully
@@ -48,29 +156,131 @@ void Shader::Init(const char *vertPath, const char *fragPath)
     if (status != GL_TRUE) {
         char buffer[512];
         glGetShaderInfoLog(fs, 512, NULL, buffer);
+        glDeleteShader(vs);
+        glDeleteShader(fs);
         throw(std::ios_base::failure(std::string("Error compiling fragment shader: ") + std::string(buffer)));
     }
 
     // Create a shader program linking both vertex and fragment shaders
     // together
-    shader_program_ = glCreateProgram();
-    glAttachShader(shader_program_, vs);
-    glAttachShader(shader_program_, fs);
-    glLinkProgram(shader_program_);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    if (!cache_file.empty()) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+
+    // Delete memory used by shaders, since they were already compiled
+    // and linked
+    glDeleteShader(vs);
+    glDeleteShader(fs);
 
     // Check if shaders were linked successfully
-    glGetProgramiv(shader_program_, GL_LINK_STATUS, &status);
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
     if (status != GL_TRUE) {
         char buffer[512];
-        glGetShaderInfoLog(shader_program_, 512, NULL, buffer);
+        glGetProgramInfoLog(program, 512, NULL, buffer);
+        glDeleteProgram(program);
         throw(std::ios_base::failure(std::string("Error linking shaders: ") + std::string(buffer)));
     }
+    cache_stats_.compile_ms += MillisecondsSince(start);
+
+    if (!cache_file.empty()) {
+        SaveProgramBinary(cache_file, key, program);
+    }
+
+    ReplaceProgram(program);
+}
+
+
+void Shader::ReplaceProgram(GLuint program)
+{
+
+    // The program before is only freed once nothing draws with it anymore
+    if (shader_program_ != 0) {
+        glDeleteProgram(shader_program_);
+    }
+    shader_program_ = program;
+    SetAttributes();
+}
 
-    // Delete memory used by shaders, since they were already compiled
-    // and linked
-    glDeleteShader(vs);
-    glDeleteShader(fs);
 
+bool Shader::LoadProgramBinary(const std::string &filename, unsigned long long key, GLuint &program)
+{
+
+    MappedFile file;
+    if (!file.Open(filename.c_str())) {
+        cache_stats_.misses++;
+        return false;
+    }
+
+    ProgramBinaryHeader header;
+    if (file.GetSize() < sizeof(header)) {
+        cache_stats_.rejected++;
+        return false;
+    }
+    memcpy(&header, file.GetData(), sizeof(header));
+    if (header.magic != program_binary_magic_g || header.version != program_binary_version_g || header.key != key ||
+        header.size != file.GetSize() - sizeof(header)) {
+        cache_stats_.rejected++;
+        return false;
+    }
+
+    // Drivers refuse binaries they no longer understand, for example after an update, by failing the link
+    program = glCreateProgram();
+    glProgramBinary(program, header.format, file.GetData() + sizeof(header), header.size);
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        glDeleteProgram(program);
+        cache_stats_.rejected++;
+        return false;
+    }
+
+    cache_stats_.hits++;
+    return true;
+}
+
+
+void Shader::SaveProgramBinary(const std::string &filename, unsigned long long key, GLuint program)
+{
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(sizeof(ProgramBinaryHeader) + length);
+    ProgramBinaryHeader header = { program_binary_magic_g, program_binary_version_g, key, 0, 0 };
+    GLenum format;
+    glGetProgramBinary(program, length, &length, &format, binary.data() + sizeof(header));
+    header.format = format;
+    header.size = (unsigned int) length;
+    memcpy(binary.data(), &header, sizeof(header));
+
+    // The cache is only a shortcut, so failing to write it is not an error
+    // Binaries are written next to their final name and renamed, so another run never reads half of one
+    std::error_code error;
+    std::filesystem::create_directories(cache_directory_, error);
+    std::string temporary = filename + ".tmp";
+    {
+        std::ofstream file(temporary.c_str(), std::ios::binary);
+        file.write(binary.data(), sizeof(header) + length);
+        if (!file) {
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, filename, error);
+    if (!error) {
+        cache_stats_.saved++;
+    }
+}
+
+
+void Shader::SetAttributes(void)
+{
 
     // Set attributes for shaders
     // Should be consistent with how we created the buffers for the square
@@ -4,9 +4,21 @@
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <string>
+#include <string_view>
 
 namespace game {
 
+    // How the program binary cache did, and the time spent loading binaries and compiling
+    struct ShaderCacheStats {
+        int hits;               // Programs loaded from a cached binary
+        int misses;             // Programs with no cached binary for their sources and driver
+        int rejected;           // Cached binaries that were damaged or that the driver refused
+        int saved;              // Binaries written to the cache
+        double load_ms;
+        double compile_ms;
+    };
+
     class Shader {
 
         public:
@@ -15,9 +27,23 @@ namespace game {
 
             void Init(const char *vertPath, const char *fragPath);
 
+            // Compile and link sources that were already loaded, they don't need to end with a null
+            // Can be called again to reload the program. If the new sources fail, the error is thrown and the
+            // program from before is kept. Enable the shader again after a reload
+            void InitFromSource(std::string_view vertex_source, std::string_view fragment_source);
+
+            // Keep linked program binaries in a directory, keyed on the sources and the driver, and load them
+            // instead of compiling on later runs. Call before Init. An empty directory turns the cache off
+            void SetCacheDirectory(const std::string &directory);
+            inline const ShaderCacheStats &GetCacheStats(void) { return cache_stats_; }
+
             void Enable();
             void Disable();
 
+            // Point the vertex attributes at the currently bound array buffer
+            // Call again after binding a different vertex buffer
+            void SetAttributes(void);
+
             // Sets a uniform integer variable in your shader program to a value
             void SetUniform1i(const GLchar *name, int value);
 
@@ -42,6 +68,16 @@ namespace game {
         private:
             GLuint shader_program_;
 
+            std::string cache_directory_;
+            ShaderCacheStats cache_stats_;
+
+            // Load a cached binary into a new program, or save the binary of a linked program
+            bool LoadProgramBinary(const std::string &filename, unsigned long long key, GLuint &program);
+            void SaveProgramBinary(const std::string &filename, unsigned long long key, GLuint program);
+
+            // Use a new program in place of the one before, which is deleted
+            void ReplaceProgram(GLuint program);
+
     }; // class Shader
 
 } // namespace game
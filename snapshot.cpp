@@ -0,0 +1,49 @@
+#include <stdexcept>
+#include <string>
+
+#include "snapshot.h"
+
+namespace game {
+
+void SnapshotWriter::Write(const void *data, std::size_t size)
+{
+
+    const char *bytes = (const char *) data;
+    buffer_.insert(buffer_.end(), bytes, bytes + size);
+}
+
+
+void SnapshotReader::Read(void *data, std::size_t size)
+{
+
+    const char *p = Skip(size);
+    if (size > 0) {
+        memcpy(data, p, size);
+    }
+}
+
+
+int SnapshotReader::ReadCount(std::size_t element_size)
+{
+
+    int count;
+    Read(count);
+    if (count < 0 || (element_size > 0 && count > GetRemaining() / element_size)) {
+        throw(std::runtime_error(std::string("Bad array in snapshot")));
+    }
+    return count;
+}
+
+
+const char *SnapshotReader::Skip(std::size_t size)
+{
+
+    if (size > size_ - offset_) {
+        throw(std::runtime_error(std::string("Snapshot is truncated")));
+    }
+    const char *p = data_ + offset_;
+    offset_ += size;
+    return p;
+}
+
+} // namespace game
@@ -0,0 +1,83 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace game {
+
+    // Snapshots start with this header
+    // The version changes whenever the layout of any saved state changes, old snapshots are refused
+    const unsigned int SNAPSHOT_MAGIC = 0x59534B48; // "HKSY"
+    const unsigned int SNAPSHOT_VERSION = 5;
+
+    struct SnapshotHeader {
+        unsigned int magic;
+        unsigned int version;
+
+        // Bytes after the header
+        unsigned int size;
+
+        // Simulation tick the snapshot was taken at
+        unsigned int tick;
+
+        // Identifies the run of the game that took the snapshot
+        // Snapshots of the same run can restore pointers into the process, like coroutine frames
+        unsigned long long session;
+    };
+
+    /*
+        SnapshotWriter appends plain data to a flat byte buffer
+        State is written as raw bytes, in the same order it is read back, so snapshots are only valid
+        for the same build of the game on the same platform
+        The buffer keeps its capacity between snapshots, so taking one doesn't allocate once it has grown
+    */
+    class SnapshotWriter {
+
+        public:
+            explicit SnapshotWriter(std::vector<char> &buffer) : buffer_(buffer) {}
+
+            void Write(const void *data, std::size_t size);
+            template<class T> void Write(const T &value) { Write(&value, sizeof(T)); }
+
+            // A count followed by the elements
+            template<class T> void WriteArray(const T *data, int count) { Write(count); Write(data, sizeof(T) * count); }
+
+            inline std::size_t GetSize(void) { return buffer_.size(); }
+
+        private:
+            std::vector<char> &buffer_;
+
+    }; // class SnapshotWriter
+
+    /*
+        SnapshotReader reads the data written by a SnapshotWriter, in the same order
+        Reading past the end throws, so a truncated snapshot can't be half loaded into the game
+    */
+    class SnapshotReader {
+
+        public:
+            SnapshotReader(const char *data, std::size_t size) : data_(data), size_(size), offset_(0) {}
+
+            void Read(void *data, std::size_t size);
+            template<class T> void Read(T &value) { Read(&value, sizeof(T)); }
+
+            // Read the count of an array, checking that its elements fit in the rest of the snapshot
+            int ReadCount(std::size_t element_size);
+
+            // Skip over some bytes, returning where they are so they can be copied straight from the snapshot
+            const char *Skip(std::size_t size);
+
+            inline std::size_t GetRemaining(void) { return size_ - offset_; }
+
+        private:
+            const char *data_;
+            std::size_t size_;
+            std::size_t offset_;
+
+    }; // class SnapshotReader
+
+} // namespace game
+
+#endif // SNAPSHOT_H_
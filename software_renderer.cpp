@@ -0,0 +1,409 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "asset_pack.h"
+#include "frame_capture.h"
+#include "software_renderer.h"
+
+namespace game {
+
+// Linear filtering at a position in texels, clamped to the edge like the OpenGL textures
+// The weights have 8 bits, so a texel of opaque neighbours stays exactly opaque for the alpha test
+static inline uint32_t SampleLinear(const unsigned char *texels, int width, int height, float u, float v)
+{
+
+    // Covered pixels have u and v from 0 up, so x and y are above -1 and truncating them one up rounds down
+    float x = u - 0.5f;
+    float y = v - 0.5f;
+    int floor_x = (int) (x + 1.0f) - 1;
+    int floor_y = (int) (y + 1.0f) - 1;
+    int wx = (int) ((x - (float) floor_x) * 256.0f);
+    int wy = (int) ((y - (float) floor_y) * 256.0f);
+    int x0 = std::max(floor_x, 0);
+    int y0 = std::max(floor_y, 0);
+    int x1 = std::min(floor_x + 1, width - 1);
+    int y1 = std::min(floor_y + 1, height - 1);
+
+    const uint32_t *row0 = (const uint32_t *) texels + (std::size_t) y0 * width;
+    const uint32_t *row1 = (const uint32_t *) texels + (std::size_t) y1 * width;
+    uint32_t p00 = row0[x0], p10 = row0[x1];
+    uint32_t p01 = row1[x0], p11 = row1[x1];
+
+#ifdef __SSE2__
+    // The four channels of the left and the right column side by side in 16 bit lanes
+    __m128i zero = _mm_setzero_si128();
+    __m128i top = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, (int) p10, (int) p00), zero);
+    __m128i bottom = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, (int) p11, (int) p01), zero);
+    __m128i column = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(top, _mm_set1_epi16((short) (256 - wy))),
+        _mm_mullo_epi16(bottom, _mm_set1_epi16((short) wy))), 8);
+    __m128i weighted = _mm_mullo_epi16(column, _mm_set_epi16((short) wx, (short) wx, (short) wx, (short) wx,
+        (short) (256 - wx), (short) (256 - wx), (short) (256 - wx), (short) (256 - wx)));
+    __m128i sum = _mm_srli_epi16(_mm_add_epi16(weighted, _mm_srli_si128(weighted, 8)), 8);
+    return (uint32_t) _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+#else
+    uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t left = (((p00 >> shift) & 255) * (256 - wy) + ((p01 >> shift) & 255) * wy) >> 8;
+        uint32_t right = (((p10 >> shift) & 255) * (256 - wy) + ((p11 >> shift) & 255) * wy) >> 8;
+        result |= ((left * (256 - wx) + right * wx) >> 8) << shift;
+    }
+    return result;
+#endif
+}
+
+
+SoftwareRenderer::SoftwareRenderer(void)
+{
+
+    resources_ = NULL;
+    width_ = 0;
+    height_ = 0;
+    clear_ = 0;
+    view_matrix_ = glm::mat4(1.0f);
+    view_bottom_ = 0.0f;
+    view_top_ = 0.0f;
+    tiles_x_ = 0;
+    tiles_y_ = 0;
+    generation_ = 0;
+    busy_ = 0;
+    quit_ = false;
+    next_tile_ = 0;
+}
+
+
+SoftwareRenderer::~SoftwareRenderer()
+{
+
+    Clear();
+}
+
+
+void SoftwareRenderer::Init(int width, int height, ResourceManager *resources, int num_workers)
+{
+
+    Clear();
+    resources_ = resources;
+    width_ = width;
+    height_ = height;
+    color_.assign((std::size_t) width * height, 0);
+    tiles_x_ = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tiles_y_ = (height + TILE_SIZE - 1) / TILE_SIZE;
+    bins_.resize(tiles_x_ * tiles_y_);
+
+    // The threads start waiting for the generation after this one
+    generation_ = 0;
+    for (int i = 0; i < num_workers; i++) {
+        workers_.push_back(std::thread([this]() { WorkerLoop(); }));
+    }
+}
+
+
+void SoftwareRenderer::Clear(void)
+{
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    start_.notify_all();
+    for (int i = 0; i < workers_.size(); i++) {
+        workers_[i].join();
+    }
+    workers_.clear();
+    quit_ = false;
+
+    for (int i = 0; i < textures_.size(); i++) {
+        ResourceManager::FreeImage(textures_[i].image);
+    }
+    textures_.clear();
+}
+
+
+bool SoftwareRenderer::SavePNG(const char *filename)
+{
+
+    return WritePNG(filename, GetPixels(), width_, height_);
+}
+
+
+void SoftwareRenderer::BeginFrame(const glm::vec3 &clear_color)
+{
+
+    // Cleared pixels have an alpha of zero, like the OpenGL framebuffer, which marks them as not covered yet
+    uint32_t r = (uint32_t) (std::min(std::max(clear_color.r, 0.0f), 1.0f) * 255.0f + 0.5f);
+    uint32_t g = (uint32_t) (std::min(std::max(clear_color.g, 0.0f), 1.0f) * 255.0f + 0.5f);
+    uint32_t b = (uint32_t) (std::min(std::max(clear_color.b, 0.0f), 1.0f) * 255.0f + 0.5f);
+    clear_ = r | (g << 8) | (b << 16);
+    quads_.clear();
+    stats_.frame_sprites = 0;
+}
+
+
+void SoftwareRenderer::SetView(const glm::mat4 &view_matrix, float bottom, float top)
+{
+
+    view_matrix_ = view_matrix;
+    view_bottom_ = bottom;
+    view_top_ = top;
+}
+
+
+void SoftwareRenderer::SubmitSprite(TextureHandle texture, const glm::mat4 &transformation)
+{
+
+    AddQuad(texture, transformation);
+    stats_.sprites++;
+    stats_.frame_sprites++;
+}
+
+
+void SoftwareRenderer::SetBackground(const std::vector<BackgroundTile> &tiles)
+{
+
+    background_ = tiles;
+    stats_.bakes++;
+}
+
+
+void SoftwareRenderer::EndFrame(void)
+{
+
+    // The ground is added last, so the sprites keep the pixels they cover
+    for (int i = 0; i < background_.size(); i++) {
+        const BackgroundTile &tile = background_[i];
+        float half = tile.scale * 0.5f;
+        if (tile.position.y + half > view_bottom_ && tile.position.y - half < view_top_) {
+            glm::mat4 transformation = glm::translate(glm::mat4(1.0f), glm::vec3(tile.position.x, tile.position.y, 0.0f));
+            AddQuad(tile.texture, glm::scale(transformation, glm::vec3(tile.scale, tile.scale, 1.0f)));
+        }
+    }
+
+    // Each tile lists the quads touching it in the order they were added, which is the order they are drawn in
+    for (int i = 0; i < bins_.size(); i++) {
+        bins_[i].clear();
+    }
+    for (int i = 0; i < quads_.size(); i++) {
+        const Quad &quad = quads_[i];
+        for (int ty = quad.y0 / TILE_SIZE; ty <= (quad.y1 - 1) / TILE_SIZE; ty++) {
+            for (int tx = quad.x0 / TILE_SIZE; tx <= (quad.x1 - 1) / TILE_SIZE; tx++) {
+                bins_[ty * tiles_x_ + tx].push_back(i);
+            }
+        }
+    }
+
+    // Draw the tiles on every thread, this one included
+    next_tile_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation_++;
+        busy_ = (int) workers_.size();
+    }
+    start_.notify_all();
+    DrawTiles();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return busy_ == 0; });
+    }
+
+    stats_.draw_calls += (long long) quads_.size();
+    stats_.frames++;
+}
+
+
+void SoftwareRenderer::AddQuad(TextureHandle texture, const glm::mat4 &transformation)
+{
+
+    // Textures are decoded on this thread, the tiles only read them
+    if (texture.index >= (int) textures_.size()) {
+        textures_.resize(texture.index + 1, Texture());
+    }
+    Texture &t = textures_[texture.index];
+    unsigned int generation = resources_->GetGeneration(texture);
+    if (!t.decoded || t.generation != generation) {
+        ResourceManager::FreeImage(t.image);
+        t.image = resources_->Decode(texture);
+        t.decoded = true;
+        t.generation = generation;
+        if (!t.image.data) {
+            printf("[?] Could not load texture %s\n", resources_->GetName(texture).c_str());
+        }
+    }
+    if (!t.image.data) {
+        return;
+    }
+
+    // Where the square's own coordinates s and t, from -0.5 to 0.5, land in the framebuffer, top row first
+    glm::mat4 matrix = view_matrix_ * transformation;
+    float half_width = width_ * 0.5f;
+    float half_height = height_ * 0.5f;
+    float a = matrix[0][0] * half_width, b = matrix[1][0] * half_width;
+    float d = -matrix[0][1] * half_height, e = -matrix[1][1] * half_height;
+    float cx = (matrix[3][0] + 1.0f) * half_width;
+    float cy = (1.0f - matrix[3][1]) * half_height;
+    float det = a * e - b * d;
+    if (fabsf(det) < 1e-12f) {
+        return;
+    }
+
+    Quad quad;
+    float extent_x = 0.5f * (fabsf(a) + fabsf(b));
+    float extent_y = 0.5f * (fabsf(d) + fabsf(e));
+    quad.x0 = std::max((int) floorf(cx - extent_x), 0);
+    quad.y0 = std::max((int) floorf(cy - extent_y), 0);
+    quad.x1 = std::min((int) ceilf(cx + extent_x), width_);
+    quad.y1 = std::min((int) ceilf(cy + extent_y), height_);
+    if (quad.x0 >= quad.x1 || quad.y0 >= quad.y1) {
+        return;
+    }
+
+    // And back, from the framebuffer to the square
+    float ds_dx = e / det, ds_dy = -b / det;
+    float dt_dx = -d / det, dt_dy = a / det;
+
+    // Pick the mip level with about one texel per pixel. OpenGL blends the two nearest levels, the nearest one is close enough
+    const TextureImage &image = t.image;
+    int level = 0;
+    if (image.levels > 1) {
+        float rho = std::max(hypotf(ds_dx * image.width, dt_dx * image.height), hypotf(ds_dy * image.width, dt_dy * image.height));
+        if (rho > 1.0f) {
+            level = std::min((int) floorf(log2f(rho) + 0.5f), image.levels - 1);
+        }
+    }
+    quad.texels = image.data + MipChainSize(image.width, image.height, level);
+    quad.texture_width = std::max(image.width >> level, 1);
+    quad.texture_height = std::max(image.height >> level, 1);
+
+    // Texture coordinates have u along s and v against t, at the center of pixel (0, 0)
+    float w = (float) quad.texture_width;
+    float h = (float) quad.texture_height;
+    float s0 = ds_dx * (0.5f - cx) + ds_dy * (0.5f - cy);
+    float t0 = dt_dx * (0.5f - cx) + dt_dy * (0.5f - cy);
+    quad.u0 = (s0 + 0.5f) * w;
+    quad.v0 = (0.5f - t0) * h;
+    quad.du_dx = ds_dx * w;
+    quad.du_dy = ds_dy * w;
+    quad.dv_dx = -dt_dx * h;
+    quad.dv_dy = -dt_dy * h;
+    quads_.push_back(quad);
+}
+
+
+void SoftwareRenderer::DrawTiles(void)
+{
+
+    int num_tiles = tiles_x_ * tiles_y_;
+    for (;;) {
+        int tile = next_tile_.fetch_add(1);
+        if (tile >= num_tiles) {
+            return;
+        }
+        DrawTile(tile);
+    }
+}
+
+
+void SoftwareRenderer::DrawTile(int tile)
+{
+
+    int left = (tile % tiles_x_) * TILE_SIZE;
+    int top = (tile / tiles_x_) * TILE_SIZE;
+    int right = std::min(left + TILE_SIZE, width_);
+    int bottom = std::min(top + TILE_SIZE, height_);
+    for (int y = top; y < bottom; y++) {
+        std::fill(&color_[(std::size_t) y * width_ + left], &color_[(std::size_t) y * width_ + right], clear_);
+    }
+
+    const std::vector<int> &bin = bins_[tile];
+    for (int i = 0; i < bin.size(); i++) {
+        const Quad &quad = quads_[bin[i]];
+        int x_start = std::max(left, quad.x0);
+        int x_end = std::min(right, quad.x1);
+        int y_start = std::max(top, quad.y0);
+        int y_end = std::min(bottom, quad.y1);
+        float w = (float) quad.texture_width;
+        float h = (float) quad.texture_height;
+
+        for (int y = y_start; y < y_end; y++) {
+            uint32_t *row = &color_[(std::size_t) y * width_];
+            int x = x_start;
+
+#ifdef __SSE2__
+            // Four pixels at a time: the ones inside the square that no sprite covered yet get sampled
+            __m128 u = _mm_add_ps(_mm_set1_ps(quad.u0 + quad.du_dx * x + quad.du_dy * y),
+                _mm_mul_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(quad.du_dx)));
+            __m128 v = _mm_add_ps(_mm_set1_ps(quad.v0 + quad.dv_dx * x + quad.dv_dy * y),
+                _mm_mul_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(quad.dv_dx)));
+            __m128 step_u = _mm_set1_ps(quad.du_dx * 4.0f);
+            __m128 step_v = _mm_set1_ps(quad.dv_dx * 4.0f);
+            __m128 zero = _mm_setzero_ps();
+            __m128 limit_u = _mm_set1_ps(w);
+            __m128 limit_v = _mm_set1_ps(h);
+            for (; x + 4 <= x_end; x += 4) {
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmplt_ps(u, limit_u)),
+                    _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmplt_ps(v, limit_v)));
+                __m128i pixels = _mm_loadu_si128((const __m128i *) (row + x));
+                __m128i empty = _mm_cmpeq_epi32(_mm_srli_epi32(pixels, 24), _mm_setzero_si128());
+                int mask = _mm_movemask_ps(_mm_and_ps(inside, _mm_castsi128_ps(empty)));
+                if (mask) {
+                    float lane_u[4], lane_v[4];
+                    _mm_storeu_ps(lane_u, u);
+                    _mm_storeu_ps(lane_v, v);
+                    for (int lane = 0; lane < 4; lane++) {
+                        if (mask & (1 << lane)) {
+                            uint32_t texel = SampleLinear(quad.texels, quad.texture_width, quad.texture_height,
+                                lane_u[lane], lane_v[lane]);
+                            if ((texel >> 24) == 255) {
+                                row[x + lane] = texel;
+                            }
+                        }
+                    }
+                }
+                u = _mm_add_ps(u, step_u);
+                v = _mm_add_ps(v, step_v);
+            }
+#endif
+
+            for (; x < x_end; x++) {
+                float pixel_u = quad.u0 + quad.du_dx * x + quad.du_dy * y;
+                float pixel_v = quad.v0 + quad.dv_dx * x + quad.dv_dy * y;
+                if ((row[x] >> 24) != 0 || pixel_u < 0.0f || pixel_u >= w || pixel_v < 0.0f || pixel_v >= h) {
+                    continue;
+                }
+
+                // Alpha tested like the fragment shader, which discards anything less than opaque
+                uint32_t texel = SampleLinear(quad.texels, quad.texture_width, quad.texture_height, pixel_u, pixel_v);
+                if ((texel >> 24) == 255) {
+                    row[x] = texel;
+                }
+            }
+        }
+    }
+}
+
+
+void SoftwareRenderer::WorkerLoop(void)
+{
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    unsigned int seen = 0;
+    for (;;) {
+        start_.wait(lock, [&]() { return quit_ || generation_ != seen; });
+        if (quit_) {
+            return;
+        }
+        seen = generation_;
+        lock.unlock();
+        DrawTiles();
+        lock.lock();
+        if (--busy_ == 0) {
+            done_.notify_one();
+        }
+    }
+}
+
+} // namespace game
@@ -0,0 +1,127 @@
+#ifndef SOFTWARE_RENDERER_H_
+#define SOFTWARE_RENDERER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "renderer.h"
+
+namespace game {
+
+    /*
+        SoftwareRenderer draws the sprites into a framebuffer in memory, for machines with no GPU at all
+        It draws what the OpenGL renderer draws: textured squares sampled with linear filtering and clamped to
+        the edge, alpha tested like the fragment shader, where the first sprite to cover a pixel keeps it
+        The sprites of a frame are binned into square tiles of the framebuffer at EndFrame, and a pool of
+        threads draws the tiles, each one on its own, so no two threads ever touch the same pixel
+        Textures are decoded from the resource manager the first time a sprite uses them, and kept until the manager
+        loads or evicts them
+    */
+    class SoftwareRenderer : public Renderer {
+
+        public:
+            SoftwareRenderer(void);
+            ~SoftwareRenderer();
+
+            SoftwareRenderer(const SoftwareRenderer &) = delete;
+            SoftwareRenderer &operator=(const SoftwareRenderer &) = delete;
+
+            // Make a framebuffer of this size, and start num_workers threads to draw besides the calling one
+            void Init(int width, int height, ResourceManager *resources, int num_workers);
+
+            // Stop the threads and free the decoded textures
+            void Clear(void);
+
+            // Write the last frame to a PNG file
+            bool SavePNG(const char *filename);
+
+            void BeginFrame(const glm::vec3 &clear_color) override;
+            void SetView(const glm::mat4 &view_matrix, float bottom, float top) override;
+            void SubmitSprite(TextureHandle texture, const glm::mat4 &transformation) override;
+            void SetBackground(const std::vector<BackgroundTile> &tiles) override;
+            void EndFrame(void) override;
+
+            // Getters
+            // The pixels are RGBA8, top row first
+            inline const unsigned char *GetPixels(void) { return (const unsigned char *) color_.data(); }
+            inline int GetWidth(void) { return width_; }
+            inline int GetHeight(void) { return height_; }
+
+        private:
+            enum { TILE_SIZE = 64 };
+
+            // A sprite in screen space. The texel coordinates of the mip level it samples change linearly
+            // from pixel to pixel, and the pixels whose coordinates fall inside the level are covered
+            struct Quad {
+                const unsigned char *texels;
+                int texture_width;
+                int texture_height;
+
+                // Texel coordinates at the center of pixel (0, 0), and how much they change per pixel
+                float u0, v0;
+                float du_dx, du_dy;
+                float dv_dx, dv_dy;
+
+                // Pixels it may cover, the ends are not included
+                int x0, y0, x1, y1;
+            };
+
+            // The image of a texture, decoded the first time it is drawn, and again once the resource manager
+            // reloads or evicts the texture
+            struct Texture {
+                TextureImage image;
+                bool decoded = false;
+                unsigned int generation = 0;
+            };
+
+            ResourceManager *resources_;
+            std::vector<Texture> textures_;
+
+            // Framebuffer, one RGBA8 pixel in each word. Pixels keep an alpha of zero until a sprite covers them
+            std::vector<uint32_t> color_;
+            int width_;
+            int height_;
+            uint32_t clear_;
+
+            // Camera of the frame
+            glm::mat4 view_matrix_;
+            float view_bottom_;
+            float view_top_;
+
+            // Sprites of the frame in the order they were submitted, and the ones touching each tile
+            std::vector<Quad> quads_;
+            std::vector<std::vector<int> > bins_;
+            int tiles_x_;
+            int tiles_y_;
+
+            // Static background tiles, drawn after the sprites
+            std::vector<BackgroundTile> background_;
+
+            // The threads wait for the generation to change, then take tiles until there are none left
+            std::vector<std::thread> workers_;
+            std::mutex mutex_;
+            std::condition_variable start_;
+            std::condition_variable done_;
+            unsigned int generation_;
+            int busy_;
+            bool quit_;
+            std::atomic<int> next_tile_;
+
+            // Add a square in the world, if it has a texture and any of it is in the framebuffer
+            void AddQuad(TextureHandle texture, const glm::mat4 &transformation);
+
+            // Draw tiles until every one is taken
+            void DrawTiles(void);
+            void DrawTile(int tile);
+
+            void WorkerLoop(void);
+
+    }; // class SoftwareRenderer
+
+} // namespace game
+
+#endif // SOFTWARE_RENDERER_H_
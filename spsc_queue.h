@@ -0,0 +1,61 @@
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <atomic>
+
+namespace game {
+
+    /*
+        SpscQueue is a fixed size lock-free queue between one producer and one consumer
+        The producer only writes the tail and the consumer only writes the head, so neither ever waits for the other.
+        Items are copied in and out, and a full queue refuses new items instead of growing
+    */
+    template<class T, int SIZE>
+    class SpscQueue {
+
+        static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "The size of the queue must be a power of two");
+
+        public:
+            SpscQueue(void) : head_(0), tail_(0) {}
+
+            SpscQueue(const SpscQueue &) = delete;
+            SpscQueue &operator=(const SpscQueue &) = delete;
+
+            // Producer side. Returns false if the queue is full
+            bool Push(const T &item)
+            {
+                unsigned int tail = tail_.load(std::memory_order_relaxed);
+                if (tail - head_.load(std::memory_order_acquire) == SIZE) {
+                    return false;
+                }
+                items_[tail & (SIZE - 1)] = item;
+                tail_.store(tail + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Consumer side. Returns false if the queue is empty
+            bool Pop(T &item)
+            {
+                unsigned int head = head_.load(std::memory_order_relaxed);
+                if (head == tail_.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                item = items_[head & (SIZE - 1)];
+                head_.store(head + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Number of items waiting, only exact when called from one of the two sides while the other is idle
+            inline int GetCount(void) { return (int) (tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire)); }
+
+        private:
+            // Each side's index has its own cache line, so the two don't slow each other down
+            alignas(64) std::atomic<unsigned int> head_;
+            alignas(64) std::atomic<unsigned int> tail_;
+            T items_[SIZE];
+
+    }; // class SpscQueue
+
+} // namespace game
+
+#endif // SPSC_QUEUE_H_
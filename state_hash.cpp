@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "state_hash.h"
+
+namespace game {
+
+// Header of a hash log file
+const unsigned int hash_log_magic_g = 0x4C484B48; // "HKHL"
+const unsigned int hash_log_version_g = 1;
+
+struct HashLogHeader {
+    unsigned int magic;
+    unsigned int version;
+    int detail;
+};
+
+static inline unsigned long long Mix(unsigned long long hash, unsigned long long word)
+{
+
+    hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 32);
+}
+
+
+unsigned long long HashBytes(unsigned long long hash, const void *data, std::size_t size)
+{
+
+    const char *bytes = (const char *) data;
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        unsigned long long word;
+        memcpy(&word, bytes + i, 8);
+        hash = Mix(hash, word);
+    }
+
+    // The last few bytes are padded with the length, so "a" and "a\0" hash differently
+    unsigned long long tail = (unsigned long long) size << 56;
+    memcpy(&tail, bytes + i, size - i);
+    return Mix(hash, tail);
+}
+
+
+const char *HashPartName(int part)
+{
+
+    static const char *names[NUM_HASH_PARTS] = { "entities", "transforms", "motion", "health", "timers", "random", "game", "bullets" };
+    return (part >= 0 && part < NUM_HASH_PARTS) ? names[part] : "unknown";
+}
+
+
+HashLog::HashLog(void)
+{
+
+    detail_ = false;
+}
+
+
+bool HashLog::Open(const char *filename, bool detail)
+{
+
+    file_.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        return false;
+    }
+
+    detail_ = detail;
+    HashLogHeader header = { hash_log_magic_g, hash_log_version_g, detail ? 1 : 0 };
+    file_.write((const char *) &header, sizeof(header));
+    return true;
+}
+
+
+void HashLog::Close(void)
+{
+
+    file_.close();
+}
+
+
+void HashLog::Write(const TickHash &hash, const EntityState *entities)
+{
+
+    TickHash record = hash;
+    if (!detail_) {
+        record.num_entities = 0;
+    }
+    file_.write((const char *) &record, sizeof(record));
+    if (record.num_entities > 0) {
+        file_.write((const char *) entities, sizeof(EntityState) * record.num_entities);
+    }
+}
+
+
+void ReadHashLog(const char *filename, std::vector<TickHash> &ticks, std::vector<int> &offsets, std::vector<EntityState> &entities)
+{
+
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw(std::runtime_error(std::string("Could not open hash log: ") + std::string(filename)));
+    }
+
+    HashLogHeader header;
+    if (!file.read((char *) &header, sizeof(header)) || header.magic != hash_log_magic_g || header.version != hash_log_version_g) {
+        throw(std::runtime_error(std::string("Not a hash log of this version: ") + std::string(filename)));
+    }
+
+    ticks.clear();
+    offsets.clear();
+    entities.clear();
+
+    TickHash record;
+    while (file.read((char *) &record, sizeof(record))) {
+        if (record.num_entities < 0) {
+            throw(std::runtime_error(std::string("Bad record in hash log: ") + std::string(filename)));
+        }
+
+        // A rollback or a restart ran the ticks again from here, the records after it replace the old ones
+        if (!ticks.empty() && record.tick <= ticks.back().tick) {
+            TickHash key;
+            key.tick = record.tick;
+            int first = (int) (std::lower_bound(ticks.begin(), ticks.end(), key,
+                [](const TickHash &a, const TickHash &b) { return a.tick < b.tick; }) - ticks.begin());
+            entities.resize(offsets[first]);
+            ticks.resize(first);
+            offsets.resize(first);
+        }
+
+        ticks.push_back(record);
+        offsets.push_back((int) entities.size());
+        entities.resize(entities.size() + record.num_entities);
+        if (record.num_entities > 0 && !file.read((char *) (entities.data() + offsets.back()), sizeof(EntityState) * record.num_entities)) {
+            throw(std::runtime_error(std::string("Hash log is truncated: ") + std::string(filename)));
+        }
+    }
+}
+
+} // namespace game
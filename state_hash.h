@@ -0,0 +1,92 @@
+#ifndef STATE_HASH_H_
+#define STATE_HASH_H_
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ecs.h"
+#include "netplay.h"
+
+namespace game {
+
+    // 64 bit hash that data is added to a piece at a time
+    // Whole words are mixed at once, so hashing the component arrays of a big world stays cheap
+    const unsigned long long HASH_SEED = 0xCBF29CE484222325ull;
+    unsigned long long HashBytes(unsigned long long hash, const void *data, std::size_t size);
+    template<class T> inline unsigned long long HashValue(unsigned long long hash, const T &value) { return HashBytes(hash, &value, sizeof(T)); }
+
+    // Parts of the simulation hashed separately, so a desync shows which kind of state went wrong first
+    enum HashPart {
+        HASH_ENTITIES,      // Which entities exist, and where they are stored
+        HASH_TRANSFORMS,    // Positions, angles and scales
+        HASH_MOTION,        // Velocities
+        HASH_HEALTH,        // Health of players and enemies
+        HASH_TIMERS,        // Every pending timer
+        HASH_RANDOM,        // State of the random number generator
+        HASH_GAME,          // Clock, game state and the players' weapons
+        HASH_BULLETS,       // Every bullet
+        NUM_HASH_PARTS
+    };
+
+    // Names of the parts, for reports
+    const char *HashPartName(int part);
+
+    // Hash of the simulation after one tick, and the input the tick ran with
+    struct TickHash {
+        unsigned int tick;
+        PlayerInput inputs[MAX_PLAYERS];
+        unsigned long long total;
+        unsigned long long parts[NUM_HASH_PARTS];
+
+        // Entities saved after the hash in detailed logs
+        int num_entities;
+    };
+
+    // Values of an entity, saved by detailed logs to find the fields that differ
+    // Components the entity doesn't have are zero
+    struct EntityState {
+        Entity entity;
+        ComponentMask mask;
+        float position[3];
+        float angle;
+        float scale;
+        float velocity[3];
+        int health;
+    };
+
+    /*
+        HashLog writes the hash of every tick to a file, to compare runs that should play out the same way
+        A detailed log also saves the values of every entity, so the first difference can be traced to its fields
+        Ticks that are run again after a rollback are written again, the last record of a tick is the one that counts
+    */
+    class HashLog {
+
+        public:
+            HashLog(void);
+
+            // Start writing to a file, returns false if it can't be opened
+            bool Open(const char *filename, bool detail);
+            void Close(void);
+
+            // Write the hash of a tick, with its entities in detailed logs
+            void Write(const TickHash &hash, const EntityState *entities);
+
+            // Getters
+            inline bool IsOpen(void) { return file_.is_open(); }
+            inline bool IsDetailed(void) { return detail_; }
+
+        private:
+            std::ofstream file_;
+            bool detail_;
+
+    }; // class HashLog
+
+    // Read a whole log, keeping only the last record of every tick, sorted by tick
+    // The entities of detailed records are in entities, each record's start is in offsets
+    void ReadHashLog(const char *filename, std::vector<TickHash> &ticks, std::vector<int> &offsets, std::vector<EntityState> &entities);
+
+} // namespace game
+
+#endif // STATE_HASH_H_
@@ -0,0 +1,174 @@
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "task_graph.h"
+
+namespace game {
+
+TaskGraph::TaskGraph(void)
+{
+
+    worker_head_ = 0;
+    main_head_ = 0;
+    remaining_ = 0;
+    elapsed_ = 0.0;
+}
+
+
+int TaskGraph::Add(const char *name, std::function<void(void)> work, bool main_thread, std::initializer_list<int> after)
+{
+
+    int id = (int) tasks_.size();
+    Task task;
+    task.name = name;
+    task.work = work;
+    task.main_thread = main_thread;
+    task.waiting = 0;
+    task.start = 0.0;
+    task.end = 0.0;
+
+    // Tasks can only wait for tasks added before them, so the graph never has a cycle
+    for (int before : after) {
+        if (before < 0 || before >= id) {
+            throw(std::runtime_error(std::string("Task ") + name + " waits for a task that doesn't exist"));
+        }
+        tasks_[before].next.push_back(id);
+        task.waiting++;
+    }
+
+    tasks_.push_back(task);
+    return id;
+}
+
+
+void TaskGraph::Run(int num_workers)
+{
+
+    start_ = Clock::now();
+    error_ = NULL;
+    worker_ready_.clear();
+    main_ready_.clear();
+    worker_head_ = 0;
+    main_head_ = 0;
+    remaining_ = (int) tasks_.size();
+    for (int i = 0; i < tasks_.size(); i++) {
+        if (tasks_[i].waiting == 0) {
+            (tasks_[i].main_thread ? main_ready_ : worker_ready_).push_back(i);
+        }
+    }
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < num_workers; i++) {
+        workers.push_back(std::thread([this]() { Work(false, false); }));
+    }
+
+    // Without workers, the calling thread runs every task
+    Work(true, num_workers == 0);
+    for (int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    elapsed_ = std::chrono::duration<double>(Clock::now() - start_).count();
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+
+void TaskGraph::PrintReport(void)
+{
+
+    printf("[!] Startup took %.1f ms\n", elapsed_ * 1000.0);
+
+    // One line per stage, in the order they were added
+    for (int i = 0; i < tasks_.size(); i++) {
+        bool seen = false;
+        for (int j = 0; j < i && !seen; j++) {
+            seen = strcmp(tasks_[j].name, tasks_[i].name) == 0;
+        }
+        if (seen) {
+            continue;
+        }
+
+        int count = 0;
+        double start = tasks_[i].start;
+        double end = tasks_[i].end;
+        double work = 0.0;
+        for (int j = i; j < tasks_.size(); j++) {
+            const Task &task = tasks_[j];
+            if (strcmp(task.name, tasks_[i].name) != 0) {
+                continue;
+            }
+            count++;
+            start = task.start < start ? task.start : start;
+            end = task.end > end ? task.end : end;
+            work += task.end - task.start;
+        }
+        printf("[!]   %-18s %3d task%s  %7.1f to %7.1f ms, %7.1f ms of work\n",
+            tasks_[i].name, count, count == 1 ? " " : "s", start * 1000.0, end * 1000.0, work * 1000.0);
+    }
+}
+
+
+void TaskGraph::Work(bool main_thread, bool run_any)
+{
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // After an error nothing new starts, the tasks already running finish on their own
+    while (remaining_ > 0 && !error_) {
+        int task = -1;
+        if (main_thread && main_head_ < main_ready_.size()) {
+            task = main_ready_[main_head_++];
+        }
+        else if ((!main_thread || run_any) && worker_head_ < worker_ready_.size()) {
+            task = worker_ready_[worker_head_++];
+        }
+
+        if (task == -1) {
+            changed_.wait(lock);
+        }
+        else {
+            Execute(task, lock);
+        }
+    }
+}
+
+
+void TaskGraph::Execute(int task, std::unique_lock<std::mutex> &lock)
+{
+
+    // Tasks are not added while the graph runs, so the reference stays valid without the lock
+    Task &t = tasks_[task];
+    lock.unlock();
+
+    t.start = std::chrono::duration<double>(Clock::now() - start_).count();
+    try {
+        t.work();
+    }
+    catch (...) {
+        lock.lock();
+        if (!error_) {
+            error_ = std::current_exception();
+        }
+        changed_.notify_all();
+        return;
+    }
+    t.end = std::chrono::duration<double>(Clock::now() - start_).count();
+
+    lock.lock();
+    remaining_--;
+    for (int i = 0; i < t.next.size(); i++) {
+        Task &next = tasks_[t.next[i]];
+        next.waiting--;
+        if (next.waiting == 0) {
+            (next.main_thread ? main_ready_ : worker_ready_).push_back(t.next[i]);
+        }
+    }
+    changed_.notify_all();
+}
+
+} // namespace game
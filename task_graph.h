@@ -0,0 +1,81 @@
+#ifndef TASK_GRAPH_H_
+#define TASK_GRAPH_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <vector>
+
+namespace game {
+
+    /*
+        TaskGraph runs a set of tasks that depend on each other, starting each one as soon as the tasks before it are done
+        Worker tasks run on a pool of threads. Main tasks run on the thread that calls Run, for the work that
+        has to stay there (the window, anything touching the OpenGL context)
+        Tasks with the same name make up one stage of the report
+    */
+    class TaskGraph {
+
+        public:
+            TaskGraph(void);
+
+            TaskGraph(const TaskGraph &) = delete;
+            TaskGraph &operator=(const TaskGraph &) = delete;
+
+            // Add a task that runs once every task in after is done. Returns its id, for the tasks that come after it
+            int Add(const char *name, std::function<void(void)> work, bool main_thread, std::initializer_list<int> after = {});
+
+            // Run every task and wait for all of them, with this many worker threads besides the calling one
+            // If a task throws, the tasks that haven't started yet are skipped, and the exception is thrown again here
+            void Run(int num_workers);
+
+            // Print how long each stage took, and when it ran
+            void PrintReport(void);
+
+        private:
+            typedef std::chrono::steady_clock Clock;
+
+            struct Task {
+                const char *name;
+                std::function<void(void)> work;
+                bool main_thread;
+
+                // Tasks before it that are not done yet, and the tasks after it
+                int waiting;
+                std::vector<int> next;
+
+                // When it ran, in seconds since Run started
+                double start;
+                double end;
+            };
+
+            std::vector<Task> tasks_;
+
+            // Tasks that can start, for the workers and for the main thread
+            std::vector<int> worker_ready_;
+            std::vector<int> main_ready_;
+            int worker_head_;
+            int main_head_;
+            int remaining_;
+
+            std::mutex mutex_;
+            std::condition_variable changed_;
+            std::exception_ptr error_;
+
+            Clock::time_point start_;
+            double elapsed_;
+
+            // Take ready tasks and run them until there are none left for this thread
+            void Work(bool main_thread, bool run_any);
+
+            // Run a task and start the ones waiting for it. Called with the lock held, which is released while the task runs
+            void Execute(int task, std::unique_lock<std::mutex> &lock);
+
+    }; // class TaskGraph
+
+} // namespace game
+
+#endif // TASK_GRAPH_H_
@@ -0,0 +1,288 @@
+#include <cmath>
+
+#include "timer_wheel.h"
+#include "state_hash.h"
+
+namespace game {
+
+// Length of a tick of the wheel in seconds
+const double tick_seconds_g = 0.001;
+
+// Timer ids pack the index of the timer with its generation
+const int id_index_bits_g = 20;
+const unsigned int id_index_mask_g = (1u << id_index_bits_g) - 1;
+const unsigned int id_generation_mask_g = (1u << (32 - id_index_bits_g)) - 1;
+
+TimerWheel::TimerWheel(void)
+{
+
+    free_ = -1;
+    Reset(0.0);
+}
+
+
+void TimerWheel::Reset(double time)
+{
+
+    timers_.clear();
+    free_ = -1;
+    for (int i = 0; i < LEVELS * SLOTS; i++) {
+        slots_[i] = -1;
+    }
+    time_ = time;
+    base_ = (unsigned long long) std::floor(time / tick_seconds_g) + 1;
+    pending_ = 0;
+}
+
+
+TimerId TimerWheel::Schedule(double delay, int event, unsigned int target)
+{
+    // Reuse a free timer if there is one
+    int index;
+    if (free_ != -1) {
+        index = free_;
+        free_ = timers_[index].next;
+    }
+    else {
+        index = (int) timers_.size();
+        Timer timer;
+        timer.generation = 1;
+        timers_.push_back(timer);
+    }
+
+    Timer &timer = timers_[index];
+    double ticks = std::ceil((time_ + (delay > 0.0 ? delay : 0.0)) / tick_seconds_g);
+    timer.expiry = (unsigned long long) ticks;
+    if (timer.expiry < base_) {
+        timer.expiry = base_;
+    }
+    timer.event = event;
+    timer.target = target;
+    Link(index);
+    pending_++;
+
+    return (timer.generation << id_index_bits_g) | (unsigned int) (index + 1);
+}
+
+
+void TimerWheel::Cancel(TimerId id)
+{
+
+    int index = Find(id);
+    if (index != -1) {
+        Unlink(index);
+        Free(index);
+        pending_--;
+    }
+}
+
+
+bool TimerWheel::IsPending(TimerId id)
+{
+
+    return Find(id) != -1;
+}
+
+
+double TimerWheel::GetRemaining(TimerId id)
+{
+
+    int index = Find(id);
+    if (index == -1) {
+        return 0.0;
+    }
+
+    double remaining = timers_[index].expiry * tick_seconds_g - time_;
+    return remaining > 0.0 ? remaining : 0.0;
+}
+
+
+void TimerWheel::Advance(double time, std::vector<TimerExpiry> &expired)
+{
+
+    if (time > time_) {
+        time_ = time;
+    }
+    unsigned long long target = (unsigned long long) std::floor(time_ / tick_seconds_g);
+
+    while (base_ <= target) {
+
+        // Nothing is scheduled, so the wheel can jump straight to the target
+        if (pending_ == 0) {
+            base_ = target + 1;
+            break;
+        }
+
+        // When the first level wraps around, bring down the timers of the next slot of the higher levels
+        if ((base_ & SLOT_MASK) == 0) {
+            for (int level = 1; level < LEVELS; level++) {
+                int slot = (int) ((base_ >> (level * SLOT_BITS)) & SLOT_MASK);
+                Cascade(level, slot);
+                if (slot != 0) {
+                    break;
+                }
+            }
+        }
+
+        // Every timer left in the current slot of the first level expires on this tick
+        int *head = &slots_[base_ & SLOT_MASK];
+        while (*head != -1) {
+            int index = *head;
+            TimerExpiry expiry = { timers_[index].event, timers_[index].target };
+            Unlink(index);
+            Free(index);
+            pending_--;
+            expired.push_back(expiry);
+        }
+
+        base_++;
+    }
+}
+
+
+void TimerWheel::CancelEvent(int event)
+{
+
+    for (int i = 0; i < timers_.size(); i++) {
+        if (timers_[i].slot != -1 && timers_[i].event == event) {
+            Unlink(i);
+            Free(i);
+            pending_--;
+        }
+    }
+}
+
+
+unsigned long long TimerWheel::Hash(void)
+{
+
+    unsigned long long hash = HashValue(HASH_SEED, base_);
+    for (int i = 0; i < timers_.size(); i++) {
+        const Timer &timer = timers_[i];
+        if (timer.slot == -1) {
+            continue;
+        }
+        hash = HashValue(hash, i);
+        hash = HashValue(hash, timer.expiry);
+        hash = HashValue(hash, timer.event);
+        hash = HashValue(hash, timer.target);
+        hash = HashValue(hash, timer.generation);
+    }
+    return hash;
+}
+
+
+void TimerWheel::Write(SnapshotWriter &writer)
+{
+
+    writer.WriteArray(timers_.data(), (int) timers_.size());
+    writer.Write(free_);
+    writer.Write(slots_);
+    writer.Write(base_);
+    writer.Write(time_);
+    writer.Write(pending_);
+}
+
+
+void TimerWheel::Read(SnapshotReader &reader)
+{
+
+    timers_.resize(reader.ReadCount(sizeof(Timer)));
+    reader.Read(timers_.data(), sizeof(Timer) * timers_.size());
+    reader.Read(free_);
+    reader.Read(slots_);
+    reader.Read(base_);
+    reader.Read(time_);
+    reader.Read(pending_);
+}
+
+
+int TimerWheel::Find(TimerId id)
+{
+
+    int index = (int) (id & id_index_mask_g) - 1;
+    if (index < 0 || index >= timers_.size()) {
+        return -1;
+    }
+
+    const Timer &timer = timers_[index];
+    if (timer.slot == -1 || timer.generation != (id >> id_index_bits_g)) {
+        return -1;
+    }
+    return index;
+}
+
+
+void TimerWheel::Link(int index)
+{
+    Timer &timer = timers_[index];
+
+    // Pick the lowest level whose slots still reach the expiry tick
+    unsigned long long delta = timer.expiry - base_;
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (1ull << ((level + 1) * SLOT_BITS))) {
+        level++;
+    }
+
+    // Timers too far away wait in the last slot of the top level and are cascaded again later
+    unsigned long long tick = timer.expiry;
+    if (delta >= (1ull << (LEVELS * SLOT_BITS))) {
+        tick = base_ + (1ull << (LEVELS * SLOT_BITS)) - 1;
+    }
+
+    int slot = level * SLOTS + (int) ((tick >> (level * SLOT_BITS)) & SLOT_MASK);
+    timer.slot = slot;
+    timer.prev = -1;
+    timer.next = slots_[slot];
+    if (timer.next != -1) {
+        timers_[timer.next].prev = index;
+    }
+    slots_[slot] = index;
+}
+
+
+void TimerWheel::Unlink(int index)
+{
+    Timer &timer = timers_[index];
+
+    if (timer.prev != -1) {
+        timers_[timer.prev].next = timer.next;
+    }
+    else {
+        slots_[timer.slot] = timer.next;
+    }
+    if (timer.next != -1) {
+        timers_[timer.next].prev = timer.prev;
+    }
+}
+
+
+void TimerWheel::Free(int index)
+{
+    Timer &timer = timers_[index];
+
+    timer.slot = -1;
+    timer.target = 0;
+    timer.generation = (timer.generation + 1) & id_generation_mask_g;
+    if (timer.generation == 0) {
+        timer.generation = 1;
+    }
+    timer.next = free_;
+    free_ = index;
+}
+
+
+void TimerWheel::Cascade(int level, int slot)
+{
+    // Detach the whole list first, since timers can land back in the same slot
+    int index = slots_[level * SLOTS + slot];
+    slots_[level * SLOTS + slot] = -1;
+
+    while (index != -1) {
+        int next = timers_[index].next;
+        Link(index);
+        index = next;
+    }
+}
+
+} // namespace game
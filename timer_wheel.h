@@ -0,0 +1,127 @@
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <vector>
+
+#include "snapshot.h"
+
+namespace game {
+
+    // Identifies a scheduled timer. Zero is never a valid timer
+    typedef unsigned int TimerId;
+
+    // What should happen when a timer expires
+    enum TimerEvent {
+        TIMER_SCRIPT,           // A behaviour script finished waiting
+        TIMER_COOLDOWN,         // The player's weapon finished cooling down
+        TIMER_SHIELD,           // The player's shield ran out
+        TIMER_ENEMY_WAVE,       // Time to spawn the next enemy
+        TIMER_POWERUP_WAVE      // Time to spawn the next powerup
+    };
+
+    // A timer that expired during TimerWheel::Advance
+    // The target is an entity, or a script slot for TIMER_SCRIPT
+    struct TimerExpiry {
+        int event;
+        unsigned int target;
+    };
+
+    /*
+        TimerWheel is a hierarchical timing wheel used by the simulation for all of its timers
+        Time is split into ticks of one millisecond. The first level has one slot per tick for the next 64 ticks,
+        and each following level has slots that are 64 times longer. Timers sit in the slot of their expiry tick
+        and move down a level when the wheel reaches their slot, so scheduling, cancelling and expiring are all
+        O(1), and pending timers cost nothing while the wheel turns
+    */
+    class TimerWheel {
+
+        public:
+            TimerWheel(void);
+
+            // Remove all timers and restart the wheel at the given time (in seconds)
+            void Reset(double time);
+
+            // Schedule an event on the target after delay seconds
+            TimerId Schedule(double delay, int event, unsigned int target);
+
+            // Cancel a timer. Does nothing if the timer already expired or was cancelled
+            void Cancel(TimerId id);
+
+            // Check if a timer has not expired and was not cancelled yet
+            bool IsPending(TimerId id);
+
+            // Seconds left before a timer expires, 0 if it is not pending
+            double GetRemaining(TimerId id);
+
+            // Turn the wheel up to the given time, collecting the timers that expired
+            void Advance(double time, std::vector<TimerExpiry> &expired);
+
+            // Cancel every pending timer of an event
+            void CancelEvent(int event);
+
+            // Hash of every pending timer, for checking that two runs match
+            unsigned long long Hash(void);
+
+            // Save or restore every timer as part of a game snapshot, ids stay valid across a restore
+            void Write(SnapshotWriter &writer);
+            void Read(SnapshotReader &reader);
+
+            // Getters
+            inline double GetTime(void) { return time_; }
+            inline int GetNumPending(void) { return pending_; }
+
+        private:
+            // Layout of the wheel
+            enum {
+                LEVELS = 4,
+                SLOT_BITS = 6,
+                SLOTS = 1 << SLOT_BITS,
+                SLOT_MASK = SLOTS - 1
+            };
+
+            struct Timer {
+                unsigned long long expiry;
+                int event;
+                unsigned int target;
+
+                // Neighbours in the slot list, or in the free list
+                int prev;
+                int next;
+
+                // Slot the timer is linked into, -1 if it is free
+                int slot;
+
+                // Bumped every time the timer is freed, so old ids stop matching
+                unsigned int generation;
+            };
+
+            std::vector<Timer> timers_;
+            int free_;
+
+            // Head of the list of timers in each slot, -1 if empty
+            int slots_[LEVELS * SLOTS];
+
+            // Next tick to process
+            unsigned long long base_;
+
+            // Time passed to the last Advance
+            double time_;
+
+            int pending_;
+
+            // Find the timer an id refers to, -1 if the id is stale
+            int Find(TimerId id);
+
+            // Put a timer in the slot for its expiry tick
+            void Link(int index);
+            void Unlink(int index);
+            void Free(int index);
+
+            // Move the timers of a slot down to the lower levels
+            void Cascade(int level, int slot);
+
+    }; // class TimerWheel
+
+} // namespace game
+
+#endif // TIMER_WHEEL_H_